@@ -1,4 +1,5 @@
 #include "config_manager.h"
+#include "layout_cache.h"
 #include "mqtt_manager.h"
 #include "label_widget.h"
 #include "button_widget.h"
@@ -16,6 +17,14 @@
 #include "image_widget.h"
 #include "line_chart_widget.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_rom_crc.h"
+#include "esp_heap_caps.h"
+#include "freertos/task.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <set>
 
 // C wrapper functions for bringing UI elements to front
 extern "C" {
@@ -28,42 +37,412 @@ class TabviewWidget;
 
 static const char* TAG = "ConfigManager";
 
+// Below the HMI task (4), which consumes what the config task produces, and the MQTT task (5)
+static constexpr uint32_t CONFIG_TASK_STACK_SIZE = 8192;
+static constexpr UBaseType_t CONFIG_TASK_PRIORITY = 3;
+static constexpr uint32_t CONFIG_LOST_POLL_MS = 500;
+
+// Copy of a widget definition without its "children", used for diffing on reload
+static cJSON* copyDefinition(cJSON* widget_json) {
+    cJSON* definition = cJSON_CreateObject();
+    cJSON* field = nullptr;
+    cJSON_ArrayForEach(field, widget_json) {
+        if (!field->string || strcmp(field->string, "children") == 0) {
+            continue;
+        }
+        cJSON_AddItemToObject(definition, field->string, cJSON_Duplicate(field, true));
+    }
+    return definition;
+}
+
+static bool isSkipped(const char* name, const char* skip) {
+    return !name || strcmp(name, "children") == 0 || (skip && strcmp(name, skip) == 0);
+}
+
+// Compare two widget objects field by field, ignoring "children" and optionally one more key
+static bool sameExcept(cJSON* a, cJSON* b, const char* skip) {
+    int count_a = 0;
+    cJSON* field = nullptr;
+    cJSON_ArrayForEach(field, a) {
+        if (isSkipped(field->string, skip)) {
+            continue;
+        }
+        count_a++;
+        cJSON* other = cJSON_GetObjectItemCaseSensitive(b, field->string);
+        if (!other || !cJSON_Compare(field, other, true)) {
+            return false;
+        }
+    }
+    int count_b = 0;
+    cJSON_ArrayForEach(field, b) {
+        if (!isSkipped(field->string, skip)) {
+            count_b++;
+        }
+    }
+    return count_a == count_b;
+}
+
+// Collect properties whose values differ; returns nullptr if a property was removed
+static cJSON* changedProperties(cJSON* old_props, cJSON* new_props) {
+    cJSON* changed = cJSON_CreateObject();
+    cJSON* field = nullptr;
+    cJSON_ArrayForEach(field, old_props) {
+        if (field->string && !cJSON_GetObjectItemCaseSensitive(new_props, field->string)) {
+            cJSON_Delete(changed);
+            return nullptr;
+        }
+    }
+    cJSON_ArrayForEach(field, new_props) {
+        if (!field->string) {
+            continue;
+        }
+        cJSON* old_value = cJSON_GetObjectItemCaseSensitive(old_props, field->string);
+        if (!old_value || !cJSON_Compare(field, old_value, true)) {
+            cJSON_AddItemToObject(changed, field->string, cJSON_Duplicate(field, true));
+        }
+    }
+    return changed;
+}
+
+// Read a string field, returns empty string if missing
+static std::string stringField(cJSON* object, const char* name) {
+    cJSON* item = cJSON_GetObjectItem(object, name);
+    return (item && cJSON_IsString(item)) ? item->valuestring : "";
+}
+
+// RFC 7396 JSON Merge Patch; takes ownership of target and returns the merged item
+static cJSON* mergePatch(cJSON* target, cJSON* patch) {
+    if (!cJSON_IsObject(patch)) {
+        cJSON_Delete(target);
+        return cJSON_Duplicate(patch, true);
+    }
+    if (!cJSON_IsObject(target)) {
+        cJSON_Delete(target);
+        target = cJSON_CreateObject();
+    }
+    cJSON* field = nullptr;
+    cJSON_ArrayForEach(field, patch) {
+        if (!field->string) {
+            continue;
+        }
+        if (cJSON_IsNull(field)) {
+            cJSON_DeleteItemFromObjectCaseSensitive(target, field->string);
+        } else {
+            cJSON* existing = cJSON_DetachItemFromObjectCaseSensitive(target, field->string);
+            cJSON_AddItemToObject(target, field->string, mergePatch(existing, field));
+        }
+    }
+    return target;
+}
+
+// Place a newly created widget right after its previous sibling to keep config order on screen
+static lv_obj_t* placeAfter(HMIWidget* widget, lv_obj_t* prev_obj) {
+    lv_obj_t* obj = widget ? widget->getLvglObject() : nullptr;
+    if (!obj || !lv_obj_is_valid(obj)) {
+        return prev_obj;
+    }
+    int32_t target = 0;
+    if (prev_obj && lv_obj_is_valid(prev_obj) && lv_obj_get_parent(prev_obj) == lv_obj_get_parent(obj)) {
+        target = lv_obj_get_index(prev_obj) + 1;
+    }
+    int32_t current = lv_obj_get_index(obj);
+    if (current < target) {
+        target--;
+    }
+    if (current != target) {
+        lv_obj_move_to_index(obj, target);
+    }
+    return obj;
+}
+
+// Number from a widget definition's "properties", or fallback when absent
+static int intProperty(cJSON* definition, const char* name, int fallback) {
+    cJSON* item = cJSON_GetObjectItem(cJSON_GetObjectItem(definition, "properties"), name);
+    return cJSON_IsNumber(item) ? item->valueint : fallback;
+}
+
+static bool boolProperty(cJSON* definition, const char* name) {
+    return cJSON_IsTrue(cJSON_GetObjectItem(cJSON_GetObjectItem(definition, "properties"), name));
+}
+
+// Topics a widget plan subscribes to ("mqtt_topic" anywhere in it, "mqtt_subscribe")
+static void collectTopics(cJSON* item, std::set<std::string>& topics) {
+    // Images are too large for the last-value cache; subscribing when the tab is built
+    // makes the broker resend the retained one instead
+    if (cJSON_IsObject(item) && stringField(item, "type") == "image") {
+        return;
+    }
+    cJSON* child = nullptr;
+    cJSON_ArrayForEach(child, item) {
+        if (cJSON_IsString(child) && child->string &&
+            (strcmp(child->string, "mqtt_topic") == 0 || strcmp(child->string, "mqtt_subscribe") == 0)) {
+            topics.insert(child->valuestring);
+        } else if (cJSON_IsObject(child) || cJSON_IsArray(child)) {
+            collectTopics(child, topics);
+        }
+    }
+}
+
+// Whether a widget array (or a tabview's per-tab children object) defines the given id
+static bool planHasId(cJSON* widgets, const std::string& id) {
+    cJSON* item = nullptr;
+    cJSON_ArrayForEach(item, widgets) {
+        if (cJSON_IsArray(item)) {
+            if (planHasId(item, id)) {
+                return true;
+            }
+        } else if (stringField(item, "id") == id || planHasId(cJSON_GetObjectItem(item, "children"), id)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Widget with the given id in a widget array (or a tabview's per-tab children object), and the
+// array holding it
+static cJSON* findPlanWidget(cJSON* widgets, const std::string& id, cJSON** siblings) {
+    cJSON* item = nullptr;
+    cJSON_ArrayForEach(item, widgets) {
+        cJSON* found = nullptr;
+        if (cJSON_IsArray(item)) {
+            found = findPlanWidget(item, id, siblings);
+        } else if (stringField(item, "id") == id) {
+            *siblings = widgets;
+            return item;
+        } else {
+            found = findPlanWidget(cJSON_GetObjectItem(item, "children"), id, siblings);
+        }
+        if (found) {
+            return found;
+        }
+    }
+    return nullptr;
+}
+
 ConfigManager& ConfigManager::getInstance() {
     static ConfigManager instance;
     return instance;
 }
 
-ConfigManager::ConfigManager() : m_current_version(0), m_has_pending_config(false) {
+ConfigManager::ConfigManager()
+    : m_current_version(0),
+      m_stream_parser(
+          [this](cJSON* widget) {
+              int64_t start_us = esp_timer_get_time();
+              widget = m_templates.expand(widget);
+              m_stream_templates_us += esp_timer_get_time() - start_us;
+              if (!widget) {
+                  ESP_LOGE(TAG, "Template expansion failed: %s", m_templates.error().c_str());
+                  return false;
+              }
+              return sendStreamCommand(StreamCommand::Widget, "", widget);
+          },
+          [this](const std::string& key, cJSON* value) {
+              if (key == "templates") {
+                  ESP_LOGE(TAG, "'templates' must be an object keyed by template name");
+                  cJSON_Delete(value);
+                  return false;
+              }
+              if (key == "reconcile" && cJSON_IsFalse(value)) {
+                  m_stream_can_keep = false;  // Everything is rebuilt, nothing can be kept as is
+              }
+              return sendStreamCommand(StreamCommand::Field, key, value);
+          },
+          DEFAULT_STREAM_ITEM_SIZE) {
+    m_stream_parser.setWidgetTextFilter([this](const char* text, size_t len) { return filterStreamWidget(text, len); });
+    // Pages and templates are taken apart like the root widgets, so no item limit applies to them as a whole
+    m_stream_parser.setPageCallback([this](ConfigStreamParser::PageEvent event, const std::string& key, cJSON* item) {
+        return streamPage(event, key, item);
+    });
+    m_stream_parser.setTemplateCallback([this](const std::string& name, cJSON* definition) {
+        return streamTemplate(name, definition);
+    });
     m_config_mutex = xSemaphoreCreateMutex();
+    m_stream_queue = xQueueCreate(STREAM_QUEUE_DEPTH, sizeof(StreamCommand*));
+    startConfigTask();
+
+    // "navigate" buttons; called from their click event on the LVGL thread
+    HMIWidget::setNavigateHandler([this](const std::string& target) { showPage(target); });
 }
 
 ConfigManager::~ConfigManager() {
     destroyAllWidgets();
+    if (m_stream_queue) {
+        StreamCommand* command = nullptr;
+        while (xQueueReceive(m_stream_queue, &command, 0) == pdTRUE) {
+            cJSON_Delete(command->item);
+            delete command;
+        }
+        vQueueDelete(m_stream_queue);
+    }
+    if (m_config_queue) {
+        ConfigJob* job = nullptr;
+        while (xQueueReceive(m_config_queue, &job, 0) == pdTRUE) {
+            delete job;
+        }
+    }
+    resetStreamPage();
+    clearPendingLocked();
     if (m_config_mutex) {
         vSemaphoreDelete(m_config_mutex);
     }
 }
 
-bool ConfigManager::parseAndApply(const std::string& json_config) {
-    if (json_config.empty()) {
-        ESP_LOGE(TAG, "Empty configuration");
+bool ConfigManager::hasWidgetsArray(cJSON* root) {
+    cJSON* widgets_array = cJSON_GetObjectItem(root, "widgets");
+    if (!widgets_array) {
+        ESP_LOGE(TAG, "Missing 'widgets' array in JSON root");
         return false;
     }
-    
-    ESP_LOGI(TAG, "Processing new configuration (%d bytes)", json_config.length());
-    ESP_LOGV(TAG, "JSON content: %s", json_config.c_str());
-    
-    cJSON* root = cJSON_Parse(json_config.c_str());
+    if (!cJSON_IsArray(widgets_array)) {
+        ESP_LOGE(TAG, "'widgets' field is not an array (type: %d)", widgets_array->type);
+        return false;
+    }
+    return true;
+}
+
+cJSON* ConfigManager::parsePatch(const char* data, size_t len) {
+    cJSON* root = cJSON_ParseWithLength(data, len);
     if (!root) {
         const char* error_ptr = cJSON_GetErrorPtr();
-        ESP_LOGE(TAG, "Failed to parse JSON!");
-        ESP_LOGE(TAG, "Error position: %s", error_ptr ? error_ptr : "unknown");
-        ESP_LOGE(TAG, "First 100 chars: %.100s", json_config.c_str());
+        ESP_LOGE(TAG, "Failed to parse patch JSON at: %.32s", error_ptr ? error_ptr : "unknown");
+        return nullptr;
+    }
+    cJSON* widgets = cJSON_GetObjectItem(root, "widgets");
+    if (!widgets || !cJSON_IsObject(widgets)) {
+        ESP_LOGE(TAG, "Patch needs a 'widgets' object keyed by widget id");
+        cJSON_Delete(root);
+        return nullptr;
+    }
+
+    // Instances of the applied config's templates, keyed by id like any other widget
+    cJSON* widget_patch = widgets->child;
+    while (widget_patch) {
+        cJSON* next = widget_patch->next;
+        if (cJSON_IsObject(widget_patch) && cJSON_GetObjectItem(widget_patch, "template")) {
+            std::string id = widget_patch->string;
+            cJSON* instance = cJSON_Duplicate(widget_patch, true);
+            if (!cJSON_GetObjectItem(instance, "id")) {
+                cJSON_AddStringToObject(instance, "id", id.c_str());
+            }
+            cJSON* widget = m_templates.expand(instance);
+            if (!widget) {
+                ESP_LOGE(TAG, "Patch for '%s': %s", id.c_str(), m_templates.error().c_str());
+                cJSON_Delete(root);
+                return nullptr;
+            }
+            cJSON_ReplaceItemInObjectCaseSensitive(widgets, id.c_str(), widget);
+        }
+        widget_patch = next;
+    }
+    return root;
+}
+
+bool ConfigManager::streamTemplate(const std::string& name, cJSON* definition) {
+    if (m_stream_templates_closed) {
+        ESP_LOGE(TAG, "\"templates\" must precede \"widgets\" and \"pages\" in a streamed config");
+        cJSON_Delete(definition);
         return false;
     }
-    
-    ESP_LOGV(TAG, "JSON parsed successfully");
-    
+    int64_t start_us = esp_timer_get_time();
+    if (!m_stream_templates_seen) {
+        m_stream_templates_seen = true;
+        m_templates.beginLoad();
+    }
+    if (definition) {
+        bool ok = m_templates.add(name, definition);
+        m_stream_templates_us += esp_timer_get_time() - start_us;
+        if (!ok) {
+            ESP_LOGE(TAG, "Invalid templates: %s", m_templates.error().c_str());
+            m_templates.abortLoad();
+            m_stream_templates_closed = true;
+        }
+        return ok;
+    }
+
+    // The object closed: the new library replaces the previous one
+    bool changed = false;
+    m_templates.endLoad(&changed);
+    m_stream_templates_us += esp_timer_get_time() - start_us;
+    m_stream_templates_closed = true;
+    if (changed) {
+        m_stream_can_keep = false;  // Unchanged instance text may now expand differently
+    }
+    return true;
+}
+
+void ConfigManager::closeStreamTemplates() {
+    if (m_stream_templates_closed) {
+        return;
+    }
+    m_stream_templates_closed = true;
+    if (!m_stream_templates_seen && !m_templates.empty()) {
+        // The previous config's templates are gone, and so are its instances
+        m_templates.clear();
+        m_stream_can_keep = false;
+    }
+}
+
+void ConfigManager::logTemplates(int64_t elapsed_us) {
+    if (m_templates.empty()) {
+        return;
+    }
+    ESP_LOGI(TAG, "Templates: %u (%u compiled), %u instances expanded in %lld.%03lld ms",
+             (unsigned)m_templates.size(), (unsigned)m_templates.compiledCount(),
+             (unsigned)m_templates.instanceCount(), elapsed_us / 1000, elapsed_us % 1000);
+}
+
+bool ConfigManager::loadCachedLayout() {
+    int64_t start_us = esp_timer_get_time();
+    cJSON* root = LayoutCache::getInstance().load();
+    if (!root) {
+        return false;
+    }
+    int64_t decoded_us = esp_timer_get_time();
+    MQTTManager::getInstance().beginBatch();
+    bool success = applyConfig(root, true);
+    MQTTManager::getInstance().endBatch();
+    cJSON_Delete(root);
+    ESP_LOGI(TAG, "Cached layout built in %lld ms (decode %lld ms)",
+             (esp_timer_get_time() - start_us) / 1000, (decoded_us - start_us) / 1000);
+    return success;
+}
+
+void ConfigManager::persistLayout() {
+    cJSON* root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "version", m_current_version);
+    cJSON* widgets = cJSON_CreateArray();
+    cJSON_AddItemToObject(root, "widgets", widgets);
+    for (const auto& node : m_root_nodes) {
+        cJSON_AddItemToArray(widgets, nodeToJson(node));
+    }
+
+    // Pages are cached as applied (templates expanded), so a paged config boots into its start page
+    if (!m_pages.empty()) {
+        cJSON* pages = cJSON_CreateArray();
+        cJSON_AddItemToObject(root, "pages", pages);
+        for (const auto& page : m_pages) {
+            cJSON* plan = cJSON_Parse(page->plan.c_str());
+            if (plan) {
+                cJSON_AddItemToArray(pages, plan);
+            }
+        }
+        if (!m_start_page.empty()) {
+            cJSON_AddStringToObject(root, "start_page", m_start_page.c_str());
+        }
+        if (m_page_cache != DEFAULT_PAGE_CACHE) {
+            cJSON_AddNumberToObject(root, "page_cache", m_page_cache);
+        }
+    }
+    if (!m_page_topic.empty()) {
+        cJSON_AddStringToObject(root, "page_topic", m_page_topic.c_str());
+    }
+    LayoutCache::getInstance().storeAsync(root);
+}
+
+bool ConfigManager::applyConfig(cJSON* root, bool from_cache) {
+    invalidateAppliedConfig();
+
     // Extract version (optional, for logging only)
     cJSON* version_item = cJSON_GetObjectItem(root, "version");
     int new_version = 0;
@@ -74,141 +453,784 @@ bool ConfigManager::parseAndApply(const std::string& json_config) {
         ESP_LOGV(TAG, "No version field, applying configuration anyway");
     }
     
-    // Destroy existing widgets
-    destroyAllWidgets();
-
-    // Drop LVGL image cache to avoid stale cached images after reload
-    lv_image_cache_drop(nullptr);
-    
     // Parse widgets array
-    cJSON* widgets_array = cJSON_GetObjectItem(root, "widgets");
-    if (!widgets_array) {
-        ESP_LOGE(TAG, "Missing 'widgets' array in JSON root");
-        cJSON_Delete(root);
-        return false;
-    }
-    if (!cJSON_IsArray(widgets_array)) {
-        ESP_LOGE(TAG, "'widgets' field is not an array (type: %d)", widgets_array->type);
-        cJSON_Delete(root);
+    if (!hasWidgetsArray(root)) {
         return false;
     }
+    cJSON* widgets_array = cJSON_GetObjectItem(root, "widgets");
     
     int widget_count = cJSON_GetArraySize(widgets_array);
     ESP_LOGV(TAG, "Found %d widgets in configuration", widget_count);
-    
-    bool success = parseWidgets(widgets_array);
+
+    bool reconcile = true;
+    cJSON* reconcile_item = cJSON_GetObjectItem(root, "reconcile");
+    if (reconcile_item && cJSON_IsBool(reconcile_item)) {
+        reconcile = cJSON_IsTrue(reconcile_item);
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    ReloadStats stats;
+    bool success = true;
+
+    if (reconcile && !m_root_nodes.empty()) {
+        // Keep unchanged widgets, update or rebuild changed ones, create/destroy the delta
+        reconcileWidgets(widgets_array, nullptr, m_root_nodes, stats);
+        if (stats.image_destroyed) {
+            lv_image_cache_drop(nullptr);
+        }
+    } else {
+        // Build the new tree off screen; the current one stays visible until the swap
+        lv_obj_t* screen = createScreen();
+        std::vector<WidgetNode> old_nodes = std::move(m_root_nodes);
+        m_root_nodes.clear();
+
+        success = parseWidgets(widgets_array, screen, m_root_nodes);
+        stats.created = countNodes(m_root_nodes);
+        showScreen(screen, old_nodes, stats);
+    }
+
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
     
     if (success) {
+        applyPages(root, pagePlans(cJSON_GetObjectItem(root, "pages")));
         m_current_version = new_version;
-        ESP_LOGI(TAG, "Configuration applied successfully, %d widgets created", m_active_widgets.size());
-        
-        // Bring settings and info icons to foreground so they're always on top
-        settings_ui_bring_to_front();
-        status_info_bring_to_front();
+        finishApply(stats, elapsed_us, reconcile ? "reconcile" : "full rebuild", from_cache);
     } else {
         ESP_LOGE(TAG, "Failed to apply configuration");
     }
     
-    cJSON_Delete(root);
     return success;
 }
 
-void ConfigManager::queueConfig(const std::string& json_config) {
+void ConfigManager::finishApply(const ReloadStats& stats, int64_t elapsed_us, const char* mode, bool from_cache) {
+    ESP_LOGI(TAG, "Configuration applied in %lld.%03lld ms (%s): kept=%d updated=%d created=%d destroyed=%d, %d widgets active",
+             elapsed_us / 1000, elapsed_us % 1000, mode,
+             stats.kept, stats.updated, stats.created, stats.destroyed, (int)countNodes(m_root_nodes));
+
+    // Bring settings and info icons to foreground so they're always on top
+    settings_ui_bring_to_front();
+    status_info_bring_to_front();
+
+    if (!from_cache) {
+        if (!m_live_config_applied) {
+            m_live_config_applied = true;
+            ESP_LOGI(TAG, "Startup: live configuration applied %lld ms after boot", esp_timer_get_time() / 1000);
+        }
+        persistLayout();
+    }
+}
+
+bool ConfigManager::applyParsedPatch(cJSON* root) {
+    cJSON* widgets = cJSON_GetObjectItem(root, "widgets");
+
+    invalidateAppliedConfig();
+    int64_t start_us = esp_timer_get_time();
+    ReloadStats stats;
+    int failed = 0;
+    cJSON* widget_patch = nullptr;
+    cJSON_ArrayForEach(widget_patch, widgets) {
+        if (!widget_patch->string || !patchWidget(widget_patch->string, widget_patch, stats)) {
+            failed++;
+        }
+    }
+    if (stats.image_destroyed) {
+        lv_image_cache_drop(nullptr);
+    }
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+
+    ESP_LOGI(TAG, "Patch applied in %lld.%03lld ms: updated=%d created=%d destroyed=%d failed=%d",
+             elapsed_us / 1000, elapsed_us % 1000, stats.updated, stats.created, stats.destroyed, failed);
+
+    // Added root widgets must not cover the overlays
+    if (stats.created > 0) {
+        settings_ui_bring_to_front();
+        status_info_bring_to_front();
+    }
+    persistLayout();
+    return failed == 0;
+}
+
+void ConfigManager::clearPendingLocked() {
+    for (cJSON* patch : m_pending_patches) {
+        cJSON_Delete(patch);
+    }
+    m_pending_patches.clear();
+    m_has_pending_config = false;
+}
+
+void ConfigManager::queuePatch(const MqttPayload& json_patch) {
+    // Parsed on the config task, which owns the templates, after any config received before it
+    ConfigJob* job = new ConfigJob{ConfigJob::Patch, json_patch};
+    if (!queueConfigJob(job)) {
+        ESP_LOGE(TAG, "Config task busy, patch dropped (%u bytes)", (unsigned)json_patch.size());
+        delete job;
+    }
+}
+
+void ConfigManager::parseQueuedPatch(const MqttPayload& json_patch) {
+    ESP_LOGI(TAG, "Parsing config patch (%u bytes)", (unsigned)json_patch.size());
+    cJSON* root = parsePatch(json_patch.data(), json_patch.size());
+    if (!root) {
+        return;
+    }
     if (xSemaphoreTake(m_config_mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-        m_pending_config = json_config;
+        if (m_pending_patches.size() >= MAX_PENDING_PATCHES) {
+            ESP_LOGW(TAG, "Too many pending patches, dropping oldest");
+            cJSON_Delete(m_pending_patches.front());
+            m_pending_patches.erase(m_pending_patches.begin());
+        }
+        m_pending_patches.push_back(root);
         m_has_pending_config = true;
-        ESP_LOGV(TAG, "Config queued for application by HMI task");
+        ESP_LOGV(TAG, "Patch queued for application by HMI task");
         xSemaphoreGive(m_config_mutex);
     } else {
-        ESP_LOGE(TAG, "Failed to queue config - mutex timeout");
+        ESP_LOGE(TAG, "Failed to queue patch - mutex timeout");
+        cJSON_Delete(root);
+    }
+}
+
+bool ConfigManager::hasPendingWork() const {
+    return m_stream.active || !m_retired_nodes.empty() || !m_retired_screens.empty() ||
+           m_has_pending_config.load(std::memory_order_acquire) || m_page_requested.load(std::memory_order_acquire) ||
+           uxQueueMessagesWaiting(m_stream_queue) > 0;
+}
+
+bool ConfigManager::processPendingConfig() {
+    // The caller holds the LVGL lock for exactly this call, so its duration is the lock hold time
+    int64_t start_us = esp_timer_get_time();
+    bool worked = false;
+
+    // Widgets subscribe from their constructors; each poll sends those as a few multi-topic packets
+    MQTTManager::getInstance().beginBatch();
+    bool streaming = applyPending(worked);
+    MQTTManager::getInstance().endBatch();
+
+    // Page requested over MQTT; reloads apply first so the page exists
+    if (!m_stream.active && m_page_requested.exchange(false, std::memory_order_acq_rel)) {
+        std::string target;
+        int64_t requested_us = 0;
+        if (xSemaphoreTake(m_config_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+            target = std::move(m_requested_page);
+            requested_us = m_page_requested_us;
+            xSemaphoreGive(m_config_mutex);
+        }
+        if (!target.empty()) {
+            switchPage(target, requested_us, true);
+        }
+    }
+
+    // Widgets replaced by the last swap go with whatever is left of this poll's budget.
+    // Teardown after a page switch is not part of any reload.
+    if (retireWidgets(start_us + STREAM_POLL_BUDGET_US)) {
+        worked = worked || m_reload_lock.polls > 0;
+        streaming = true;
     }
+
+    // Polls while a streamed config waits for the network count towards it too
+    if (worked || m_stream.active) {
+        int64_t held_us = esp_timer_get_time() - start_us;
+        m_reload_lock.polls++;
+        m_reload_lock.total_us += held_us;
+        m_reload_lock.max_us = std::max(m_reload_lock.max_us, held_us);
+    }
+    if (!m_stream.active && m_retired_nodes.empty() && m_reload_lock.polls > 0) {
+        ESP_LOGI(TAG, "LVGL lock held %lld.%03lld ms over %lu polls for this reload (longest %lld.%03lld ms)",
+                 m_reload_lock.total_us / 1000, m_reload_lock.total_us % 1000, (unsigned long)m_reload_lock.polls,
+                 m_reload_lock.max_us / 1000, m_reload_lock.max_us % 1000);
+        m_last_reload_lock = m_reload_lock;
+        m_reload_lock = ReloadLockStats();
+    }
+    return streaming;
 }
 
-void ConfigManager::processPendingConfig() {
+bool ConfigManager::applyPending(bool& worked) {
+    // Streamed config first; the queue is bounded, so the config task waits for us.
+    // Stop early once the time budget is spent so LVGL can render and read touch in between.
+    int64_t deadline_us = esp_timer_get_time() + STREAM_POLL_BUDGET_US;
+    StreamCommand* command = nullptr;
+    for (size_t i = 0; i < STREAM_COMMANDS_PER_POLL && (i == 0 || esp_timer_get_time() < deadline_us) &&
+                       xQueueReceive(m_stream_queue, &command, 0) == pdTRUE; i++) {
+        handleStreamCommand(*command);
+        cJSON_Delete(command->item);
+        delete command;
+        worked = true;
+    }
+
+    // Patches wait until the streamed config they follow is complete
+    if (m_stream.active) {
+        return true;
+    }
+    if (uxQueueMessagesWaiting(m_stream_queue) > 0) {
+        return true;  // Budget ran out with commands left
+    }
+
     if (!m_has_pending_config) {
-        return; // No pending config
+        return false; // No pending patch
     }
     
-    std::string config_to_apply;
+    std::vector<cJSON*> patches_to_apply;
     if (xSemaphoreTake(m_config_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
         if (m_has_pending_config) {
-            config_to_apply = m_pending_config;
+            patches_to_apply.swap(m_pending_patches);
             m_has_pending_config = false;
-            m_pending_config.clear();
         }
         xSemaphoreGive(m_config_mutex);
     }
     
-    if (!config_to_apply.empty()) {
-        ESP_LOGI(TAG, "Processing pending config from HMI task");
-        parseAndApply(config_to_apply);
+    // Patches apply on top of the config streamed before them, in arrival order
+    for (cJSON* patch : patches_to_apply) {
+        applyParsedPatch(patch);
+        cJSON_Delete(patch);
+        worked = true;
     }
+    return false;
 }
 
-bool ConfigManager::parseWidgets(cJSON* widgets_array, lv_obj_t* parent) {
-    int array_size = cJSON_GetArraySize(widgets_array);
-    ESP_LOGI(TAG, "Parsing %d widgets", array_size);
-    
-    for (int i = 0; i < array_size; i++) {
-        ESP_LOGI(TAG, "Processing widget %d/%d", i+1, array_size);
-        cJSON* widget_json = cJSON_GetArrayItem(widgets_array, i);
-        if (!widget_json) {
-            ESP_LOGE(TAG, "Widget at index %d is NULL", i);
-            continue;
-        }
-        if (!createWidget(widget_json, parent)) {
-            ESP_LOGW(TAG, "Failed to create widget at index %d", i);
-            // Continue with other widgets instead of failing completely
+void ConfigManager::streamConfigChunk(const char* data, size_t len, size_t offset, size_t total) {
+    if (data && offset == 0) {
+        m_chunks_dropped = false;
+    } else if (m_chunks_dropped) {
+        return;  // Rest of a document that was already given up
+    }
+
+    ConfigJob* job = new ConfigJob{ConfigJob::Chunk, data ? MqttPayload(data, len) : MqttPayload(), offset, total, !data};
+    size_t backlog = m_config_backlog.load(std::memory_order_relaxed);
+    if (backlog + job->data.size() > MAX_CONFIG_BACKLOG) {
+        ESP_LOGE(TAG, "Config task %u bytes behind, dropping config at byte %u of %u", (unsigned)backlog,
+                 (unsigned)offset, (unsigned)total);
+    } else {
+        size_t size = job->data.size();  // The job may be gone once queued
+        m_config_backlog.fetch_add(size, std::memory_order_relaxed);
+        if (queueConfigJob(job)) {
+            return;
         }
+        m_config_backlog.fetch_sub(size, std::memory_order_relaxed);
+        ESP_LOGE(TAG, "Config task queue full, dropping config at byte %u of %u", (unsigned)offset, (unsigned)total);
     }
-    
-    return true;
+    delete job;
+    // Never wait here: the config task abandons the document before its next job instead
+    m_chunks_dropped = data != nullptr;
+    m_config_lost.store(true, std::memory_order_release);
 }
 
-HMIWidget* ConfigManager::createWidgetByType(const std::string& type, const std::string& id, int x, int y, int w, int h, cJSON* properties, lv_obj_t* parent) {
-    if (type == "label") {
-        return new LabelWidget(id, x, y, w, h, properties, parent);
-    } else if (type == "button") {
-        return new ButtonWidget(id, x, y, w, h, properties, parent);
-    } else if (type == "container") {
-        return new ContainerWidget(id, x, y, w, h, properties, parent);
-    } else if (type == "switch") {
-        return new SwitchWidget(id, x, y, w, h, properties, parent);
-    } else if (type == "slider") {
-        return new SliderWidget(id, x, y, w, h, properties, parent);
-    } else if (type == "bar") {
-        return new BarWidget(id, x, y, w, h, properties, parent);
-    } else if (type == "arc") {
-        return new ArcWidget(id, x, y, w, h, properties, parent);
-    } else if (type == "checkbox") {
-        return new CheckboxWidget(id, x, y, w, h, properties, parent);
-    } else if (type == "dropdown") {
-        return new DropdownWidget(id, x, y, w, h, properties, parent);
-    } else if (type == "led") {
-        return new LEDWidget(id, x, y, w, h, properties, parent);
-    } else if (type == "spinner") {
-        return new SpinnerWidget(id, x, y, w, h, properties, parent);
-    } else if (type == "tabview") {
-        return new TabviewWidget(id, x, y, w, h, properties, parent);
-    } else if (type == "gauge") {
-        return new GaugeWidget(id, x, y, w, h, properties, parent);
-    } else if (type == "image") {
-        return new ImageWidget(id, x, y, w, h, properties, parent);
-    } else if (type == "line_chart") {
-        return new LineChartWidget(id, x, y, w, h, properties, parent);
+void ConfigManager::startConfigTask() {
+    m_config_queue = xQueueCreate(CONFIG_QUEUE_DEPTH, sizeof(ConfigJob*));
+    if (!m_config_queue) {
+        ESP_LOGE(TAG, "Failed to create config queue, configs are parsed on the MQTT task");
+        return;
+    }
+    if (xTaskCreate(config_task, "config", CONFIG_TASK_STACK_SIZE, this, CONFIG_TASK_PRIORITY, nullptr) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to start config task, configs are parsed on the MQTT task");
+        vQueueDelete(m_config_queue);
+        m_config_queue = nullptr;
     }
-    ESP_LOGE(TAG, "Unknown widget type: %s", type.c_str());
-    return nullptr;
 }
 
-bool ConfigManager::createWidget(cJSON* widget_json, lv_obj_t* parent) {
-    if (!widget_json) {
-        ESP_LOGE(TAG, "Widget JSON is NULL");
-        return false;
+bool ConfigManager::queueConfigJob(ConfigJob* job) {
+    if (!m_config_queue) {
+        runConfigJob(*job);
+        delete job;
+        return true;
     }
-    if (!cJSON_IsObject(widget_json)) {
-        ESP_LOGE(TAG, "Widget JSON is not an object (type: %d)", widget_json->type);
-        return false;
+    return xQueueSend(m_config_queue, &job, 0) == pdTRUE;
+}
+
+void ConfigManager::config_task(void* arg) {
+    ConfigManager* manager = static_cast<ConfigManager*>(arg);
+    while (true) {
+        // Wakes up now and then so a dropped last chunk still ends the stream
+        ConfigJob* job = nullptr;
+        if (xQueueReceive(manager->m_config_queue, &job, pdMS_TO_TICKS(CONFIG_LOST_POLL_MS)) == pdTRUE) {
+            manager->runConfigJob(*job);
+            delete job;
+        } else if (manager->m_config_lost.exchange(false, std::memory_order_acq_rel)) {
+            manager->consumeConfigChunk(nullptr, 0, 0, 0);
+        }
+    }
+}
+
+void ConfigManager::runConfigJob(ConfigJob& job) {
+    // A chunk the MQTT task could not queue: whatever is streaming is incomplete
+    if (m_config_lost.exchange(false, std::memory_order_acq_rel)) {
+        consumeConfigChunk(nullptr, 0, 0, 0);
+    }
+    if (job.kind == ConfigJob::Patch) {
+        parseQueuedPatch(job.data);
+    } else {
+        m_config_backlog.fetch_sub(job.data.size(), std::memory_order_relaxed);
+        consumeConfigChunk(job.lost ? nullptr : job.data.data(), job.data.size(), job.offset, job.total);
+    }
+}
+
+void ConfigManager::consumeConfigChunk(const char* data, size_t len, size_t offset, size_t total) {
+    if (!data) {
+        // MQTTManager abandoned the message (lost chunk, timeout or disconnect), or the MQTT task
+        // could not queue one of its chunks
+        if (m_stream_open) {
+            ESP_LOGE(TAG, "Config stream aborted at byte %u of %u", (unsigned)offset, (unsigned)total);
+            m_stream_open = false;
+            m_applied_widget_ids.clear();
+            m_templates.abortLoad();
+            resetStreamPage();
+            sendStreamCommand(StreamCommand::End, "", nullptr, false);
+        }
+        return;
+    }
+    if (offset == 0) {
+        if (m_stream_open) {
+            ESP_LOGW(TAG, "Config stream restarted before the previous one completed");
+            sendStreamCommand(StreamCommand::End, "", nullptr, false);
+        }
+        ESP_LOGI(TAG, "Streaming configuration (%u bytes)", (unsigned)total);
+        m_stream_parser.reset();
+        m_stream_open = true;
+        m_stream_crc = 0;
+        m_stream_widget_ids.clear();
+        m_stream_templates_seen = false;
+        m_stream_templates_closed = false;
+        m_stream_templates_us = 0;
+        resetStreamPage();
+        m_stream_generation = m_layout_generation.load(std::memory_order_acquire);
+        m_stream_can_keep = !m_applied_widget_ids.empty() && m_applied_widget_generation == m_stream_generation;
+
+        // A full config supersedes anything queued before it
+        if (xSemaphoreTake(m_config_mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+            clearPendingLocked();
+            xSemaphoreGive(m_config_mutex);
+        }
+        if (!sendStreamCommand(StreamCommand::Begin, "", nullptr, false, m_stream_generation)) {
+            m_stream_open = false;
+            return;
+        }
+    }
+    if (!m_stream_open) {
+        return;  // Earlier chunk failed, drop the rest of this message
+    }
+
+    m_stream_crc = esp_rom_crc32_le(m_stream_crc, reinterpret_cast<const uint8_t*>(data), len);
+    bool ok = m_stream_parser.feed(data, len);
+    bool complete = offset + len >= total;
+    if (ok && complete) {
+        ok = m_stream_parser.finish();
+        if (ok && !m_stream_parser.hasWidgets()) {
+            ESP_LOGE(TAG, "Missing 'widgets' array in JSON root");
+            ok = false;
+        }
+    }
+    if (!ok) {
+        ESP_LOGE(TAG, "Config stream failed at byte %u: %s", (unsigned)(offset + len),
+                 m_stream_parser.error() ? m_stream_parser.error() : "invalid document");
+    }
+    if (!ok || complete) {
+        ESP_LOGI(TAG, "Config stream done: %u widgets, largest item %u bytes",
+                 (unsigned)m_stream_parser.widgetCount(), (unsigned)m_stream_parser.peakItemSize());
+        m_stream_open = false;
+        if (ok) {
+            closeStreamTemplates();
+            logTemplates(m_stream_templates_us);
+            m_applied_widget_ids.swap(m_stream_widget_ids);
+            m_applied_widget_generation = m_stream_generation;
+        } else {
+            m_applied_widget_ids.clear();
+            m_templates.abortLoad();
+        }
+        resetStreamPage();
+        m_stream_widget_ids.clear();
+        sendStreamCommand(StreamCommand::End, "", nullptr, ok, m_stream_crc, total);
+    }
+}
+
+bool ConfigManager::filterStreamWidget(const char* text, size_t len) {
+    closeStreamTemplates();
+    uint64_t id = (static_cast<uint64_t>(len) << 32) | esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(text), len);
+    size_t index = m_stream_widget_ids.size();
+    m_stream_widget_ids.push_back(id);
+    if (!m_stream_can_keep || index >= m_applied_widget_ids.size() || m_applied_widget_ids[index] != id) {
+        return true;  // New or changed: parse it
+    }
+    // Same text at the same position as in the applied document: keep the widget without parsing it
+    return !sendStreamCommand(StreamCommand::Keep, "", nullptr, false, index);
+}
+
+bool ConfigManager::streamPage(ConfigStreamParser::PageEvent event, const std::string& key, cJSON* item) {
+    using PageEvent = ConfigStreamParser::PageEvent;
+    switch (event) {
+        case PageEvent::Begin:
+            closeStreamTemplates();
+            resetStreamPage();
+            m_stream_page_fields = cJSON_CreateObject();
+            return true;
+
+        case PageEvent::Field:
+            if (key == "widgets") {
+                cJSON_Delete(item);  // Not an array; the page is skipped when it ends
+            } else {
+                cJSON_AddItemToObject(m_stream_page_fields, key.c_str(), item);
+            }
+            return true;
+
+        case PageEvent::Widgets:
+            m_stream_page_has_widgets = true;
+            return true;
+
+        case PageEvent::Widget: {
+            int64_t start_us = esp_timer_get_time();
+            item = m_templates.expand(item);
+            m_stream_templates_us += esp_timer_get_time() - start_us;
+            if (!item) {
+                ESP_LOGE(TAG, "Template expansion failed in page '%s': %s",
+                         stringField(m_stream_page_fields, "id").c_str(), m_templates.error().c_str());
+                return false;
+            }
+            // Kept as text until the page is built
+            char* text = cJSON_PrintUnformatted(item);
+            cJSON_Delete(item);
+            if (!text) {
+                ESP_LOGE(TAG, "Out of memory for page '%s'", stringField(m_stream_page_fields, "id").c_str());
+                return false;
+            }
+            m_stream_page_widgets += m_stream_page_widgets.empty() ? '[' : ',';
+            m_stream_page_widgets += text;
+            cJSON_free(text);
+            return true;
+        }
+
+        case PageEvent::End:
+            break;
+    }
+
+    std::string id = stringField(m_stream_page_fields, "id");
+    if (id.empty() || !m_stream_page_has_widgets) {
+        ESP_LOGE(TAG, "Page needs an 'id' and a 'widgets' array, skipped");
+        resetStreamPage();
+        return true;
+    }
+    char* fields = cJSON_PrintUnformatted(m_stream_page_fields);
+    if (!fields) {
+        ESP_LOGE(TAG, "Out of memory for page '%s'", id.c_str());
+        return false;
+    }
+    // {<fields>,"widgets":[...]}
+    StreamCommand* command = new StreamCommand{StreamCommand::Page, id};
+    command->text = fields;
+    cJSON_free(fields);
+    command->text.pop_back();
+    if (command->text.size() > 1) {
+        command->text += ',';
+    }
+    command->text += "\"widgets\":";
+    command->text += m_stream_page_widgets.empty() ? "[" : m_stream_page_widgets;
+    command->text += "]}";
+    resetStreamPage();
+    return pushStreamCommand(command);
+}
+
+void ConfigManager::resetStreamPage() {
+    cJSON_Delete(m_stream_page_fields);
+    m_stream_page_fields = nullptr;
+    std::string().swap(m_stream_page_widgets);
+    m_stream_page_has_widgets = false;
+}
+
+bool ConfigManager::sendStreamCommand(StreamCommand::Kind kind, const std::string& key, cJSON* item, bool ok,
+                                      uint32_t value, size_t size) {
+    return pushStreamCommand(new StreamCommand{kind, key, item, ok, value, size});
+}
+
+bool ConfigManager::pushStreamCommand(StreamCommand* command) {
+    // Blocks while the HMI task catches up, which throttles the config task instead of buffering
+    TickType_t wait = command->kind == StreamCommand::End ? pdMS_TO_TICKS(30000) : pdMS_TO_TICKS(5000);
+    if (xQueueSend(m_stream_queue, &command, wait) != pdTRUE) {
+        ESP_LOGE(TAG, "Config stream stalled, HMI task not consuming");
+        cJSON_Delete(command->item);
+        delete command;
+        return false;
+    }
+    return true;
+}
+
+void ConfigManager::handleStreamCommand(StreamCommand& command) {
+    switch (command.kind) {
+        case StreamCommand::Begin:
+            beginStream(command.value);
+            break;
+
+        case StreamCommand::Field:
+            if (!m_stream.active) {
+                break;
+            }
+            if (command.key == "version") {
+                if (cJSON_IsNumber(command.item)) {
+                    m_stream.version = command.item->valueint;
+                }
+            } else if (command.key == "reconcile" && cJSON_IsBool(command.item)) {
+                if (cJSON_IsFalse(command.item) && !m_stream.widgets_started) {
+                    // Full rebuild: nothing is matched, the previous widgets stay up until the swap
+                    m_stream.full_rebuild = true;
+                    for (auto& node : m_stream.old_nodes) {
+                        m_stream.replaced.push_back(std::move(node));
+                    }
+                    m_stream.old_nodes.clear();
+                    m_stream.old_index.clear();
+                    m_stream.used.clear();
+                } else if (cJSON_IsFalse(command.item)) {
+                    ESP_LOGW(TAG, "\"reconcile\" must precede \"widgets\" in a streamed config, ignored");
+                }
+            } else if (command.key == "widgets") {
+                ESP_LOGE(TAG, "'widgets' field is not an array (type: %d)", command.item->type);
+                m_stream.invalid = true;
+            } else if (command.key == "pages" || command.key == "start_page" || command.key == "page_cache" ||
+                       command.key == "page_topic") {
+                // Pages may reference nothing of the root widgets, but are switched to once all are applied
+                if (!m_stream.page_fields) {
+                    m_stream.page_fields = cJSON_CreateObject();
+                }
+                cJSON_AddItemToObject(m_stream.page_fields, command.key.c_str(), command.item);
+                command.item = nullptr;
+            }
+            break;
+
+        case StreamCommand::Widget:
+            if (m_stream.active && !m_stream.invalid) {
+                streamWidget(command.item);
+            }
+            break;
+
+        case StreamCommand::Page:
+            if (m_stream.active) {
+                m_stream.pages.push_back({command.key, std::move(command.text)});
+            }
+            break;
+
+        case StreamCommand::Keep:
+            if (m_stream.active && !m_stream.invalid) {
+                keepStreamWidget(command.value);
+            }
+            break;
+
+        case StreamCommand::End:
+            if (m_stream.active) {
+                endStream(command.ok && !m_stream.invalid, command.value, command.size);
+            }
+            break;
+    }
+}
+
+void ConfigManager::beginStream(uint32_t generation) {
+    if (m_stream.active) {
+        endStream(false, 0, 0);
+    }
+
+    m_stream = StreamApply();
+    m_stream.active = true;
+    m_stream.start_us = esp_timer_get_time();
+    m_stream.keep_valid = generation == m_layout_generation.load(std::memory_order_acquire);
+    m_stream.old_nodes = std::move(m_root_nodes);
+    m_root_nodes.clear();
+    m_stream.used.assign(m_stream.old_nodes.size(), false);
+    for (size_t i = 0; i < m_stream.old_nodes.size(); i++) {
+        m_stream.old_index.emplace(m_stream.old_nodes[i].id, i);
+    }
+
+    // New and rebuilt widgets go on a screen that is not displayed; kept ones stay where they are
+    // until the document is complete, so a half-received config is never shown
+    m_stream.screen = createScreen();
+}
+
+void ConfigManager::streamWidget(cJSON* widget_json) {
+    m_stream.widgets_started = true;
+    m_stream.widget_count++;
+    if (!cJSON_IsObject(widget_json)) {
+        ESP_LOGE(TAG, "Widget JSON is not an object (type: %d)", widget_json->type);
+        return;
+    }
+
+    WidgetNode* match = nullptr;
+    auto it = m_stream.old_index.find(stringField(widget_json, "id"));
+    if (it != m_stream.old_index.end() && !m_stream.used[it->second] &&
+        m_stream.old_nodes[it->second].type == stringField(widget_json, "type")) {
+        match = &m_stream.old_nodes[it->second];
+        m_stream.used[it->second] = true;
+    }
+    reconcileOne(match, widget_json, m_stream.screen, m_root_nodes, m_stream.prev_obj, m_stream.stats, "",
+                 &m_stream.replaced);
+}
+
+void ConfigManager::keepStreamWidget(size_t index) {
+    m_stream.widgets_started = true;
+    m_stream.widget_count++;
+    if (!m_stream.keep_valid || m_stream.full_rebuild || index >= m_stream.old_nodes.size() || m_stream.used[index]) {
+        // The layout changed after the MQTT task compared against it; this widget's JSON is gone
+        ESP_LOGE(TAG, "Unchanged widget #%u is no longer applied, config must be resent", (unsigned)index);
+        m_stream.invalid = true;
+        return;
+    }
+
+    WidgetNode& node = m_stream.old_nodes[index];
+    m_stream.used[index] = true;
+    m_stream.unparsed++;
+    m_stream.stats.kept += 1 + countNodes(node.children);
+    lv_obj_t* obj = node.widget ? node.widget->getLvglObject() : nullptr;
+    if (obj && lv_obj_is_valid(obj)) {
+        m_stream.prev_obj = obj;
+    }
+    m_root_nodes.push_back(std::move(node));
+}
+
+void ConfigManager::endStream(bool ok, uint32_t crc, size_t size) {
+    int64_t elapsed_us = esp_timer_get_time() - m_stream.start_us;
+    bool unchanged = ok && m_applied_valid && crc == m_applied_crc && size == m_applied_size &&
+                     m_stream.unparsed == m_stream.widget_count &&
+                     std::find(m_stream.used.begin(), m_stream.used.end(), false) == m_stream.used.end();
+
+    if (ok) {
+        // Unlike a buffered reload, removed widgets are only known once the document ends. They
+        // leave with the previous screen and are destroyed after the swap.
+        for (size_t i = 0; i < m_stream.old_nodes.size(); i++) {
+            if (!m_stream.used[i]) {
+                m_stream.replaced.push_back(std::move(m_stream.old_nodes[i]));
+            }
+        }
+        // Kept widgets join the new ones, in document order, then the whole tree is shown at once
+        for (auto& node : m_root_nodes) {
+            lv_obj_t* obj = node.widget ? node.widget->getLvglObject() : nullptr;
+            if (!obj || !lv_obj_is_valid(obj)) {
+                continue;
+            }
+            if (lv_obj_get_parent(obj) != m_stream.screen) {
+                lv_obj_set_parent(obj, m_stream.screen);
+            }
+            lv_obj_move_foreground(obj);
+        }
+        showScreen(m_stream.screen, m_stream.replaced, m_stream.stats);
+        cJSON* pages = cJSON_GetObjectItem(m_stream.page_fields, "pages");  // Only if not an array
+        applyPages(m_stream.page_fields, pages ? pagePlans(pages) : std::move(m_stream.pages));
+        m_current_version = m_stream.version;
+    } else {
+        // Nothing of the new tree was shown yet: drop what was built off screen and keep the
+        // previous layout (widgets updated in place keep their new properties)
+        std::vector<WidgetNode> kept;
+        for (auto& node : m_root_nodes) {
+            lv_obj_t* obj = node.widget ? node.widget->getLvglObject() : nullptr;
+            if (obj && lv_obj_is_valid(obj) && lv_obj_get_parent(obj) == m_stream.screen) {
+                destroyNode(node);
+            } else {
+                kept.push_back(std::move(node));
+            }
+        }
+        lv_obj_delete(m_stream.screen);
+        m_root_nodes = std::move(kept);
+        for (auto& node : m_stream.replaced) {
+            m_root_nodes.push_back(std::move(node));
+        }
+        for (size_t i = 0; i < m_stream.old_nodes.size(); i++) {
+            if (!m_stream.used[i]) {
+                m_root_nodes.push_back(std::move(m_stream.old_nodes[i]));
+            }
+        }
+    }
+    m_stream.old_nodes.clear();
+    m_stream.replaced.clear();
+    cJSON_Delete(m_stream.page_fields);
+    m_stream.page_fields = nullptr;
+    m_stream.pages.clear();
+    m_stream.screen = nullptr;
+    m_stream.active = false;
+
+    // Index-based keeps of the next stream need one root node per widget, in document order
+    if (ok && m_root_nodes.size() == m_stream.widget_count) {
+        m_applied_valid = true;
+        m_applied_crc = crc;
+        m_applied_size = size;
+    } else {
+        invalidateAppliedConfig();
+    }
+
+    if (unchanged) {
+        uint32_t skipped = m_skipped_reloads.fetch_add(1, std::memory_order_relaxed) + 1;
+        ESP_LOGI(TAG, "Configuration unchanged (%u bytes, crc %08lx, version %d), reload skipped (%lu so far)",
+                 (unsigned)size, (unsigned long)crc, m_current_version, (unsigned long)skipped);
+        return;
+    }
+    if (m_stream.unparsed > 0) {
+        ESP_LOGI(TAG, "%u of %u streamed widgets unchanged, not parsed",
+                 (unsigned)m_stream.unparsed, (unsigned)m_stream.widget_count);
+    }
+
+    if (ok) {
+        finishApply(m_stream.stats, elapsed_us, m_stream.full_rebuild ? "streamed, full rebuild" : "streamed",
+                    false);
+    } else {
+        ESP_LOGE(TAG, "Streamed configuration incomplete after %lld ms, kept previous layout", elapsed_us / 1000);
+        settings_ui_bring_to_front();
+        status_info_bring_to_front();
+    }
+}
+
+bool ConfigManager::parseWidgets(cJSON* widgets_array, lv_obj_t* parent, std::vector<WidgetNode>& nodes, const std::string& tab) {
+    int array_size = cJSON_GetArraySize(widgets_array);
+    ESP_LOGI(TAG, "Parsing %d widgets", array_size);
+    
+    for (int i = 0; i < array_size; i++) {
+        ESP_LOGI(TAG, "Processing widget %d/%d", i+1, array_size);
+        cJSON* widget_json = cJSON_GetArrayItem(widgets_array, i);
+        if (!widget_json) {
+            ESP_LOGE(TAG, "Widget at index %d is NULL", i);
+            continue;
+        }
+        if (!createWidget(widget_json, parent, nodes, tab)) {
+            ESP_LOGW(TAG, "Failed to create widget at index %d", i);
+            // Continue with other widgets instead of failing completely
+        }
+    }
+    
+    return true;
+}
+
+HMIWidget* ConfigManager::createWidgetByType(const std::string& type, const std::string& id, int x, int y, int w, int h, cJSON* properties, lv_obj_t* parent) {
+    if (type == "label") {
+        return new LabelWidget(id, x, y, w, h, properties, parent);
+    } else if (type == "button") {
+        return new ButtonWidget(id, x, y, w, h, properties, parent);
+    } else if (type == "container") {
+        return new ContainerWidget(id, x, y, w, h, properties, parent);
+    } else if (type == "switch") {
+        return new SwitchWidget(id, x, y, w, h, properties, parent);
+    } else if (type == "slider") {
+        return new SliderWidget(id, x, y, w, h, properties, parent);
+    } else if (type == "bar") {
+        return new BarWidget(id, x, y, w, h, properties, parent);
+    } else if (type == "arc") {
+        return new ArcWidget(id, x, y, w, h, properties, parent);
+    } else if (type == "checkbox") {
+        return new CheckboxWidget(id, x, y, w, h, properties, parent);
+    } else if (type == "dropdown") {
+        return new DropdownWidget(id, x, y, w, h, properties, parent);
+    } else if (type == "led") {
+        return new LEDWidget(id, x, y, w, h, properties, parent);
+    } else if (type == "spinner") {
+        return new SpinnerWidget(id, x, y, w, h, properties, parent);
+    } else if (type == "tabview") {
+        return new TabviewWidget(id, x, y, w, h, properties, parent);
+    } else if (type == "gauge") {
+        return new GaugeWidget(id, x, y, w, h, properties, parent);
+    } else if (type == "image") {
+        return new ImageWidget(id, x, y, w, h, properties, parent);
+    } else if (type == "line_chart") {
+        return new LineChartWidget(id, x, y, w, h, properties, parent);
+    }
+    ESP_LOGE(TAG, "Unknown widget type: %s", type.c_str());
+    return nullptr;
+}
+
+bool ConfigManager::createWidget(cJSON* widget_json, lv_obj_t* parent, std::vector<WidgetNode>& nodes, const std::string& tab) {
+    if (!widget_json) {
+        ESP_LOGE(TAG, "Widget JSON is NULL");
+        return false;
+    }
+    if (!cJSON_IsObject(widget_json)) {
+        ESP_LOGE(TAG, "Widget JSON is not an object (type: %d)", widget_json->type);
+        return false;
     }
     
     // Log all fields in this widget
@@ -282,16 +1304,23 @@ bool ConfigManager::createWidget(cJSON* widget_json, lv_obj_t* parent) {
         return false;
     }
     
+    WidgetNode node;
+    node.id = id;
+    node.type = type;
+    node.tab = tab;
+    node.widget = widget;
+    node.definition = copyDefinition(widget_json);
+
     // Setup MQTT subscription if needed
     cJSON* mqtt_sub = cJSON_GetObjectItem(widget_json, "mqtt_subscribe");
     if (mqtt_sub && cJSON_IsString(mqtt_sub)) {
         std::string topic = mqtt_sub->valuestring;
         auto handle = MQTTManager::getInstance().subscribe(topic, 0, 
-            [widget](const std::string& topic, const std::string& payload) {
-                widget->onMqttMessage(topic, payload);
+            [widget](const std::string& topic, const MqttPayload& payload) {
+                widget->onMqttPayload(topic, payload);
             });
         if (handle != 0) {
-            m_config_subscriptions.push_back(handle);
+            node.subscription = handle;
             ESP_LOGV(TAG, "Widget '%s' subscribed to %s", id.c_str(), topic.c_str());
         } else {
             ESP_LOGW(TAG, "Widget '%s' failed to subscribe to %s", id.c_str(), topic.c_str());
@@ -299,57 +1328,1036 @@ bool ConfigManager::createWidget(cJSON* widget_json, lv_obj_t* parent) {
     }
     
     // Process children if present
+    createChildren(node, widget_json);
+    
+    nodes.push_back(std::move(node));
+    ESP_LOGV(TAG, "Created widget: type=%s, id=%s, pos=(%d,%d), size=(%dx%d)", 
+             type.c_str(), id.c_str(), x, y, w, h);
+    
+    return true;
+}
+
+void ConfigManager::createChildren(WidgetNode& node, cJSON* widget_json) {
     cJSON* children = cJSON_GetObjectItem(widget_json, "children");
-    if (children) {
-        // Check if this is a tabview with per-tab children (object format)
-        if (type == "tabview" && cJSON_IsObject(children)) {
-            // Safe cast since we know type is "tabview"
-            TabviewWidget* tabview = static_cast<TabviewWidget*>(widget);
-            // Iterate through each tab name and parse its children
-            for (const auto& tab_name : tabview->getTabNames()) {
-                cJSON* tab_children = cJSON_GetObjectItem(children, tab_name.c_str());
-                if (tab_children && cJSON_IsArray(tab_children)) {
-                    lv_obj_t* tab_obj = tabview->getTabByName(tab_name);
-                    if (tab_obj && lv_obj_is_valid(tab_obj)) {
-                        ESP_LOGV(TAG, "Parsing %d children for tab '%s'", 
-                                 cJSON_GetArraySize(tab_children), tab_name.c_str());
-                        parseWidgets(tab_children, tab_obj);
-                    }
+    if (node.type == "tabview" && boolProperty(node.definition, "lazy") && !cJSON_IsArray(children)) {
+        setupLazyTabs(node, children);
+        return;
+    }
+    if (!children) {
+        return;
+    }
+
+    // Check if this is a tabview with per-tab children (object format)
+    if (node.type == "tabview" && cJSON_IsObject(children)) {
+        // Safe cast since we know type is "tabview"
+        TabviewWidget* tabview = static_cast<TabviewWidget*>(node.widget);
+        // Iterate through each tab name and parse its children
+        for (const auto& tab_name : tabview->getTabNames()) {
+            cJSON* tab_children = cJSON_GetObjectItem(children, tab_name.c_str());
+            if (tab_children && cJSON_IsArray(tab_children)) {
+                lv_obj_t* tab_obj = tabview->getTabByName(tab_name);
+                if (tab_obj && lv_obj_is_valid(tab_obj)) {
+                    ESP_LOGV(TAG, "Parsing %d children for tab '%s'", 
+                             cJSON_GetArraySize(tab_children), tab_name.c_str());
+                    parseWidgets(tab_children, tab_obj, node.children, tab_name);
                 }
             }
         }
-        // Standard array-based children for containers and other widgets
-        else if (cJSON_IsArray(children)) {
-            int child_count = cJSON_GetArraySize(children);
-            ESP_LOGV(TAG, "Widget '%s' has %d children, parsing recursively...", id.c_str(), child_count);
-            lv_obj_t* parent_obj = widget->getLvglObject();
-            if (parent_obj && lv_obj_is_valid(parent_obj)) {
-                ESP_LOGV(TAG, "Parent LVGL object is valid, creating children");
-                parseWidgets(children, parent_obj);
+    }
+    // Standard array-based children for containers and other widgets
+    else if (cJSON_IsArray(children)) {
+        int child_count = cJSON_GetArraySize(children);
+        ESP_LOGV(TAG, "Widget '%s' has %d children, parsing recursively...", node.id.c_str(), child_count);
+        lv_obj_t* parent_obj = node.widget->getLvglObject();
+        if (parent_obj && lv_obj_is_valid(parent_obj)) {
+            ESP_LOGV(TAG, "Parent LVGL object is valid, creating children");
+            parseWidgets(children, parent_obj, node.children);
+        } else {
+            ESP_LOGE(TAG, "Widget '%s' has invalid LVGL object, cannot create children", node.id.c_str());
+        }
+    }
+}
+
+void ConfigManager::reconcileWidgets(cJSON* widgets_array, lv_obj_t* parent, std::vector<WidgetNode>& nodes,
+                                     ReloadStats& stats, const std::string& tab) {
+    // Index the previously applied widgets by id
+    std::map<std::string, size_t> old_index;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        old_index.emplace(nodes[i].id, i);
+    }
+
+    // Match new definitions against old widgets of the same id + type
+    int array_size = widgets_array ? cJSON_GetArraySize(widgets_array) : 0;
+    std::vector<int> matches(array_size, -1);
+    std::vector<bool> used(nodes.size(), false);
+    for (int i = 0; i < array_size; i++) {
+        cJSON* widget_json = cJSON_GetArrayItem(widgets_array, i);
+        if (!widget_json || !cJSON_IsObject(widget_json)) {
+            continue;
+        }
+        auto it = old_index.find(stringField(widget_json, "id"));
+        if (it != old_index.end() && !used[it->second] &&
+            nodes[it->second].type == stringField(widget_json, "type")) {
+            matches[i] = static_cast<int>(it->second);
+            used[it->second] = true;
+        }
+    }
+
+    // Destroy widgets that are gone before creating new ones to keep peak memory low
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (!used[i]) {
+            ESP_LOGV(TAG, "Removing widget '%s'", nodes[i].id.c_str());
+            destroyNode(nodes[i], &stats);
+        }
+    }
+
+    std::vector<WidgetNode> result;
+    result.reserve(array_size);
+    lv_obj_t* prev_obj = nullptr;
+    for (int i = 0; i < array_size; i++) {
+        cJSON* widget_json = cJSON_GetArrayItem(widgets_array, i);
+        if (!widget_json) {
+            continue;
+        }
+        reconcileOne(matches[i] >= 0 ? &nodes[matches[i]] : nullptr, widget_json, parent, result, prev_obj, stats, tab);
+    }
+
+    nodes = std::move(result);
+}
+
+// Keep, update or rebuild one matched widget (or create a new one) and append it to result
+void ConfigManager::reconcileOne(WidgetNode* match, cJSON* widget_json, lv_obj_t* parent, std::vector<WidgetNode>& result,
+                                 lv_obj_t*& prev_obj, ReloadStats& stats, const std::string& tab,
+                                 std::vector<WidgetNode>* replaced) {
+    if (match) {
+        if (updateWidget(*match, widget_json, stats)) {
+            lv_obj_t* obj = match->widget ? match->widget->getLvglObject() : nullptr;
+            if (obj && lv_obj_is_valid(obj)) {
+                prev_obj = obj;
+            }
+            result.push_back(std::move(*match));
+            return;
+        }
+        // Could not update in place: rebuild at the same position
+        if (replaced) {
+            replaced->push_back(std::move(*match));
+        } else {
+            destroyNode(*match, &stats);
+        }
+    }
+
+    size_t before = result.size();
+    if (createWidget(widget_json, parent, result, tab)) {
+        stats.created += 1 + countNodes(result[before].children);
+        prev_obj = placeAfter(result[before].widget, prev_obj);
+    } else {
+        ESP_LOGW(TAG, "Failed to create widget '%s'", stringField(widget_json, "id").c_str());
+    }
+}
+
+bool ConfigManager::updateWidget(WidgetNode& node, cJSON* widget_json, ReloadStats& stats) {
+    if (sameExcept(node.definition, widget_json, nullptr)) {
+        stats.kept++;
+        reconcileChildren(node, widget_json, stats);
+        return true;
+    }
+
+    // Only properties changed: let the widget apply them in place if it can
+    if (!sameExcept(node.definition, widget_json, "properties")) {
+        return false;
+    }
+    cJSON* old_props = cJSON_GetObjectItem(node.definition, "properties");
+    cJSON* new_props = cJSON_GetObjectItem(widget_json, "properties");
+    if (!old_props || !new_props || !cJSON_IsObject(old_props) || !cJSON_IsObject(new_props)) {
+        return false;
+    }
+    cJSON* changed = changedProperties(old_props, new_props);
+    if (!changed) {
+        return false;
+    }
+    bool applied = node.widget->applyProperties(changed);
+    cJSON_Delete(changed);
+    if (!applied) {
+        return false;
+    }
+
+    ESP_LOGV(TAG, "Updated widget '%s' in place", node.id.c_str());
+    cJSON_Delete(node.definition);
+    node.definition = copyDefinition(widget_json);
+    stats.updated++;
+    reconcileChildren(node, widget_json, stats);
+    return true;
+}
+
+void ConfigManager::reconcileChildren(WidgetNode& node, cJSON* widget_json, ReloadStats& stats) {
+    cJSON* children = cJSON_GetObjectItem(widget_json, "children");
+
+    if (node.type == "tabview" && !cJSON_IsArray(children)) {
+        TabviewWidget* tabview = static_cast<TabviewWidget*>(node.widget);
+        bool per_tab = children && cJSON_IsObject(children);
+        bool lazy = boolProperty(node.definition, "lazy");
+
+        // Children of tabs that no longer exist are destroyed below
+        std::vector<WidgetNode> result;
+        std::map<std::string, LazyTab> lazy_tabs;
+        for (const auto& tab_name : tabview->getTabNames()) {
+            std::vector<WidgetNode> tab_nodes;
+            for (auto& child : node.children) {
+                if (child.widget && child.tab == tab_name) {
+                    tab_nodes.push_back(std::move(child));
+                    child.widget = nullptr;
+                }
+            }
+            cJSON* tab_children = per_tab ? cJSON_GetObjectItem(children, tab_name.c_str()) : nullptr;
+            if (tab_children && !cJSON_IsArray(tab_children)) {
+                tab_children = nullptr;
+            }
+            lv_obj_t* tab_obj = tabview->getTabByName(tab_name);
+            if (!tab_obj || !lv_obj_is_valid(tab_obj)) {
+                tab_children = nullptr;
+            }
+            if (lazy) {
+                auto it = node.lazy_tabs.find(tab_name);
+                LazyTab& entry = lazy_tabs[tab_name];
+                if (it != node.lazy_tabs.end()) {
+                    entry = std::move(it->second);
+                    node.lazy_tabs.erase(it);
+                }
+                if (!entry.built) {
+                    // Not shown yet: the new children only replace the plan
+                    setTabPlan(entry, tab_children ? cJSON_Duplicate(tab_children, true) : nullptr);
+                    tab_children = nullptr;
+                }
+            }
+            reconcileWidgets(tab_children, tab_obj, tab_nodes, stats, tab_name);
+            for (auto& child : tab_nodes) {
+                result.push_back(std::move(child));
+            }
+        }
+        for (auto& child : node.children) {
+            if (child.widget) {
+                destroyNode(child, &stats);
+            }
+        }
+        node.children = std::move(result);
+        if (lazy) {
+            // Plans of tabs that were removed
+            for (auto& entry : node.lazy_tabs) {
+                releaseTabPlan(entry.second);
+            }
+            node.lazy_tabs = std::move(lazy_tabs);
+            showLazyTabs(node, lv_tabview_get_tab_active(node.widget->getLvglObject()));
+        }
+        return;
+    }
+
+    lv_obj_t* parent_obj = node.widget->getLvglObject();
+    if (!children || !cJSON_IsArray(children) || !parent_obj || !lv_obj_is_valid(parent_obj)) {
+        children = nullptr;
+    }
+    reconcileWidgets(children, parent_obj, node.children, stats);
+}
+
+void ConfigManager::destroyNode(WidgetNode& node, ReloadStats* stats) {
+    // Children first: deleting the parent LVGL object would free theirs
+    for (auto& child : node.children) {
+        destroyNode(child, stats);
+    }
+    node.children.clear();
+    for (auto& entry : node.lazy_tabs) {
+        releaseTabPlan(entry.second);
+    }
+    node.lazy_tabs.clear();
+
+    if (node.subscription != 0) {
+        MQTTManager::getInstance().unsubscribe(node.subscription);
+        node.subscription = 0;
+    }
+    if (stats) {
+        stats->destroyed++;
+        if (node.type == "image") {
+            stats->image_destroyed = true;
+        }
+    }
+    delete node.widget;
+    node.widget = nullptr;
+    cJSON_Delete(node.definition);
+    node.definition = nullptr;
+}
+
+size_t ConfigManager::countNodes(const std::vector<WidgetNode>& nodes) {
+    size_t count = nodes.size();
+    for (const auto& node : nodes) {
+        count += countNodes(node.children);
+    }
+    return count;
+}
+
+void ConfigManager::setupLazyTabs(WidgetNode& node, cJSON* children) {
+    TabviewWidget* tabview = static_cast<TabviewWidget*>(node.widget);
+    for (const auto& tab_name : tabview->getTabNames()) {
+        cJSON* tab_children = cJSON_GetObjectItem(children, tab_name.c_str());
+        setTabPlan(node.lazy_tabs[tab_name], cJSON_IsArray(tab_children) ? cJSON_Duplicate(tab_children, true) : nullptr);
+    }
+    tabview->setTabActivatedCallback([this, id = node.id](uint32_t index) { activateTab(id, index); });
+    showLazyTabs(node, lv_tabview_get_tab_active(node.widget->getLvglObject()));
+}
+
+void ConfigManager::activateTab(const std::string& tabview_id, uint32_t index) {
+    // Widgets of a reload in progress may still be waiting to be matched
+    NodeLocation location;
+    bool found = findNode(m_root_nodes, nullptr, tabview_id, location) ||
+                 findNode(m_stream.old_nodes, nullptr, tabview_id, location);
+    for (size_t i = 0; !found && i < m_pages.size(); i++) {
+        found = findNode(m_pages[i]->nodes, nullptr, tabview_id, location);
+    }
+    if (found) {
+        showLazyTabs((*location.siblings)[location.index], index);
+    }
+}
+
+void ConfigManager::showLazyTabs(WidgetNode& node, uint32_t index) {
+    const auto& names = static_cast<TabviewWidget*>(node.widget)->getTabNames();
+    if (index >= names.size()) {
+        return;
+    }
+    node.lazy_tabs[names[index]].visited_us = esp_timer_get_time();
+    evictTabs(node, index);
+
+    uint32_t prefetch = std::max(intProperty(node.definition, "prefetch", 0), 0);
+    uint32_t first = index > prefetch ? index - prefetch : 0;
+    uint32_t last = std::min<uint32_t>(index + prefetch, names.size() - 1);
+    MQTTManager::getInstance().beginBatch();
+    buildTab(node, names[index]);
+    for (uint32_t i = first; i <= last; i++) {
+        buildTab(node, names[i]);
+    }
+    MQTTManager::getInstance().endBatch();
+}
+
+void ConfigManager::buildTab(WidgetNode& node, const std::string& tab) {
+    LazyTab& entry = node.lazy_tabs[tab];
+    if (entry.built) {
+        return;
+    }
+    entry.built = true;
+    if (!entry.plan) {
+        return;
+    }
+
+    lv_obj_t* tab_obj = static_cast<TabviewWidget*>(node.widget)->getTabByName(tab);
+    if (tab_obj && lv_obj_is_valid(tab_obj)) {
+        int64_t start_us = esp_timer_get_time();
+        size_t before = countNodes(node.children);
+        parseWidgets(entry.plan, tab_obj, node.children, tab);
+        int64_t elapsed_us = esp_timer_get_time() - start_us;
+        ESP_LOGI(TAG, "Built tab '%s' of '%s' in %lld.%03lld ms (%u widgets)", tab.c_str(), node.id.c_str(),
+                 elapsed_us / 1000, elapsed_us % 1000, (unsigned)(countNodes(node.children) - before));
+    }
+    // After building, so the topics never lose their last subscriber in between
+    releaseTabPlan(entry);
+}
+
+void ConfigManager::evictTabs(WidgetNode& node, uint32_t index) {
+    int evict_after_s = intProperty(node.definition, "evict_after", 0);
+    if (evict_after_s <= 0 || heap_caps_get_free_size(MALLOC_CAP_INTERNAL) >= LAZY_TAB_LOW_HEAP) {
+        return;
+    }
+
+    const auto& names = static_cast<TabviewWidget*>(node.widget)->getTabNames();
+    uint32_t prefetch = std::max(intProperty(node.definition, "prefetch", 0), 0);
+    int64_t now_us = esp_timer_get_time();
+    for (uint32_t i = 0; i < names.size(); i++) {
+        LazyTab& entry = node.lazy_tabs[names[i]];
+        uint32_t distance = i > index ? i - index : index - i;
+        if (!entry.built || distance <= prefetch || now_us - entry.visited_us < evict_after_s * 1000000LL) {
+            continue;
+        }
+
+        // Back to a plan of what is applied now, including patches; subscribed before the widgets go
+        cJSON* plan = cJSON_CreateArray();
+        std::vector<WidgetNode> kept;
+        std::vector<WidgetNode> evicted;
+        for (auto& child : node.children) {
+            if (child.tab == names[i]) {
+                cJSON_AddItemToArray(plan, nodeToJson(child));
+                evicted.push_back(std::move(child));
             } else {
-                ESP_LOGE(TAG, "Widget '%s' has invalid LVGL object, cannot create children", id.c_str());
+                kept.push_back(std::move(child));
             }
         }
+        node.children = std::move(kept);
+        entry.built = false;
+        setTabPlan(entry, plan);
+        size_t count = countNodes(evicted);
+        for (auto& child : evicted) {
+            destroyNode(child);
+        }
+        ESP_LOGI(TAG, "Evicted tab '%s' of '%s' (%u widgets, not shown for %lld s)", names[i].c_str(),
+                 node.id.c_str(), (unsigned)count, (now_us - entry.visited_us) / 1000000);
     }
-    
-    m_active_widgets.push_back(widget);
-    ESP_LOGV(TAG, "Created widget: type=%s, id=%s, pos=(%d,%d), size=(%dx%d)", 
-             type.c_str(), id.c_str(), x, y, w, h);
-    
+}
+
+void ConfigManager::setTabPlan(LazyTab& lazy, cJSON* plan) {
+    // Subscribe before releasing the previous handles so shared topics stay subscribed
+    std::vector<MQTTManager::SubscriptionHandle> previous = std::move(lazy.warm);
+    lazy.warm.clear();
+    std::set<std::string> topics;
+    collectTopics(plan, topics);
+    for (const auto& topic : topics) {
+        auto handle = MQTTManager::getInstance().subscribe(topic, 0, [](const std::string&, const MqttPayload&) {});
+        if (handle != 0) {
+            lazy.warm.push_back(handle);
+        }
+    }
+    for (auto handle : previous) {
+        MQTTManager::getInstance().unsubscribe(handle);
+    }
+    cJSON_Delete(lazy.plan);
+    lazy.plan = plan;
+}
+
+void ConfigManager::releaseTabPlan(LazyTab& lazy) {
+    for (auto handle : lazy.warm) {
+        MQTTManager::getInstance().unsubscribe(handle);
+    }
+    lazy.warm.clear();
+    cJSON_Delete(lazy.plan);
+    lazy.plan = nullptr;
+}
+
+bool ConfigManager::buildTabContaining(std::vector<WidgetNode>& nodes, const std::string& id) {
+    for (auto& node : nodes) {
+        for (auto& entry : node.lazy_tabs) {
+            if (entry.second.plan && planHasId(entry.second.plan, id)) {
+                buildTab(node, entry.first);
+                return true;
+            }
+        }
+        if (buildTabContaining(node.children, id)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ConfigManager::applyPages(cJSON* fields, std::vector<PagePlan> plans) {
+    std::string topic = stringField(fields, "page_topic");
+    if (topic != m_page_topic) {
+        if (m_page_subscription != 0) {
+            MQTTManager::getInstance().unsubscribe(m_page_subscription);
+            m_page_subscription = 0;
+        }
+        m_page_topic = topic;
+        if (!m_page_topic.empty()) {
+            m_page_subscription = MQTTManager::getInstance().subscribe(m_page_topic, 0,
+                [this](const std::string&, const MqttPayload& payload) {
+                    if (xSemaphoreTake(m_config_mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+                        m_requested_page = payload.str();
+                        m_page_requested_us = esp_timer_get_time();
+                        m_page_requested = true;
+                        xSemaphoreGive(m_config_mutex);
+                    }
+                }, MQTTManager::DeliveryClass::Config);
+        }
+    }
+
+    cJSON* cache = cJSON_GetObjectItem(fields, "page_cache");
+    m_page_cache = cJSON_IsNumber(cache) && cache->valueint > 0 ? cache->valueint : DEFAULT_PAGE_CACHE;
+    m_start_page = stringField(fields, "start_page");
+
+    if (plans.empty()) {
+        clearPages();
+        return;
+    }
+
+    std::vector<std::unique_ptr<Page>> old_pages = std::move(m_pages);
+    m_pages.clear();
+    for (PagePlan& plan : plans) {
+        if (findPage(plan.id)) {
+            ESP_LOGW(TAG, "Duplicate page '%s', skipped", plan.id.c_str());
+            continue;
+        }
+
+        // An unchanged page keeps its built screen
+        auto old = std::find_if(old_pages.begin(), old_pages.end(),
+                                [&plan](const std::unique_ptr<Page>& page) { return page && page->id == plan.id; });
+        if (old != old_pages.end() && (*old)->plan == plan.text) {
+            m_pages.push_back(std::move(*old));
+            continue;
+        }
+        auto page = std::make_unique<Page>();
+        page->id = std::move(plan.id);
+        page->plan = std::move(plan.text);
+        m_pages.push_back(std::move(page));
+    }
+    for (auto& page : old_pages) {
+        if (page) {
+            unloadPage(*page);
+        }
+    }
+    if (m_pages.empty()) {
+        clearPages();
+        return;
+    }
+    m_page_history.erase(std::remove_if(m_page_history.begin(), m_page_history.end(),
+                                        [this](const std::string& id) { return !findPage(id); }),
+                         m_page_history.end());
+
+    // Stay on the current page if it still exists
+    Page* current = findPage(m_current_page);
+    if (current && current->screen && lv_screen_active() == current->screen) {
+        attachRootWidgets(current->screen);
+        return;
+    }
+    std::string start = current ? m_current_page : m_start_page;
+    if (!findPage(start)) {
+        start = m_pages.front()->id;
+    }
+    switchPage(start, esp_timer_get_time(), false);
+}
+
+std::vector<ConfigManager::PagePlan> ConfigManager::pagePlans(cJSON* pages) {
+    std::vector<PagePlan> plans;
+    if (!cJSON_IsArray(pages)) {
+        return plans;
+    }
+    cJSON* page_json = nullptr;
+    cJSON_ArrayForEach(page_json, pages) {
+        std::string id = stringField(page_json, "id");
+        if (id.empty() || !cJSON_IsArray(cJSON_GetObjectItem(page_json, "widgets"))) {
+            ESP_LOGE(TAG, "Page needs an 'id' and a 'widgets' array, skipped");
+            continue;
+        }
+        char* text = cJSON_PrintUnformatted(page_json);
+        if (!text) {
+            ESP_LOGE(TAG, "Out of memory for page '%s', skipped", id.c_str());
+            continue;
+        }
+        plans.push_back({id, text});
+        cJSON_free(text);
+    }
+    return plans;
+}
+
+void ConfigManager::clearPages() {
+    if (m_pages.empty()) {
+        return;
+    }
+
+    // The shared widgets need a screen that outlives the pages
+    if (isPageScreen(lv_screen_active())) {
+        lv_obj_t* screen = createScreen();
+        attachRootWidgets(screen);
+        lv_screen_load(screen);
+    }
+    for (auto& page : m_pages) {
+        unloadPage(*page);
+    }
+    m_pages.clear();
+    m_current_page.clear();
+    m_page_history.clear();
+}
+
+bool ConfigManager::showPage(const std::string& target) {
+    return switchPage(target, esp_timer_get_time(), false);
+}
+
+bool ConfigManager::switchPage(const std::string& target, int64_t requested_us, bool from_mqtt) {
+    if (m_pages.empty()) {
+        ESP_LOGW(TAG, "No pages configured, cannot show '%s'", target.c_str());
+        return false;
+    }
+
+    std::string id = target;
+    bool back = target == "back";
+    if (back) {
+        if (m_page_history.empty()) {
+            return false;
+        }
+        id = m_page_history.back();
+        m_page_history.pop_back();
+    } else if (target == "next" || target == "prev") {
+        size_t index = 0;
+        for (size_t i = 0; i < m_pages.size(); i++) {
+            if (m_pages[i]->id == m_current_page) {
+                index = i;
+                break;
+            }
+        }
+        size_t count = m_pages.size();
+        id = m_pages[(target == "next" ? index + 1 : index + count - 1) % count]->id;
+    }
+
+    Page* page = findPage(id);
+    if (!page) {
+        ESP_LOGW(TAG, "Unknown page '%s'", id.c_str());
+        return false;
+    }
+
+    // Built off screen, so the previous page stays up until the load
+    bool built = false;
+    if (!page->screen) {
+        page->screen = createScreen();
+        cJSON* plan = cJSON_ParseWithLength(page->plan.data(), page->plan.size());
+        MQTTManager::getInstance().beginBatch();
+        parseWidgets(cJSON_GetObjectItem(plan, "widgets"), page->screen, page->nodes);
+        MQTTManager::getInstance().endBatch();
+        cJSON_Delete(plan);
+        built = true;
+    }
+
+    lv_obj_t* previous = lv_screen_active();
+    attachRootWidgets(page->screen);
+    if (previous != page->screen) {
+        lv_screen_load(page->screen);
+        // The root screen of a config without pages, or a page that was removed
+        if (previous && !isPageScreen(previous)) {
+            retireScreen(previous);
+        }
+    }
+
+    bool changed = id != m_current_page;
+    if (changed) {
+        if (!back && !m_current_page.empty()) {
+            m_page_history.push_back(m_current_page);
+            if (m_page_history.size() > MAX_PAGE_HISTORY) {
+                m_page_history.erase(m_page_history.begin());
+            }
+        }
+        m_current_page = id;
+        if (!from_mqtt && !m_page_topic.empty()) {
+            MQTTManager::getInstance().publish(m_page_topic, id, 0, false);
+        }
+    }
+    page->shown_us = esp_timer_get_time();
+    evictPages();
+
+    int64_t latency_us = esp_timer_get_time() - requested_us;
+    m_page_stats.switches++;
+    m_page_stats.builds += built ? 1 : 0;
+    m_page_stats.total_switch_us += latency_us;
+    m_page_stats.max_switch_us = std::max(m_page_stats.max_switch_us, latency_us);
+    ESP_LOGI(TAG, "Page '%s' shown in %lld.%03lld ms (%s, %u widgets, %u of %u pages built)", id.c_str(),
+             latency_us / 1000, latency_us % 1000, built ? "built" : "cached", (unsigned)countNodes(page->nodes),
+             (unsigned)std::count_if(m_pages.begin(), m_pages.end(), [](const auto& p) { return p->screen != nullptr; }),
+             (unsigned)m_pages.size());
     return true;
 }
 
+ConfigManager::Page* ConfigManager::findPage(const std::string& id) {
+    for (auto& page : m_pages) {
+        if (page->id == id) {
+            return page.get();
+        }
+    }
+    return nullptr;
+}
+
+bool ConfigManager::isPageScreen(lv_obj_t* screen) const {
+    return std::any_of(m_pages.begin(), m_pages.end(),
+                       [screen](const std::unique_ptr<Page>& page) { return page->screen == screen; });
+}
+
+void ConfigManager::unloadPage(Page& page) {
+    // Destroyed over the next polls; the page may be unloaded from one of its own buttons
+    for (auto& node : page.nodes) {
+        m_retired_nodes.push_back(std::move(node));
+    }
+    page.nodes.clear();
+    if (page.screen) {
+        retireScreen(page.screen);
+        page.screen = nullptr;
+    }
+}
+
+void ConfigManager::evictPages() {
+    while (true) {
+        size_t built = 0;
+        Page* oldest = nullptr;
+        for (auto& page : m_pages) {
+            if (!page->screen) {
+                continue;
+            }
+            built++;
+            if (page->id != m_current_page && (!oldest || page->shown_us < oldest->shown_us)) {
+                oldest = page.get();
+            }
+        }
+        if (built <= m_page_cache || !oldest) {
+            return;
+        }
+        ESP_LOGI(TAG, "Unloading page '%s' (%u widgets), least recently shown", oldest->id.c_str(),
+                 (unsigned)countNodes(oldest->nodes));
+        unloadPage(*oldest);
+        m_page_stats.evictions++;
+    }
+}
+
+void ConfigManager::attachRootWidgets(lv_obj_t* screen) {
+    // Shared widgets follow the page and stay above its content
+    for (auto& node : m_root_nodes) {
+        lv_obj_t* obj = node.widget ? node.widget->getLvglObject() : nullptr;
+        if (!obj || !lv_obj_is_valid(obj)) {
+            continue;
+        }
+        if (lv_obj_get_parent(obj) != screen) {
+            lv_obj_set_parent(obj, screen);
+        }
+        lv_obj_move_foreground(obj);
+    }
+}
+
+bool ConfigManager::findNode(std::vector<WidgetNode>& nodes, WidgetNode* parent, const std::string& id,
+                             NodeLocation& location) {
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (nodes[i].id == id) {
+            location.siblings = &nodes;
+            location.index = i;
+            location.parent = parent;
+            return true;
+        }
+        if (findNode(nodes[i].children, &nodes[i], id, location)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+lv_obj_t* ConfigManager::parentObject(WidgetNode* parent, const std::string& tab) {
+    if (!parent) {
+        return nullptr;  // Active screen
+    }
+    if (parent->type == "tabview" && !tab.empty()) {
+        return static_cast<TabviewWidget*>(parent->widget)->getTabByName(tab);
+    }
+    return parent->widget->getLvglObject();
+}
+
+cJSON* ConfigManager::nodeToJson(const WidgetNode& node) {
+    cJSON* json = cJSON_Duplicate(node.definition, true);
+    bool has_plans = std::any_of(node.lazy_tabs.begin(), node.lazy_tabs.end(),
+                                 [](const auto& entry) { return entry.second.plan != nullptr; });
+    if (node.children.empty() && !has_plans) {
+        return json;
+    }
+
+    bool per_tab = node.type == "tabview" && (has_plans || !node.children.front().tab.empty());
+    cJSON* children = per_tab ? cJSON_CreateObject() : cJSON_CreateArray();
+    auto tabList = [children](const std::string& tab) {
+        cJSON* list = cJSON_GetObjectItemCaseSensitive(children, tab.c_str());
+        if (!list) {
+            list = cJSON_CreateArray();
+            cJSON_AddItemToObject(children, tab.c_str(), list);
+        }
+        return list;
+    };
+    for (const auto& child : node.children) {
+        cJSON_AddItemToArray(per_tab ? tabList(child.tab) : children, nodeToJson(child));
+    }
+    // Tabs of a lazy tabview that are not built keep their definition as a plan
+    for (const auto& entry : node.lazy_tabs) {
+        cJSON* item = nullptr;
+        cJSON_ArrayForEach(item, entry.second.plan) {
+            cJSON_AddItemToArray(tabList(entry.first), cJSON_Duplicate(item, true));
+        }
+    }
+    cJSON_AddItemToObject(json, "children", children);
+    return json;
+}
+
+bool ConfigManager::patchWidget(const std::string& id, cJSON* patch, ReloadStats& stats) {
+    NodeLocation location;
+    if (!findNode(m_root_nodes, nullptr, id, location) && !buildTabContaining(m_root_nodes, id)) {
+        // A page widget, or a new widget added under one. The plan is patched so the page is
+        // rebuilt with it after an unload, and a built page is patched in place as well.
+        std::string parent_id = cJSON_IsObject(patch) ? stringField(patch, "parent") : "";
+        Page* page = findPlanPage(id);
+        if (!page && !parent_id.empty() && !findNode(m_root_nodes, nullptr, parent_id, location) &&
+            !buildTabContaining(m_root_nodes, parent_id)) {
+            page = findPlanPage(parent_id);
+        }
+        if (page) {
+            if (!patchPagePlan(*page, id, patch)) {
+                return false;
+            }
+            return !page->screen || patchNodes(page->nodes, page->screen, id, patch, stats);
+        }
+    }
+    return patchNodes(m_root_nodes, nullptr, id, patch, stats);
+}
+
+ConfigManager::Page* ConfigManager::findPlanPage(const std::string& id) {
+    for (auto& page : m_pages) {
+        cJSON* plan = cJSON_ParseWithLength(page->plan.data(), page->plan.size());
+        bool has_id = planHasId(cJSON_GetObjectItem(plan, "widgets"), id);
+        cJSON_Delete(plan);
+        if (has_id) {
+            return page.get();
+        }
+    }
+    return nullptr;
+}
+
+bool ConfigManager::patchPagePlan(Page& page, const std::string& id, cJSON* patch) {
+    cJSON* plan = cJSON_ParseWithLength(page.plan.data(), page.plan.size());
+    cJSON* widgets = cJSON_GetObjectItem(plan, "widgets");
+    cJSON* siblings = nullptr;
+    cJSON* widget = findPlanWidget(widgets, id, &siblings);
+
+    bool success = true;
+    if (cJSON_IsNull(patch)) {
+        if (widget) {
+            cJSON_Delete(cJSON_DetachItemViaPointer(siblings, widget));
+        } else {
+            ESP_LOGW(TAG, "Patch removes unknown widget '%s'", id.c_str());
+            success = false;
+        }
+    } else if (!cJSON_IsObject(patch)) {
+        ESP_LOGE(TAG, "Patch for widget '%s' is not an object", id.c_str());
+        success = false;
+    } else if (widget) {
+        std::string new_id = stringField(patch, "id");
+        if (!new_id.empty() && new_id != id) {
+            ESP_LOGE(TAG, "Patch cannot rename widget '%s' to '%s'", id.c_str(), new_id.c_str());
+            success = false;
+        } else {
+            cJSON_ReplaceItemViaPointer(siblings, widget, mergePatch(cJSON_Duplicate(widget, true), patch));
+        }
+    } else {
+        // New widget appended to its parent's children (or to the list of its tab)
+        std::string parent_id = stringField(patch, "parent");
+        std::string tab = stringField(patch, "tab");
+        cJSON* parent = findPlanWidget(widgets, parent_id, &siblings);
+        cJSON* children = cJSON_GetObjectItem(parent, "children");
+        if (parent && !children) {
+            children = tab.empty() ? cJSON_CreateArray() : cJSON_CreateObject();
+            cJSON_AddItemToObject(parent, "children", children);
+        }
+        if (!tab.empty() && cJSON_IsObject(children)) {
+            cJSON* list = cJSON_GetObjectItemCaseSensitive(children, tab.c_str());
+            if (!list) {
+                list = cJSON_CreateArray();
+                cJSON_AddItemToObject(children, tab.c_str(), list);
+            }
+            children = list;
+        }
+        if (cJSON_IsArray(children)) {
+            cJSON* widget_json = cJSON_Duplicate(patch, true);
+            cJSON_DeleteItemFromObjectCaseSensitive(widget_json, "parent");
+            cJSON_DeleteItemFromObjectCaseSensitive(widget_json, "tab");
+            if (!cJSON_GetObjectItem(widget_json, "id")) {
+                cJSON_AddStringToObject(widget_json, "id", id.c_str());
+            }
+            cJSON_AddItemToArray(children, widget_json);
+        } else {
+            ESP_LOGE(TAG, "Patch adds '%s' to invalid parent '%s'", id.c_str(), parent_id.c_str());
+            success = false;
+        }
+    }
+
+    if (success) {
+        char* text = cJSON_PrintUnformatted(plan);
+        page.plan = text;
+        cJSON_free(text);
+    }
+    cJSON_Delete(plan);
+    return success;
+}
+
+bool ConfigManager::patchNodes(std::vector<WidgetNode>& nodes, lv_obj_t* screen, const std::string& id,
+                               cJSON* patch, ReloadStats& stats) {
+    NodeLocation location;
+    bool found = findNode(nodes, nullptr, id, location);
+    if (!found && buildTabContaining(nodes, id)) {
+        // The widget is on a lazy tab that was not shown yet
+        found = findNode(nodes, nullptr, id, location);
+    }
+
+    // null: remove the widget and its children
+    if (cJSON_IsNull(patch)) {
+        if (!found) {
+            ESP_LOGW(TAG, "Patch removes unknown widget '%s'", id.c_str());
+            return false;
+        }
+        destroyNode((*location.siblings)[location.index], &stats);
+        location.siblings->erase(location.siblings->begin() + location.index);
+        return true;
+    }
+    if (!cJSON_IsObject(patch)) {
+        ESP_LOGE(TAG, "Patch for widget '%s' is not an object", id.c_str());
+        return false;
+    }
+
+    // Unknown id: add a new widget, appended on top of its parent
+    if (!found) {
+        WidgetNode* parent = nullptr;
+        std::string parent_id = stringField(patch, "parent");
+        if (!parent_id.empty()) {
+            NodeLocation parent_location;
+            if (!findNode(nodes, nullptr, parent_id, parent_location) &&
+                !(buildTabContaining(nodes, parent_id) && findNode(nodes, nullptr, parent_id, parent_location))) {
+                ESP_LOGE(TAG, "Patch adds '%s' to unknown parent '%s'", id.c_str(), parent_id.c_str());
+                return false;
+            }
+            parent = &(*parent_location.siblings)[parent_location.index];
+        }
+        std::string tab = stringField(patch, "tab");
+        lv_obj_t* parent_obj = parent ? parentObject(parent, tab) : screen;
+        if (parent && (!parent_obj || !lv_obj_is_valid(parent_obj))) {
+            ESP_LOGE(TAG, "Patch adds '%s' to invalid parent '%s'", id.c_str(), parent_id.c_str());
+            return false;
+        }
+
+        cJSON* widget_json = cJSON_Duplicate(patch, true);
+        cJSON_DeleteItemFromObjectCaseSensitive(widget_json, "parent");
+        cJSON_DeleteItemFromObjectCaseSensitive(widget_json, "tab");
+        if (!cJSON_GetObjectItem(widget_json, "id")) {
+            cJSON_AddStringToObject(widget_json, "id", id.c_str());
+        }
+        std::vector<WidgetNode>& siblings = parent ? parent->children : nodes;
+        bool created = createWidget(widget_json, parent_obj, siblings, parent ? tab : "");
+        if (created) {
+            stats.created += 1 + countNodes(siblings.back().children);
+        }
+        cJSON_Delete(widget_json);
+        return created;
+    }
+
+    // Known id: merge into the applied definition and update or rebuild in place
+    std::string new_id = stringField(patch, "id");
+    if (!new_id.empty() && new_id != id) {
+        ESP_LOGE(TAG, "Patch cannot rename widget '%s' to '%s'", id.c_str(), new_id.c_str());
+        return false;
+    }
+
+    std::vector<WidgetNode>& siblings = *location.siblings;
+    WidgetNode& node = siblings[location.index];
+    std::string tab = node.tab;
+    lv_obj_t* parent_obj = location.parent ? parentObject(location.parent, tab) : screen;
+    cJSON* merged = mergePatch(nodeToJson(node), patch);
+
+    bool success = true;
+    if (!updateWidget(node, merged, stats)) {
+        destroyNode(node, &stats);
+        std::vector<WidgetNode> rebuilt;
+        if (createWidget(merged, parent_obj, rebuilt, tab)) {
+            stats.created += 1 + countNodes(rebuilt.front().children);
+            // Restore stacking order after the previous sibling on the same parent
+            lv_obj_t* prev_obj = nullptr;
+            for (size_t i = location.index; i > 0; i--) {
+                if (siblings[i - 1].tab == tab) {
+                    prev_obj = siblings[i - 1].widget->getLvglObject();
+                    break;
+                }
+            }
+            placeAfter(rebuilt.front().widget, prev_obj);
+            node = std::move(rebuilt.front());
+        } else {
+            ESP_LOGE(TAG, "Failed to rebuild patched widget '%s'", id.c_str());
+            siblings.erase(siblings.begin() + location.index);
+            success = false;
+        }
+    }
+
+    cJSON_Delete(merged);
+    return success;
+}
+
+void ConfigManager::invalidateAppliedConfig() {
+    m_applied_valid = false;
+    m_layout_generation.fetch_add(1, std::memory_order_release);
+}
+
 void ConfigManager::destroyAllWidgets() {
-    ESP_LOGV(TAG, "Destroying %d widgets", m_active_widgets.size());
+    ESP_LOGV(TAG, "Destroying %d widgets", countNodes(m_root_nodes));
+    invalidateAppliedConfig();
+    clearPages();
 
-    for (auto handle : m_config_subscriptions) {
-        MQTTManager::getInstance().unsubscribe(handle);
+    // Widgets of an interrupted stream that were not matched yet
+    for (size_t i = 0; i < m_stream.old_nodes.size(); i++) {
+        if (!m_stream.used[i]) {
+            destroyNode(m_stream.old_nodes[i]);
+        }
     }
-    m_config_subscriptions.clear();
-    
-    for (HMIWidget* widget : m_active_widgets) {
-        delete widget;
+    m_stream.old_nodes.clear();
+    for (auto& node : m_stream.replaced) {
+        destroyNode(node);
+    }
+    m_stream.replaced.clear();
+
+    for (auto& node : m_root_nodes) {
+        destroyNode(node);
     }
     
-    m_active_widgets.clear();
+    m_root_nodes.clear();
+
+    // An off-screen build in progress is empty now
+    if (m_stream.screen) {
+        lv_obj_delete(m_stream.screen);
+        m_stream.screen = nullptr;
+    }
+    for (auto& node : m_retired_nodes) {
+        destroyNode(node);
+    }
+    m_retired_nodes.clear();
+    for (lv_obj_t* screen : m_retired_screens) {
+        lv_obj_delete(screen);
+    }
+    m_retired_screens.clear();
+}
+
+lv_obj_t* ConfigManager::createScreen() {
+    lv_obj_t* active = lv_screen_active();
+    lv_obj_t* screen = lv_obj_create(nullptr);
+    lv_obj_set_style_bg_color(screen, lv_obj_get_style_bg_color(active, LV_PART_MAIN), LV_PART_MAIN);
+    lv_obj_set_style_bg_opa(screen, lv_obj_get_style_bg_opa(active, LV_PART_MAIN), LV_PART_MAIN);
+    return screen;
+}
+
+void ConfigManager::showScreen(lv_obj_t* screen, std::vector<WidgetNode>& old_nodes, ReloadStats& stats) {
+    lv_obj_t* old_screen = lv_screen_active();
+    lv_screen_load(screen);
+
+    stats.destroyed += countNodes(old_nodes);
+    for (auto& node : old_nodes) {
+        m_retired_nodes.push_back(std::move(node));
+    }
+    old_nodes.clear();
+    // A page's screen stays with the page; applyPages shows one again
+    if (old_screen && old_screen != screen && !isPageScreen(old_screen)) {
+        retireScreen(old_screen);
+    }
+}
+
+void ConfigManager::retireScreen(lv_obj_t* screen) {
+    if (std::find(m_retired_screens.begin(), m_retired_screens.end(), screen) == m_retired_screens.end()) {
+        m_retired_screens.push_back(screen);
+    }
+}
+
+bool ConfigManager::retireWidgets(int64_t deadline_us) {
+    if (m_retired_nodes.empty() && m_retired_screens.empty()) {
+        return false;
+    }
+
+    // At least one widget per poll, more while the budget lasts
+    while (!m_retired_nodes.empty()) {
+        destroyNode(m_retired_nodes.back());
+        m_retired_nodes.pop_back();
+        if (esp_timer_get_time() >= deadline_us) {
+            break;
+        }
+    }
+
+    if (m_retired_nodes.empty()) {
+        for (lv_obj_t* screen : m_retired_screens) {
+            lv_obj_delete(screen);
+        }
+        m_retired_screens.clear();
+        // Drop LVGL image cache to avoid stale cached images after reload
+        lv_image_cache_drop(nullptr);
+        ESP_LOGI(TAG, "Previous screen torn down");
+    }
+    return true;
 }
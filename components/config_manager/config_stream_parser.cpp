@@ -0,0 +1,390 @@
+#include "config_stream_parser.h"
+
+static constexpr size_t MAX_KEY_LENGTH = 256;
+static constexpr size_t RETAIN_ITEM_CAPACITY = 64 * 1024;
+
+ConfigStreamParser::ConfigStreamParser(WidgetCallback on_widget, FieldCallback on_field, size_t max_item_size)
+    : m_on_widget(std::move(on_widget)), m_on_field(std::move(on_field)), m_max_item(max_item_size),
+      m_next_max_item(max_item_size) {}
+
+void ConfigStreamParser::reset() {
+    m_max_item = m_next_max_item;
+    m_phase = Phase::RootStart;
+    m_context = Context::Root;
+    m_after_comma = false;
+    m_key.clear();
+    m_capture = Capture::None;
+    std::string().swap(m_item);
+    m_depth = 0;
+    m_in_string = false;
+    m_escape = false;
+    m_error = nullptr;
+    m_widgets_seen = false;
+    m_widget_count = 0;
+    m_peak_item = 0;
+}
+
+bool ConfigStreamParser::feed(const char* data, size_t len) {
+    if (m_error) {
+        return false;
+    }
+
+    size_t i = 0;
+    while (i < len) {
+        // Fast path: copy whole runs of a captured object/array, only tracking nesting
+        if (m_capture == Capture::Container) {
+            size_t start = i;
+            bool closed = false;
+            for (; i < len; i++) {
+                char c = data[i];
+                if (m_in_string) {
+                    if (m_escape) {
+                        m_escape = false;
+                    } else if (c == '\\') {
+                        m_escape = true;
+                    } else if (c == '"') {
+                        m_in_string = false;
+                    }
+                } else if (c == '"') {
+                    m_in_string = true;
+                } else if (c == '{' || c == '[') {
+                    m_depth++;
+                } else if ((c == '}' || c == ']') && --m_depth == 0) {
+                    i++;
+                    closed = true;
+                    break;
+                }
+            }
+            m_item.append(data + start, i - start);
+            if (m_item.size() > m_max_item) {
+                return fail("item exceeds size limit");
+            }
+            if (closed && !endCapture()) {
+                return false;
+            }
+            continue;
+        }
+
+        if (!step(data[i])) {
+            return false;
+        }
+        i++;
+    }
+    return true;
+}
+
+bool ConfigStreamParser::finish() {
+    if (m_error) {
+        return false;
+    }
+    if (m_capture == Capture::Literal && !endCapture()) {
+        return false;
+    }
+    if (m_phase != Phase::Done) {
+        return fail("truncated document");
+    }
+    return true;
+}
+
+bool ConfigStreamParser::step(char c) {
+    switch (m_capture) {
+        case Capture::String:
+            m_item.push_back(c);
+            if (m_escape) {
+                m_escape = false;
+            } else if (c == '\\') {
+                m_escape = true;
+            } else if (c == '"') {
+                return endCapture();
+            }
+            if (m_item.size() > m_max_item) {
+                return fail("item exceeds size limit");
+            }
+            return true;
+
+        case Capture::Literal:
+            // Numbers and true/false/null end at the next delimiter, which is structural
+            if (isSpace(c) || c == ',' || c == '}' || c == ']') {
+                if (!endCapture()) {
+                    return false;
+                }
+                return structural(c);
+            }
+            m_item.push_back(c);
+            if (m_item.size() > 64) {
+                return fail("invalid literal");
+            }
+            return true;
+
+        default:
+            break;
+    }
+
+    if (m_phase == Phase::Key) {
+        if (m_key_escape) {
+            m_key_escape = false;
+        } else if (c == '\\') {
+            m_key_escape = true;
+            m_key_escaped = true;
+        } else if (c == '"') {
+            if (m_key_escaped) {
+                // Rare: let cJSON resolve the escapes
+                std::string quoted = "\"" + m_key + "\"";
+                cJSON* unescaped = cJSON_Parse(quoted.c_str());
+                if (!cJSON_IsString(unescaped)) {
+                    cJSON_Delete(unescaped);
+                    return fail("invalid key");
+                }
+                m_key = unescaped->valuestring;
+                cJSON_Delete(unescaped);
+            }
+            m_phase = Phase::Colon;
+            return true;
+        }
+        m_key.push_back(c);
+        if (m_key.size() > MAX_KEY_LENGTH) {
+            return fail("key too long");
+        }
+        return true;
+    }
+
+    return structural(c);
+}
+
+bool ConfigStreamParser::structural(char c) {
+    if (isSpace(c)) {
+        return true;
+    }
+
+    switch (m_phase) {
+        case Phase::RootStart:
+            if (c != '{') {
+                return fail("expected '{' at document start");
+            }
+            m_phase = Phase::ObjectKey;
+            m_after_comma = false;
+            return true;
+
+        case Phase::ObjectKey:
+            if (c == '"') {
+                m_key.clear();
+                m_key_escaped = false;
+                m_key_escape = false;
+                m_phase = Phase::Key;
+                return true;
+            }
+            if (c == '}' && !m_after_comma) {
+                return closeObject();
+            }
+            return fail("expected key");
+
+        case Phase::Colon:
+            if (c != ':') {
+                return fail("expected ':'");
+            }
+            m_phase = Phase::Value;
+            return true;
+
+        case Phase::Value:
+            return value(c);
+
+        case Phase::ObjectNext:
+            if (c == ',') {
+                m_phase = Phase::ObjectKey;
+                m_after_comma = true;
+                return true;
+            }
+            if (c == '}') {
+                return closeObject();
+            }
+            return fail("expected ',' or '}'");
+
+        case Phase::WidgetsElement:
+            if (c == ']' && !m_after_comma) {
+                m_phase = Phase::ObjectNext;
+                return true;
+            }
+            beginCapture(c, true);
+            return m_error == nullptr;
+
+        case Phase::WidgetsNext:
+            if (c == ',') {
+                m_phase = Phase::WidgetsElement;
+                m_after_comma = true;
+                return true;
+            }
+            if (c == ']') {
+                m_phase = Phase::ObjectNext;
+                return true;
+            }
+            return fail("expected ',' or ']' in widgets");
+
+        case Phase::PagesElement:
+            if (c == ']' && !m_after_comma) {
+                m_phase = Phase::ObjectNext;
+                return true;
+            }
+            if (c != '{') {
+                return fail("page is not an object");
+            }
+            m_context = Context::Page;
+            m_phase = Phase::ObjectKey;
+            m_after_comma = false;
+            if (!m_on_page(PageEvent::Begin, "", nullptr)) {
+                return fail("aborted by page consumer");
+            }
+            return true;
+
+        case Phase::PagesNext:
+            if (c == ',') {
+                m_phase = Phase::PagesElement;
+                m_after_comma = true;
+                return true;
+            }
+            if (c == ']') {
+                m_phase = Phase::ObjectNext;
+                return true;
+            }
+            return fail("expected ',' or ']' in pages");
+
+        case Phase::Done:
+            return fail("trailing data after document");
+
+        default:
+            return fail("unexpected character");
+    }
+}
+
+bool ConfigStreamParser::value(char c) {
+    if (m_key == "widgets" && c == '[' && m_context != Context::Templates) {
+        m_phase = Phase::WidgetsElement;
+        m_after_comma = false;
+        if (m_context == Context::Root) {
+            m_widgets_seen = true;
+        } else if (!m_on_page(PageEvent::Widgets, m_key, nullptr)) {
+            return fail("aborted by page consumer");
+        }
+        return true;
+    }
+    if (m_context == Context::Root && m_key == "pages" && c == '[' && m_on_page) {
+        m_phase = Phase::PagesElement;
+        m_after_comma = false;
+        return true;
+    }
+    if (m_context == Context::Root && m_key == "templates" && c == '{' && m_on_template) {
+        m_context = Context::Templates;
+        m_phase = Phase::ObjectKey;
+        m_after_comma = false;
+        return true;
+    }
+    beginCapture(c, false);
+    return m_error == nullptr;
+}
+
+bool ConfigStreamParser::closeObject() {
+    switch (m_context) {
+        case Context::Root:
+            m_phase = Phase::Done;
+            return true;
+
+        case Context::Page:
+            m_context = Context::Root;
+            m_phase = Phase::PagesNext;
+            if (!m_on_page(PageEvent::End, "", nullptr)) {
+                return fail("aborted by page consumer");
+            }
+            return true;
+
+        case Context::Templates:
+            m_context = Context::Root;
+            m_phase = Phase::ObjectNext;
+            if (!m_on_template("", nullptr)) {
+                return fail("aborted by template consumer");
+            }
+            return true;
+    }
+    return fail("unexpected character");
+}
+
+void ConfigStreamParser::beginCapture(char c, bool widget) {
+    m_item.clear();
+    m_item.push_back(c);
+    m_capture_widget = widget;
+    m_in_string = false;
+    m_escape = false;
+    if (c == '{' || c == '[') {
+        m_capture = Capture::Container;
+        m_depth = 1;
+    } else if (c == '"') {
+        m_capture = Capture::String;
+    } else if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n') {
+        m_capture = Capture::Literal;
+    } else {
+        fail("unexpected character in value");
+    }
+}
+
+bool ConfigStreamParser::endCapture() {
+    if (m_item.size() > m_peak_item) {
+        m_peak_item = m_item.size();
+    }
+    // Only root widgets are matched against the applied layout
+    bool root_widget = m_capture_widget && m_context == Context::Root;
+    bool parse = !root_widget || !m_widget_filter || m_widget_filter(m_item.data(), m_item.size());
+    cJSON* item = parse ? cJSON_ParseWithLength(m_item.data(), m_item.size()) : nullptr;
+    // Do not keep a large widget's buffer alive for the rest of the document
+    if (m_item.capacity() > RETAIN_ITEM_CAPACITY) {
+        std::string().swap(m_item);
+    } else {
+        m_item.clear();
+    }
+    m_capture = Capture::None;
+
+    if (!parse) {
+        m_widget_count++;
+        m_phase = Phase::WidgetsNext;
+        return true;
+    }
+    if (!item) {
+        return fail(m_capture_widget ? "invalid widget JSON" : "invalid field JSON");
+    }
+    return deliver(item, m_capture_widget);
+}
+
+bool ConfigStreamParser::deliver(cJSON* item, bool widget) {
+    m_phase = widget ? Phase::WidgetsNext : Phase::ObjectNext;
+    switch (m_context) {
+        case Context::Root:
+            if (widget) {
+                m_widget_count++;
+                if (!m_on_widget(item)) {
+                    return fail("aborted by widget consumer");
+                }
+            } else if (!m_on_field(m_key, item)) {
+                return fail("aborted by field consumer");
+            }
+            return true;
+
+        case Context::Page:
+            if (!m_on_page(widget ? PageEvent::Widget : PageEvent::Field, m_key, item)) {
+                return fail("aborted by page consumer");
+            }
+            return true;
+
+        case Context::Templates:
+            if (!m_on_template(m_key, item)) {
+                return fail("aborted by template consumer");
+            }
+            return true;
+    }
+    cJSON_Delete(item);
+    return fail("unexpected item");
+}
+
+bool ConfigStreamParser::fail(const char* error) {
+    if (!m_error) {
+        m_error = error;
+    }
+    m_capture = Capture::None;
+    return false;
+}
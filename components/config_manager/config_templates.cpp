@@ -0,0 +1,319 @@
+#include "config_templates.h"
+
+#include <cstring>
+
+// Set or replace an object member
+static void setField(cJSON* object, const char* key, cJSON* value) {
+    if (cJSON_GetObjectItemCaseSensitive(object, key)) {
+        cJSON_ReplaceItemInObjectCaseSensitive(object, key, value);
+    } else {
+        cJSON_AddItemToObject(object, key, value);
+    }
+}
+
+static bool isKey(const cJSON* item, const char* key) {
+    return item->string && strcmp(item->string, key) == 0;
+}
+
+bool ConfigTemplates::load(cJSON* templates, bool* changed) {
+    if (changed) {
+        *changed = false;
+    }
+    if (templates && !cJSON_IsObject(templates)) {
+        m_error.clear();
+        return fail("'templates' must be an object keyed by template name");
+    }
+    beginLoad();
+    for (cJSON* definition = templates ? templates->child : nullptr; definition; definition = definition->next) {
+        if (!add(definition->string, cJSON_Duplicate(definition, true))) {
+            abortLoad();
+            return false;
+        }
+    }
+    endLoad(changed);
+    return true;
+}
+
+void ConfigTemplates::beginLoad() {
+    m_error.clear();
+    m_compiled = 0;
+    m_instances = 0;
+    m_loading.clear();
+}
+
+bool ConfigTemplates::add(const std::string& name, cJSON* definition) {
+    if (!cJSON_IsObject(definition)) {
+        cJSON_Delete(definition);
+        return fail("template '" + name + "' is not a widget object");
+    }
+    auto old = m_templates.find(name);
+    if (old != m_templates.end() && cJSON_Compare(old->second->definition, definition, true)) {
+        m_loading[name] = old->second;
+        cJSON_Delete(definition);
+        return true;
+    }
+
+    auto tpl = std::make_shared<Template>();
+    tpl->name = name;
+    tpl->definition = definition;
+    cJSON* defaults = cJSON_GetObjectItemCaseSensitive(tpl->definition, "params");
+    tpl->defaults = cJSON_IsObject(defaults) ? defaults : nullptr;
+    compile(*tpl, tpl->definition);
+    tpl->dynamic.insert(tpl->definition);  // Always rebuilt: "params" is left out
+    m_loading[name] = std::move(tpl);
+    m_compiled++;
+    return true;
+}
+
+void ConfigTemplates::endLoad(bool* changed) {
+    // Changed if anything was compiled or a template was removed from the config
+    bool differs = m_compiled > 0 || m_loading.size() != m_templates.size();
+    m_templates = std::move(m_loading);
+    m_loading.clear();
+    if (changed) {
+        *changed = differs;
+    }
+}
+
+void ConfigTemplates::abortLoad() {
+    m_loading.clear();
+    m_compiled = 0;
+}
+
+void ConfigTemplates::clear() {
+    m_templates.clear();
+    m_loading.clear();
+    m_compiled = 0;
+    m_instances = 0;
+}
+
+cJSON* ConfigTemplates::expand(cJSON* widget) {
+    return expandWidget(widget, 0);
+}
+
+bool ConfigTemplates::expandArray(cJSON* widgets) {
+    return expandArray(widgets, 0);
+}
+
+bool ConfigTemplates::compile(Template& tpl, const cJSON* item) {
+    bool dynamic = false;
+    if (cJSON_IsString(item) && strstr(item->valuestring, "${")) {
+        std::vector<Piece> pieces = split(item->valuestring);
+        for (const Piece& piece : pieces) {
+            dynamic = dynamic || piece.param;
+        }
+        if (dynamic) {
+            tpl.strings.emplace(item, std::move(pieces));
+        }
+    } else if (cJSON_IsArray(item) || cJSON_IsObject(item)) {
+        for (const cJSON* child = item->child; child; child = child->next) {
+            if (item == tpl.definition && isKey(child, "params")) {
+                continue;
+            }
+            if (isKey(child, "template")) {
+                tpl.nested = true;
+            }
+            dynamic = compile(tpl, child) || dynamic;
+        }
+    }
+    if (dynamic) {
+        tpl.dynamic.insert(item);
+    }
+    return dynamic;
+}
+
+std::vector<ConfigTemplates::Piece> ConfigTemplates::split(const char* text) {
+    std::vector<Piece> pieces;
+    std::string literal;
+    const char* p = text;
+    while (*p) {
+        const char* open = strstr(p, "${");
+        const char* close = open ? strchr(open + 2, '}') : nullptr;
+        if (!close) {
+            literal += p;  // No (complete) reference left
+            break;
+        }
+        literal.append(p, open - p);
+        if (!literal.empty()) {
+            pieces.push_back({false, std::move(literal)});
+            literal.clear();
+        }
+        pieces.push_back({true, std::string(open + 2, close - open - 2)});
+        p = close + 1;
+    }
+    if (!literal.empty()) {
+        pieces.push_back({false, std::move(literal)});
+    }
+    return pieces;
+}
+
+cJSON* ConfigTemplates::lookup(const Scope& scope, const std::string& name) {
+    if (name == "id") {
+        return scope.id;
+    }
+    cJSON* value = scope.params ? cJSON_GetObjectItemCaseSensitive(scope.params, name.c_str()) : nullptr;
+    if (!value && scope.tpl->defaults) {
+        value = cJSON_GetObjectItemCaseSensitive(scope.tpl->defaults, name.c_str());
+    }
+    return value;
+}
+
+cJSON* ConfigTemplates::expandWidget(cJSON* widget, int depth) {
+    if (!cJSON_IsObject(widget)) {
+        return widget;
+    }
+    if (cJSON_GetObjectItemCaseSensitive(widget, "template")) {
+        cJSON* stamped = instantiate(widget, depth);
+        cJSON_Delete(widget);
+        return stamped;
+    }
+    if (!expandChildren(widget, depth)) {
+        cJSON_Delete(widget);
+        return nullptr;
+    }
+    return widget;
+}
+
+bool ConfigTemplates::expandChildren(cJSON* widget, int depth) {
+    cJSON* children = cJSON_GetObjectItemCaseSensitive(widget, "children");
+    if (cJSON_IsArray(children)) {
+        return expandArray(children, depth);
+    }
+    if (cJSON_IsObject(children)) {
+        // Tabview: an array of widgets per tab
+        for (cJSON* tab = children->child; tab; tab = tab->next) {
+            if (cJSON_IsArray(tab) && !expandArray(tab, depth)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool ConfigTemplates::expandArray(cJSON* widgets, int depth) {
+    cJSON* item = widgets ? widgets->child : nullptr;
+    while (item) {
+        cJSON* next = item->next;
+        if (cJSON_IsObject(item) && cJSON_GetObjectItemCaseSensitive(item, "template")) {
+            cJSON* stamped = instantiate(item, depth);
+            if (!stamped) {
+                return false;
+            }
+            cJSON_ReplaceItemViaPointer(widgets, item, stamped);
+        } else if (cJSON_IsObject(item) && !expandChildren(item, depth)) {
+            return false;
+        }
+        item = next;
+    }
+    return true;
+}
+
+cJSON* ConfigTemplates::instantiate(cJSON* instance, int depth) {
+    if (depth >= MAX_NESTING) {
+        fail("templates nested more than " + std::to_string(MAX_NESTING) + " deep");
+        return nullptr;
+    }
+    cJSON* name = cJSON_GetObjectItemCaseSensitive(instance, "template");
+    if (!cJSON_IsString(name)) {
+        fail("'template' must be a template name");
+        return nullptr;
+    }
+    auto it = m_templates.find(name->valuestring);
+    if (it == m_templates.end()) {
+        fail("unknown template '" + std::string(name->valuestring) + "'");
+        return nullptr;
+    }
+    cJSON* id = cJSON_GetObjectItemCaseSensitive(instance, "id");
+    if (!cJSON_IsString(id) || id->valuestring[0] == '\0') {
+        fail("instance of template '" + it->first + "' needs an 'id'");
+        return nullptr;
+    }
+
+    cJSON* params = cJSON_GetObjectItemCaseSensitive(instance, "params");
+    Scope scope{it->second.get(), cJSON_IsObject(params) ? params : nullptr, id};
+    cJSON* widget = stamp(scope, scope.tpl->definition);
+    if (!widget) {
+        return nullptr;
+    }
+
+    // The instance's own fields win; "properties" is merged so one property can be overridden
+    for (cJSON* field = instance->child; field; field = field->next) {
+        if (!field->string || isKey(field, "template") || isKey(field, "params")) {
+            continue;
+        }
+        cJSON* properties = cJSON_GetObjectItemCaseSensitive(widget, "properties");
+        if (isKey(field, "properties") && cJSON_IsObject(field) && cJSON_IsObject(properties)) {
+            for (cJSON* property = field->child; property; property = property->next) {
+                setField(properties, property->string, cJSON_Duplicate(property, true));
+            }
+            continue;
+        }
+        setField(widget, field->string, cJSON_Duplicate(field, true));
+    }
+    m_instances++;
+    return scope.tpl->nested ? expandWidget(widget, depth + 1) : widget;
+}
+
+cJSON* ConfigTemplates::stamp(const Scope& scope, const cJSON* item) {
+    const Template& tpl = *scope.tpl;
+    if (tpl.dynamic.count(item) == 0) {
+        return cJSON_Duplicate(item, true);
+    }
+    auto pieces = tpl.strings.find(item);
+    if (pieces != tpl.strings.end()) {
+        return substitute(scope, pieces->second);
+    }
+
+    bool array = cJSON_IsArray(item);
+    cJSON* copy = array ? cJSON_CreateArray() : cJSON_CreateObject();
+    for (const cJSON* child = item->child; child; child = child->next) {
+        if (item == tpl.definition && isKey(child, "params")) {
+            continue;
+        }
+        cJSON* value = stamp(scope, child);
+        if (!value) {
+            cJSON_Delete(copy);
+            return nullptr;
+        }
+        if (array) {
+            cJSON_AddItemToArray(copy, value);
+        } else {
+            cJSON_AddItemToObject(copy, child->string, value);
+        }
+    }
+    return copy;
+}
+
+cJSON* ConfigTemplates::substitute(const Scope& scope, const std::vector<Piece>& pieces) {
+    std::string text;
+    for (const Piece& piece : pieces) {
+        if (!piece.param) {
+            text += piece.text;
+            continue;
+        }
+        cJSON* value = lookup(scope, piece.text);
+        if (!value) {
+            fail("template '" + scope.tpl->name + "' needs parameter '" + piece.text + "' (instance '" +
+                 scope.id->valuestring + "')");
+            return nullptr;
+        }
+        if (pieces.size() == 1) {
+            return cJSON_Duplicate(value, true);  // Whole string: keep the parameter's type
+        }
+        if (cJSON_IsString(value)) {
+            text += value->valuestring;
+        } else {
+            char* printed = cJSON_PrintUnformatted(value);
+            if (printed) {
+                text += printed;
+                cJSON_free(printed);
+            }
+        }
+    }
+    return cJSON_CreateString(text.c_str());
+}
+
+bool ConfigTemplates::fail(const std::string& error) {
+    m_error = error;
+    return false;
+}
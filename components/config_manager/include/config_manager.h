@@ -2,29 +2,91 @@
 
 #include <string>
 #include <vector>
+#include <map>
 #include <memory>
+#include <atomic>
 #include "cJSON.h"
 #include "hmi_widget.h"
 #include "mqtt_manager.h"
+#include "config_stream_parser.h"
+#include "config_templates.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "freertos/queue.h"
 
 class ConfigManager {
 public:
     static ConfigManager& getInstance();
     
-    // Queue config for application (thread-safe, called from MQTT task)
-    void queueConfig(const std::string& json_config);
+    // Page switches since boot; latency is from the request (click or MQTT message) to the screen load
+    struct PageStats {
+        uint32_t switches = 0;
+        uint32_t builds = 0;         // Switches that had to build the page
+        uint32_t evictions = 0;      // Built pages dropped from the LRU
+        int64_t max_switch_us = 0;
+        int64_t total_switch_us = 0; // Divide by switches for the average
+    };
+
+    // LVGL lock time spent applying one reload, from its first poll to the one that finished it
+    struct ReloadLockStats {
+        uint32_t polls = 0;     // processPendingConfig calls that did work for the reload
+        int64_t total_us = 0;
+        int64_t max_us = 0;     // Longest single hold; streamed configs yield after STREAM_POLL_BUDGET_US
+    };
+
+    // Queue a partial config patch (thread-safe, called from MQTT task), an RFC 7396 merge
+    // patch addressed by widget id:
+    //   {"widgets": {"<id>": {<merge patch>} | null}}
+    // null removes the widget, an unknown id with a "type" adds one (optionally
+    // under "parent" / "tab"), anything else is merged into the existing widget.
+    // Parsed and validated on the config task, after any config received before it.
+    // Patches queued before a full config are superseded by it.
+    void queuePatch(const MqttPayload& json_patch);
+    
+    // Feed one MQTT chunk of a config document (called from the MQTT task, see
+    // MQTTManager::subscribeChunks). The chunk is copied to the config task and this returns
+    // at once. There, top-level and page widgets are parsed as soon as they are complete and
+    // handed to the HMI task, so the full document is never held in RAM.
+    void streamConfigChunk(const char* data, size_t len, size_t offset, size_t total);
+
+    // Largest single item a streamed config may contain: a root or page widget including its
+    // children, a template, or any other root field. Larger items fail the config.
+    // Defaults to DEFAULT_STREAM_ITEM_SIZE; set before the config topic is subscribed.
+    void setMaxStreamItemSize(size_t bytes) { m_stream_parser.setMaxItemSize(bytes); }
+    size_t getMaxStreamItemSize() const { return m_stream_parser.maxItemSize(); }
+
+    static constexpr size_t DEFAULT_STREAM_ITEM_SIZE = 256 * 1024;
     
-    // Apply pending config if available (must be called from HMI/LVGL task)
-    void processPendingConfig();
+    // Apply pending config and patches if available (must be called from HMI/LVGL task).
+    // Returns true while a streamed config is still arriving, so the caller can poll faster.
+    bool processPendingConfig();
+
+    // Anything for processPendingConfig to do (HMI task). Lets the caller skip taking the LVGL lock.
+    bool hasPendingWork() const;
     
-    // Parse JSON configuration and create/update widgets (LVGL thread only!)
-    bool parseAndApply(const std::string& json_config);
+    // Show a page of the config's top-level "pages" by id, or "back" / "next" / "prev" (LVGL thread only!).
+    // Root "widgets" are shared by all pages and move to the page being shown.
+    bool showPage(const std::string& target);
+
+    // Id of the page on screen, empty when the config has no pages (LVGL thread)
+    const std::string& getCurrentPage() const { return m_current_page; }
+
+    // LVGL thread
+    const PageStats& getPageStats() const { return m_page_stats; }
+
+    // Build the last applied layout from the flash cache (LVGL thread only!).
+    // Called at boot before the network is up; the live config reconciles against it.
+    bool loadCachedLayout();
     
     // Get current configuration version
     int getCurrentVersion() const { return m_current_version; }
-    
+
+    // Configs skipped because they were identical to the applied one (e.g. retained
+    // config redelivered on reconnect)
+    uint32_t getSkippedReloads() const { return m_skipped_reloads.load(std::memory_order_relaxed); }
+
+    // LVGL lock hold time of the last completed config or patch (HMI task)
+    const ReloadLockStats& getLastReloadLockStats() const { return m_last_reload_lock; }
 
     // Destroy all active widgets
     void destroyAllWidgets();
@@ -34,17 +96,285 @@ private:
     ~ConfigManager();
     ConfigManager(const ConfigManager&) = delete;
     ConfigManager& operator=(const ConfigManager&) = delete;
+
+    // Tab of a lazy tabview ("lazy": true). Until the tab is first shown its children are kept
+    // as JSON, and their topics stay subscribed so the last-value cache is current when it opens.
+    struct LazyTab {
+        bool built = false;
+        cJSON* plan = nullptr;      // Children not built yet (array)
+        int64_t visited_us = 0;     // Last time the tab was shown
+        std::vector<MQTTManager::SubscriptionHandle> warm;  // No-op subscriptions for the plan's topics
+    };
+
+    // Applied widget, kept so the next config can be diffed against it
+    struct WidgetNode {
+        std::string id;
+        std::string type;
+        std::string tab;                 // Tab name when the parent is a tabview
+        HMIWidget* widget = nullptr;
+        cJSON* definition = nullptr;     // Applied widget JSON without "children"
+        MQTTManager::SubscriptionHandle subscription = 0;  // "mqtt_subscribe" handle
+        std::vector<WidgetNode> children;
+        std::map<std::string, LazyTab> lazy_tabs;          // Lazy tabview only, by tab name
+    };
+
+    struct ReloadStats {
+        int kept = 0;
+        int updated = 0;
+        int created = 0;
+        int destroyed = 0;
+        bool image_destroyed = false;
+    };
     
-    bool parseWidgets(cJSON* widgets_array, lv_obj_t* parent = nullptr);
-    bool createWidget(cJSON* widget_json, lv_obj_t* parent = nullptr);
+    bool parseWidgets(cJSON* widgets_array, lv_obj_t* parent, std::vector<WidgetNode>& nodes, const std::string& tab = "");
+    bool createWidget(cJSON* widget_json, lv_obj_t* parent, std::vector<WidgetNode>& nodes, const std::string& tab = "");
+    void createChildren(WidgetNode& node, cJSON* widget_json);
     HMIWidget* createWidgetByType(const std::string& type, const std::string& id, int x, int y, int w, int h, cJSON* properties, lv_obj_t* parent);
+
+    void reconcileWidgets(cJSON* widgets_array, lv_obj_t* parent, std::vector<WidgetNode>& nodes,
+                          ReloadStats& stats, const std::string& tab = "");
+    void reconcileChildren(WidgetNode& node, cJSON* widget_json, ReloadStats& stats);
+    bool updateWidget(WidgetNode& node, cJSON* widget_json, ReloadStats& stats);
+    // A match that has to be rebuilt is destroyed, or moved to replaced (streamed reloads) so it stays
+    // on screen until the swap
+    void reconcileOne(WidgetNode* match, cJSON* widget_json, lv_obj_t* parent, std::vector<WidgetNode>& result,
+                      lv_obj_t*& prev_obj, ReloadStats& stats, const std::string& tab,
+                      std::vector<WidgetNode>* replaced = nullptr);
+    void destroyNode(WidgetNode& node, ReloadStats* stats = nullptr);
+    static size_t countNodes(const std::vector<WidgetNode>& nodes);
+
+    // Body of processPendingConfig, run inside an MQTT subscription batch.
+    // worked is set when anything was applied during this call.
+    bool applyPending(bool& worked);
+
+    // Parse, validate and expand templates on the config task; nothing here touches LVGL or the widget tree
+    cJSON* parsePatch(const char* data, size_t len);
+    static bool hasWidgetsArray(cJSON* root);
+
+    // Streamed templates must precede the widgets and pages that use them (config task)
+    bool streamTemplate(const std::string& name, cJSON* definition);
+    void closeStreamTemplates();
+    void logTemplates(int64_t elapsed_us);
+    void clearPendingLocked();
+
+    // Apply an already parsed patch (LVGL thread); does not take ownership
+    bool applyParsedPatch(cJSON* root);
+
+    // Apply a parsed config root; configs not read from the cache are persisted to it
+    bool applyConfig(cJSON* root, bool from_cache);
+    void finishApply(const ReloadStats& stats, int64_t elapsed_us, const char* mode, bool from_cache);
+    void persistLayout();
+
+    // Page definition ({"id", "widgets"}, templates expanded) as compact JSON, parsed only
+    // while the page is built; far smaller than the parsed tree of every page
+    struct PagePlan {
+        std::string id;
+        std::string text;
+    };
+
+    // Page of the config's "pages" array. Built pages keep their own screen; the least recently
+    // shown ones beyond "page_cache" are unloaded and rebuilt from their plan when shown again.
+    struct Page {
+        std::string id;
+        std::string plan;               // PagePlan::text
+        lv_obj_t* screen = nullptr;     // nullptr while not built
+        std::vector<WidgetNode> nodes;
+        int64_t shown_us = 0;
+    };
+
+    // Apply the pages and the "start_page", "page_cache" and "page_topic" of a config root (or
+    // of the fields collected from a streamed one). Unchanged built pages are kept.
+    void applyPages(cJSON* fields, std::vector<PagePlan> plans);
+    static std::vector<PagePlan> pagePlans(cJSON* pages);
+    void clearPages();
+    bool switchPage(const std::string& target, int64_t requested_us, bool from_mqtt);
+    Page* findPage(const std::string& id);
+    bool isPageScreen(lv_obj_t* screen) const;
+    void unloadPage(Page& page);
+    void evictPages();
+    void attachRootWidgets(lv_obj_t* screen);
+    void retireScreen(lv_obj_t* screen);
+
+    // Streamed config, produced on the config task and consumed on the HMI task
+    struct StreamCommand {
+        enum Kind { Begin, Field, Widget, Page, Keep, End } kind;
+        std::string key;        // Field name, Page: page id
+        cJSON* item = nullptr;  // Field value or widget, owned by the command
+        bool ok = false;        // End: document complete and valid
+        uint32_t value = 0;     // Begin: layout generation compared against, Keep: widget index, End: document CRC
+        size_t size = 0;        // End: document size
+        std::string text;       // Page: PagePlan::text
+    };
+
+    // HMI-side state of the streamed config being applied
+    struct StreamApply {
+        bool active = false;
+        bool widgets_started = false;
+        bool full_rebuild = false;
+        bool invalid = false;
+        int version = 0;
+        std::vector<WidgetNode> old_nodes;  // Previously applied root widgets, matched by id + type
+        std::map<std::string, size_t> old_index;
+        std::vector<bool> used;
+        lv_obj_t* prev_obj = nullptr;
+        ReloadStats stats;
+        int64_t start_us = 0;
+        bool keep_valid = false;   // Layout still matches the one the config task compares against
+        size_t widget_count = 0;   // Widget and Keep commands received
+        size_t unparsed = 0;       // Widgets kept without being parsed
+        lv_obj_t* screen = nullptr;           // Off-screen build target, loaded when the document completes
+        std::vector<WidgetNode> replaced;     // Previous widgets not kept, shown until the swap
+        cJSON* page_fields = nullptr;         // Page fields, applied when the document completes
+        std::vector<PagePlan> pages;          // Likewise
+    };
+
+    bool sendStreamCommand(StreamCommand::Kind kind, const std::string& key, cJSON* item, bool ok = false,
+                           uint32_t value = 0, size_t size = 0);
+    bool pushStreamCommand(StreamCommand* command);
+
+    // Config task: a page of the streamed "pages" array, assembled widget by widget
+    bool streamPage(ConfigStreamParser::PageEvent event, const std::string& key, cJSON* item);
+    void resetStreamPage();
+    void handleStreamCommand(StreamCommand& command);
+    void beginStream(uint32_t generation);
+    void streamWidget(cJSON* widget_json);
+    void keepStreamWidget(size_t index);
+    void endStream(bool ok, uint32_t crc, size_t size);
+
+    // Config task: widget text identical to the applied one at the same index is not parsed
+    bool filterStreamWidget(const char* text, size_t len);
+
+    // The applied layout no longer matches the last streamed or parsed document (HMI task)
+    void invalidateAppliedConfig();
+
+    // Config chunks and patches, handed from the MQTT task to the config task so that
+    // parsing, and waiting for the HMI task to take the result, never hold up MQTT delivery
+    struct ConfigJob {
+        enum Kind { Chunk, Patch } kind;
+        MqttPayload data;       // Chunk bytes (copied) or patch
+        size_t offset = 0;      // Chunk: position in the document
+        size_t total = 0;       // Chunk: document size
+        bool lost = false;      // Chunk: MQTTManager abandoned the message, no data
+    };
+
+    static void config_task(void* arg);
+    void startConfigTask();
+    bool queueConfigJob(ConfigJob* job);
+    void runConfigJob(ConfigJob& job);
+    void consumeConfigChunk(const char* data, size_t len, size_t offset, size_t total);
+    void parseQueuedPatch(const MqttPayload& json_patch);
+
+    // Full rebuilds and streamed reloads are built on a screen that is not displayed and swapped in
+    // with one lv_screen_load; the previous widgets are destroyed a few at a time afterwards
+    lv_obj_t* createScreen();
+    void showScreen(lv_obj_t* screen, std::vector<WidgetNode>& old_nodes, ReloadStats& stats);
+    bool retireWidgets(int64_t deadline_us);
+
+    // Lazy tabviews: tabs are built when shown (plus "prefetch" neighbours on each side) and,
+    // with "evict_after" seconds set, turned back into plans when memory runs low
+    void setupLazyTabs(WidgetNode& node, cJSON* children);
+    void activateTab(const std::string& tabview_id, uint32_t index);
+    void showLazyTabs(WidgetNode& node, uint32_t index);
+    void buildTab(WidgetNode& node, const std::string& tab);
+    void evictTabs(WidgetNode& node, uint32_t index);
+    void setTabPlan(LazyTab& lazy, cJSON* plan);
+    void releaseTabPlan(LazyTab& lazy);
+    bool buildTabContaining(std::vector<WidgetNode>& nodes, const std::string& id);
+
+    // Position of an applied widget in the node tree
+    struct NodeLocation {
+        std::vector<WidgetNode>* siblings = nullptr;
+        size_t index = 0;
+        WidgetNode* parent = nullptr;
+    };
+
+    bool findNode(std::vector<WidgetNode>& nodes, WidgetNode* parent, const std::string& id, NodeLocation& location);
+    lv_obj_t* parentObject(WidgetNode* parent, const std::string& tab);
+    cJSON* nodeToJson(const WidgetNode& node);
+    bool patchWidget(const std::string& id, cJSON* patch, ReloadStats& stats);
+    // Patch the widgets of one tree: the root widgets (screen nullptr, the active screen) or a
+    // built page's widgets on its screen
+    bool patchNodes(std::vector<WidgetNode>& nodes, lv_obj_t* screen, const std::string& id, cJSON* patch,
+                    ReloadStats& stats);
+    // Page whose plan defines the id, and the patch applied to that plan
+    Page* findPlanPage(const std::string& id);
+    bool patchPagePlan(Page& page, const std::string& id, cJSON* patch);
     
+    static constexpr size_t MAX_PENDING_PATCHES = 32;
+    static constexpr size_t STREAM_QUEUE_DEPTH = 8;
+    static constexpr size_t CONFIG_QUEUE_DEPTH = 64;            // Jobs; chunks are at most the MQTT buffer size
+    static constexpr size_t MAX_CONFIG_BACKLOG = 512 * 1024;    // Chunk bytes not parsed yet, beyond which a config is dropped
+    static constexpr size_t STREAM_COMMANDS_PER_POLL = 16;
+    static constexpr int64_t STREAM_POLL_BUDGET_US = 8000;  // Release the LVGL lock for rendering after this
+    static constexpr size_t LAZY_TAB_LOW_HEAP = 64 * 1024;  // Free internal RAM below which lazy tabs are evicted
+    static constexpr size_t DEFAULT_PAGE_CACHE = 4;
+    static constexpr size_t MAX_PAGE_HISTORY = 16;
+
     int m_current_version;
-    std::vector<HMIWidget*> m_active_widgets;
-    std::vector<MQTTManager::SubscriptionHandle> m_config_subscriptions;
+    bool m_live_config_applied = false;
+    std::vector<WidgetNode> m_root_nodes;
+
+    // Pages (LVGL thread); m_root_nodes are shared by all of them
+    std::vector<std::unique_ptr<Page>> m_pages;
+    std::string m_current_page;
+    std::vector<std::string> m_page_history;   // For "back"
+    size_t m_page_cache = DEFAULT_PAGE_CACHE;
+    std::string m_page_topic;
+    std::string m_start_page;                  // As configured, kept for the layout cache
+    MQTTManager::SubscriptionHandle m_page_subscription = 0;
+    PageStats m_page_stats;
+
+    // Page requested over MQTT, switched to by the HMI task
+    std::string m_requested_page;               // Guarded by m_config_mutex
+    int64_t m_page_requested_us = 0;
+    std::atomic<bool> m_page_requested{false};
+
+    // Widgets and screens replaced by a swap, waiting to be destroyed (HMI task)
+    std::vector<WidgetNode> m_retired_nodes;
+    std::vector<lv_obj_t*> m_retired_screens;
     
-    // Pending config for deferred application
-    std::string m_pending_config;
-    bool m_has_pending_config;
+    // Patches for deferred application, already parsed by the config task
+    std::atomic<bool> m_has_pending_config{false};
+    std::vector<cJSON*> m_pending_patches;
     SemaphoreHandle_t m_config_mutex;
+
+    // LVGL lock accounting (HMI task)
+    ReloadLockStats m_reload_lock;
+    ReloadLockStats m_last_reload_lock;
+
+    // Config task and the chunks waiting for it
+    QueueHandle_t m_config_queue = nullptr;
+    std::atomic<size_t> m_config_backlog{0};
+    std::atomic<bool> m_config_lost{false};   // A chunk could not be queued: abandon the streamed config
+    bool m_chunks_dropped = false;            // MQTT task: the rest of the current document is discarded
+
+    // Streaming config (parser state is owned by the config task, m_stream by the HMI task)
+    ConfigStreamParser m_stream_parser;
+    bool m_stream_open = false;
+    uint32_t m_stream_crc = 0;
+    uint32_t m_stream_generation = 0;
+    bool m_stream_can_keep = false;
+    std::vector<uint64_t> m_stream_widget_ids;  // Size and CRC of each widget's text
+    bool m_stream_templates_seen = false;
+    bool m_stream_templates_closed = false;
+    int64_t m_stream_templates_us = 0;
+    cJSON* m_stream_page_fields = nullptr;  // Page being streamed: its fields other than "widgets"
+    std::string m_stream_page_widgets;      // and its expanded widgets as a JSON array without the ']'
+    bool m_stream_page_has_widgets = false;
+
+    // Templates of the last streamed config, compiled once and reused while unchanged. Only the
+    // config task touches them (streamed configs and patches), so they need no lock.
+    ConfigTemplates m_templates;
+
+    // Identity of the applied document. Widget fingerprints belong to the config task and are only
+    // trusted while m_layout_generation still equals the generation they were taken at.
+    std::vector<uint64_t> m_applied_widget_ids;
+    uint32_t m_applied_widget_generation = 0;
+    std::atomic<uint32_t> m_layout_generation{0};
+    bool m_applied_valid = false;  // HMI task
+    uint32_t m_applied_crc = 0;
+    size_t m_applied_size = 0;
+    std::atomic<uint32_t> m_skipped_reloads{0};
+    QueueHandle_t m_stream_queue = nullptr;
+    StreamApply m_stream;
 };
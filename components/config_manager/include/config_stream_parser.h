@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include "cJSON.h"
+
+// Incremental reader for config documents, fed with MQTT chunks as they arrive.
+//
+// Only the root object is tokenized here. Every element of the root "widgets"
+// array (a top-level widget including its children) and every other root field
+// is cut out as raw text, parsed on its own with cJSON and handed to a callback,
+// so memory is bounded by the largest single widget instead of the whole document.
+// With a page callback set, the objects of the root "pages" array are tokenized the
+// same way and their "widgets" handed over one by one; with a template callback set,
+// each member of the root "templates" object is.
+// Free of ESP-IDF dependencies so it can be benchmarked on the host (see tools/).
+class ConfigStreamParser {
+public:
+    // Callbacks take ownership of the parsed item; return false to abort parsing
+    using WidgetCallback = std::function<bool(cJSON* widget)>;
+    using FieldCallback = std::function<bool(const std::string& key, cJSON* value)>;
+    // Sees the raw text of each widget before it is parsed; return false to skip parsing it
+    using WidgetTextFilter = std::function<bool(const char* text, size_t len)>;
+
+    // Element of the root "pages" array, in document order: Begin, then a Field (key and value)
+    // per member of the page object, except that its "widgets" array gives Widgets followed by
+    // one Widget (item) per element, then End
+    enum class PageEvent { Begin, Field, Widgets, Widget, End };
+    using PageCallback = std::function<bool(PageEvent event, const std::string& key, cJSON* item)>;
+    // Member of the root "templates" object; called with nullptr once the object closes
+    using TemplateCallback = std::function<bool(const std::string& name, cJSON* definition)>;
+
+    ConfigStreamParser(WidgetCallback on_widget, FieldCallback on_field, size_t max_item_size = 256 * 1024);
+
+    // Start a new document
+    void reset();
+
+    // Optional; a skipped widget still counts in widgetCount() but is never handed to on_widget
+    void setWidgetTextFilter(WidgetTextFilter filter) { m_widget_filter = std::move(filter); }
+
+    // Optional; without them "pages" and "templates" are ordinary fields, captured whole
+    void setPageCallback(PageCallback on_page) { m_on_page = std::move(on_page); }
+    void setTemplateCallback(TemplateCallback on_template) { m_on_template = std::move(on_template); }
+
+    // Largest single item (widget, field, template) held while parsing; takes effect from the next reset()
+    void setMaxItemSize(size_t bytes) { m_next_max_item = bytes; }
+    size_t maxItemSize() const { return m_next_max_item; }
+
+    // Consume the next piece of the document. Returns false on a syntax error,
+    // an oversized item, or when a callback aborted.
+    bool feed(const char* data, size_t len);
+
+    // True if a complete root object has been consumed
+    bool finish();
+
+    const char* error() const { return m_error; }
+    bool hasWidgets() const { return m_widgets_seen; }
+    size_t widgetCount() const { return m_widget_count; }
+    size_t peakItemSize() const { return m_peak_item; }
+
+private:
+    enum class Phase {
+        RootStart,      // Before '{'
+        ObjectKey,      // Expecting a key or '}'
+        Key,            // Inside a key string
+        Colon,          // Expecting ':'
+        Value,          // Expecting a member value
+        ObjectNext,     // Expecting ',' or '}'
+        WidgetsElement, // Inside "widgets", expecting an element or ']'
+        WidgetsNext,    // Inside "widgets", expecting ',' or ']'
+        PagesElement,   // Inside root "pages", expecting a page object or ']'
+        PagesNext,      // Inside root "pages", expecting ',' or ']'
+        Done,           // Root closed, only whitespace allowed
+    };
+
+    // Object whose members are being tokenized
+    enum class Context { Root, Page, Templates };
+
+    enum class Capture { None, Container, String, Literal };
+
+    bool step(char c);
+    bool structural(char c);
+    bool value(char c);
+    bool closeObject();
+    void beginCapture(char c, bool widget);
+    bool endCapture();
+    bool deliver(cJSON* item, bool widget);
+    bool fail(const char* error);
+
+    static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+    WidgetCallback m_on_widget;
+    FieldCallback m_on_field;
+    WidgetTextFilter m_widget_filter;
+    PageCallback m_on_page;
+    TemplateCallback m_on_template;
+    size_t m_max_item;
+    size_t m_next_max_item;
+
+    Phase m_phase = Phase::RootStart;
+    Context m_context = Context::Root;
+    bool m_after_comma = false;
+    std::string m_key;
+    bool m_key_escaped = false;
+    bool m_key_escape = false;
+
+    Capture m_capture = Capture::None;
+    bool m_capture_widget = false;
+    std::string m_item;
+    int m_depth = 0;
+    bool m_in_string = false;
+    bool m_escape = false;
+
+    const char* m_error = nullptr;
+    bool m_widgets_seen = false;
+    size_t m_widget_count = 0;
+    size_t m_peak_item = 0;
+};
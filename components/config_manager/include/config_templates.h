@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include "cJSON.h"
+
+// Reusable widget definitions of a config (root "templates") and their instances.
+//
+// A template is one widget definition, usually a container with children, whose
+// strings may reference parameters as ${name}; its optional "params" object holds
+// defaults. An instance is any widget with a "template" key:
+//   {"template": "motor_card", "id": "m1", "x": 10, "y": 10, "params": {"prefix": "plant/m1"}}
+// It is replaced by a copy of the template with the parameters substituted. ${id}
+// is the instance id. Every other field of the instance overrides the template's,
+// except "properties", which is merged key by key. A string that is exactly
+// "${name}" takes the parameter's JSON type, so numbers and booleans work too.
+//
+// Templates are compiled once: strings with references are split into literal and
+// parameter pieces, and subtrees without any are copied as they are. A template
+// whose definition is unchanged in the next config keeps its compiled form.
+class ConfigTemplates {
+public:
+    ConfigTemplates() = default;
+    ConfigTemplates(const ConfigTemplates&) = delete;
+    ConfigTemplates& operator=(const ConfigTemplates&) = delete;
+
+    // Replace the library with a config's "templates" object (nullptr: none). On
+    // error the previous library is kept. changed is set if any template differs.
+    bool load(cJSON* templates, bool* changed = nullptr);
+    void clear();
+
+    // The same, one template at a time (a streamed "templates" object): beginLoad(), add()
+    // per member, then endLoad(). add() takes ownership of the definition. The previous
+    // library stays in use until endLoad(); abortLoad() keeps it.
+    void beginLoad();
+    bool add(const std::string& name, cJSON* definition);
+    void endLoad(bool* changed = nullptr);
+    void abortLoad();
+
+    // Takes ownership of a widget and returns its expansion (itself if it contains
+    // no instances), or nullptr on error
+    cJSON* expand(cJSON* widget);
+
+    // Expand every instance in a widget array, in place
+    bool expandArray(cJSON* widgets);
+
+    bool empty() const { return m_templates.empty(); }
+    size_t size() const { return m_templates.size(); }
+    size_t compiledCount() const { return m_compiled; }   // Compiled by the last load()
+    size_t instanceCount() const { return m_instances; }  // Expanded since the last load()
+    const std::string& error() const { return m_error; }
+
+private:
+    struct Piece {
+        bool param;
+        std::string text;  // Literal text or parameter name
+    };
+
+    struct Template {
+        ~Template() { cJSON_Delete(definition); }
+
+        std::string name;
+        cJSON* definition = nullptr;                          // As given in the config
+        cJSON* defaults = nullptr;                            // Its "params", may be null
+        std::map<const cJSON*, std::vector<Piece>> strings;   // Strings with references
+        std::set<const cJSON*> dynamic;                       // Items with a reference at or below them
+        bool nested = false;                                  // Contains instances of other templates
+    };
+
+    struct Scope {
+        const Template* tpl;
+        cJSON* params;
+        cJSON* id;
+    };
+
+    static constexpr int MAX_NESTING = 8;
+
+    static bool compile(Template& tpl, const cJSON* item);
+    static std::vector<Piece> split(const char* text);
+    static cJSON* lookup(const Scope& scope, const std::string& name);
+
+    cJSON* expandWidget(cJSON* widget, int depth);
+    bool expandChildren(cJSON* widget, int depth);
+    bool expandArray(cJSON* widgets, int depth);
+    cJSON* instantiate(cJSON* instance, int depth);
+    cJSON* stamp(const Scope& scope, const cJSON* item);
+    cJSON* substitute(const Scope& scope, const std::vector<Piece>& pieces);
+    bool fail(const std::string& error);
+
+    // Shared so an unchanged template can be carried over while the previous library stays loaded
+    std::map<std::string, std::shared_ptr<Template>> m_templates;
+    std::map<std::string, std::shared_ptr<Template>> m_loading;  // Between beginLoad() and endLoad()
+    size_t m_compiled = 0;
+    size_t m_instances = 0;
+    std::string m_error;
+};
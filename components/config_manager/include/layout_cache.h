@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "cJSON.h"
+#include "esp_partition.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+// Compiled binary layout, persisted so the last applied UI can be rebuilt at boot
+// before the network is up. tools/compile_layout.py writes the same format on the host.
+//
+// Stored image: 16-byte header followed by the payload (all integers little-endian)
+//   u32 magic "FHLC" | u16 format version | u16 flags (0) | u32 payload length | u32 CRC-32 of payload
+//
+// Payload:
+//   zigzag config version
+//   varint string count, then per string: varint length + bytes (interned, referenced by index)
+//   varint widget count, then a flat widget table in pre-order (parents before children):
+//     u8 type (index into LAYOUT_WIDGET_TYPES) | varint id string
+//     varint parent (0 = screen, else parent widget index + 1) | varint tab (0 = none, else string + 1)
+//     zigzag x, y, w, h | varint extra field count, then per field: varint key string + value
+//   varint root field count, then per field: varint key string + value (every root field other
+//     than "version" and "widgets", e.g. "pages" and "start_page"; page widgets are plain values)
+//   value: u8 tag followed by
+//     NULL, FALSE, TRUE: nothing      INT: zigzag varint     DOUBLE: 8 bytes
+//     STRING: varint string index     COLOR: 3 bytes RGB ("#RRGGBB" strings, pre-parsed)
+//     ARRAY: varint count + values    OBJECT: varint count + (varint key string, value) pairs
+static constexpr uint32_t LAYOUT_MAGIC = 0x434C4846;  // "FHLC"
+static constexpr uint16_t LAYOUT_FORMAT_VERSION = 2;
+static constexpr size_t LAYOUT_HEADER_SIZE = 16;
+static constexpr uint8_t LAYOUT_PARTITION_SUBTYPE = 0x40;
+
+enum LayoutValueTag : uint8_t {
+    LAYOUT_TAG_NULL = 0,
+    LAYOUT_TAG_FALSE = 1,
+    LAYOUT_TAG_TRUE = 2,
+    LAYOUT_TAG_INT = 3,
+    LAYOUT_TAG_DOUBLE = 4,
+    LAYOUT_TAG_STRING = 5,
+    LAYOUT_TAG_COLOR = 6,
+    LAYOUT_TAG_ARRAY = 7,
+    LAYOUT_TAG_OBJECT = 8,
+};
+
+// Widget type enum values, in format order. Append only.
+static constexpr const char* LAYOUT_WIDGET_TYPES[] = {
+    "label", "button", "container", "switch", "slider", "bar", "arc", "checkbox",
+    "dropdown", "led", "spinner", "tabview", "gauge", "image", "line_chart",
+};
+
+class LayoutCache {
+public:
+    static LayoutCache& getInstance();
+
+    // Compile a config root ({"version", "widgets"}, plus optional fields such as "pages") into a layout payload
+    static bool compile(cJSON* root, std::string& payload);
+
+    // Rebuild a config root from a layout payload; caller owns the result
+    static cJSON* decompile(const uint8_t* data, size_t len);
+
+    // Read and decompile the stored layout; nullptr if there is none or it is invalid
+    cJSON* load();
+
+    // Compile and persist a config root from a background task, taking ownership of it.
+    // Writes are debounced and skipped when the payload matches what is already stored.
+    void storeAsync(cJSON* root);
+
+private:
+    LayoutCache();
+    LayoutCache(const LayoutCache&) = delete;
+    LayoutCache& operator=(const LayoutCache&) = delete;
+
+    static void writerTask(void* arg);
+    bool write(const std::string& payload, uint32_t crc);
+
+    static constexpr uint32_t WRITE_DELAY_MS = 2000;
+
+    const esp_partition_t* m_partition = nullptr;
+    SemaphoreHandle_t m_mutex;
+    cJSON* m_pending = nullptr;  // Only the newest root is compiled
+    bool m_writer_running = false;
+    uint32_t m_stored_crc = 0;
+    bool m_has_stored = false;
+};
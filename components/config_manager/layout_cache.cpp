@@ -0,0 +1,624 @@
+#include "layout_cache.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "freertos/task.h"
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+static const char* TAG = "LayoutCache";
+
+static constexpr size_t LAYOUT_TYPE_COUNT = sizeof(LAYOUT_WIDGET_TYPES) / sizeof(LAYOUT_WIDGET_TYPES[0]);
+static constexpr int MAX_VALUE_DEPTH = 32;
+
+// Same polynomial and conditioning as zlib.crc32 used by tools/compile_layout.py
+static uint32_t layoutCrc(const uint8_t* data, size_t len) {
+    return esp_rom_crc32_le(0, data, len);
+}
+
+static void put32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+static uint32_t get32(const uint8_t* in) {
+    return in[0] | (in[1] << 8) | (in[2] << 16) | (static_cast<uint32_t>(in[3]) << 24);
+}
+
+// ---- Encoding ----
+
+namespace {
+
+struct Encoder {
+    std::string body;
+    std::vector<const char*> strings;
+    std::unordered_map<std::string, uint32_t> string_index;
+    uint32_t widget_count = 0;
+
+    void put8(uint8_t value) { body.push_back(static_cast<char>(value)); }
+
+    void putVarint(uint64_t value) {
+        while (value >= 0x80) {
+            put8(static_cast<uint8_t>(value) | 0x80);
+            value >>= 7;
+        }
+        put8(static_cast<uint8_t>(value));
+    }
+
+    void putZigzag(int64_t value) {
+        putVarint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    uint32_t intern(const char* str) {
+        auto it = string_index.find(str);
+        if (it != string_index.end()) {
+            return it->second;
+        }
+        uint32_t index = static_cast<uint32_t>(strings.size());
+        strings.push_back(str);
+        string_index.emplace(str, index);
+        return index;
+    }
+
+    // "#RRGGBB" in the canonical upper-case spelling, so decoding reproduces it exactly
+    static bool parseColor(const char* str, uint32_t& rgb) {
+        if (strlen(str) != 7 || str[0] != '#') {
+            return false;
+        }
+        rgb = 0;
+        for (int i = 1; i < 7; i++) {
+            char c = str[i];
+            uint32_t digit;
+            if (c >= '0' && c <= '9') {
+                digit = c - '0';
+            } else if (c >= 'A' && c <= 'F') {
+                digit = c - 'A' + 10;
+            } else {
+                return false;
+            }
+            rgb = (rgb << 4) | digit;
+        }
+        return true;
+    }
+
+    void putValue(cJSON* item, int depth) {
+        if (depth > MAX_VALUE_DEPTH || cJSON_IsNull(item)) {
+            put8(LAYOUT_TAG_NULL);
+        } else if (cJSON_IsFalse(item)) {
+            put8(LAYOUT_TAG_FALSE);
+        } else if (cJSON_IsTrue(item)) {
+            put8(LAYOUT_TAG_TRUE);
+        } else if (cJSON_IsNumber(item)) {
+            double value = item->valuedouble;
+            if (std::floor(value) == value && std::fabs(value) < 2147483648.0) {
+                put8(LAYOUT_TAG_INT);
+                putZigzag(static_cast<int64_t>(value));
+            } else {
+                uint64_t bits;
+                memcpy(&bits, &value, sizeof(bits));
+                put8(LAYOUT_TAG_DOUBLE);
+                for (int i = 0; i < 8; i++) {
+                    put8(static_cast<uint8_t>(bits >> (8 * i)));
+                }
+            }
+        } else if (cJSON_IsString(item)) {
+            uint32_t rgb;
+            if (parseColor(item->valuestring, rgb)) {
+                put8(LAYOUT_TAG_COLOR);
+                put8(static_cast<uint8_t>(rgb >> 16));
+                put8(static_cast<uint8_t>(rgb >> 8));
+                put8(static_cast<uint8_t>(rgb));
+            } else {
+                put8(LAYOUT_TAG_STRING);
+                putVarint(intern(item->valuestring));
+            }
+        } else if (cJSON_IsArray(item)) {
+            put8(LAYOUT_TAG_ARRAY);
+            putVarint(cJSON_GetArraySize(item));
+            cJSON* element = nullptr;
+            cJSON_ArrayForEach(element, item) {
+                putValue(element, depth + 1);
+            }
+        } else if (cJSON_IsObject(item)) {
+            put8(LAYOUT_TAG_OBJECT);
+            putVarint(cJSON_GetArraySize(item));
+            cJSON* field = nullptr;
+            cJSON_ArrayForEach(field, item) {
+                putVarint(intern(field->string ? field->string : ""));
+                putValue(field, depth + 1);
+            }
+        } else {
+            put8(LAYOUT_TAG_NULL);
+        }
+    }
+
+    static bool isTableField(const char* name) {
+        static const char* const fields[] = {"type", "id", "x", "y", "w", "h", "children"};
+        for (const char* field : fields) {
+            if (strcmp(name, field) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void putWidget(cJSON* widget, uint32_t parent, uint32_t tab) {
+        cJSON* type = cJSON_GetObjectItem(widget, "type");
+        cJSON* id = cJSON_GetObjectItem(widget, "id");
+        cJSON* x = cJSON_GetObjectItem(widget, "x");
+        cJSON* y = cJSON_GetObjectItem(widget, "y");
+        cJSON* w = cJSON_GetObjectItem(widget, "w");
+        cJSON* h = cJSON_GetObjectItem(widget, "h");
+        if (!cJSON_IsString(type) || !cJSON_IsString(id) || !cJSON_IsNumber(x) ||
+            !cJSON_IsNumber(y) || !cJSON_IsNumber(w) || !cJSON_IsNumber(h)) {
+            ESP_LOGW(TAG, "Skipping incomplete widget");
+            return;
+        }
+        size_t type_index = 0;
+        while (type_index < LAYOUT_TYPE_COUNT && strcmp(LAYOUT_WIDGET_TYPES[type_index], type->valuestring) != 0) {
+            type_index++;
+        }
+        if (type_index == LAYOUT_TYPE_COUNT) {
+            ESP_LOGW(TAG, "Skipping widget '%s' of unknown type '%s'", id->valuestring, type->valuestring);
+            return;
+        }
+
+        uint32_t index = widget_count++;
+        put8(static_cast<uint8_t>(type_index));
+        putVarint(intern(id->valuestring));
+        putVarint(parent);
+        putVarint(tab);
+        putZigzag(x->valueint);
+        putZigzag(y->valueint);
+        putZigzag(w->valueint);
+        putZigzag(h->valueint);
+
+        uint32_t extra_count = 0;
+        cJSON* field = nullptr;
+        cJSON_ArrayForEach(field, widget) {
+            if (field->string && !isTableField(field->string)) {
+                extra_count++;
+            }
+        }
+        putVarint(extra_count);
+        cJSON_ArrayForEach(field, widget) {
+            if (field->string && !isTableField(field->string)) {
+                putVarint(intern(field->string));
+                putValue(field, 0);
+            }
+        }
+
+        cJSON* children = cJSON_GetObjectItem(widget, "children");
+        if (cJSON_IsArray(children)) {
+            cJSON* child = nullptr;
+            cJSON_ArrayForEach(child, children) {
+                putWidget(child, index + 1, 0);
+            }
+        } else if (cJSON_IsObject(children)) {
+            cJSON* tab_children = nullptr;
+            cJSON_ArrayForEach(tab_children, children) {
+                if (!tab_children->string || !cJSON_IsArray(tab_children)) {
+                    continue;
+                }
+                uint32_t tab_index = intern(tab_children->string) + 1;
+                cJSON* child = nullptr;
+                cJSON_ArrayForEach(child, tab_children) {
+                    putWidget(child, index + 1, tab_index);
+                }
+            }
+        }
+    }
+};
+
+// ---- Decoding ----
+
+struct Decoder {
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok = true;
+    std::vector<std::string> strings;
+
+    uint8_t get8() {
+        if (p >= end) {
+            ok = false;
+            return 0;
+        }
+        return *p++;
+    }
+
+    uint64_t getVarint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte = get8();
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        ok = false;
+        return 0;
+    }
+
+    int64_t getZigzag() {
+        uint64_t value = getVarint();
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    const char* getString() {
+        uint64_t index = getVarint();
+        if (index >= strings.size()) {
+            ok = false;
+            return "";
+        }
+        return strings[index].c_str();
+    }
+
+    cJSON* getValue(int depth) {
+        if (depth > MAX_VALUE_DEPTH) {
+            ok = false;
+            return nullptr;
+        }
+        switch (get8()) {
+            case LAYOUT_TAG_NULL:
+                return cJSON_CreateNull();
+            case LAYOUT_TAG_FALSE:
+                return cJSON_CreateFalse();
+            case LAYOUT_TAG_TRUE:
+                return cJSON_CreateTrue();
+            case LAYOUT_TAG_INT:
+                return cJSON_CreateNumber(static_cast<double>(getZigzag()));
+            case LAYOUT_TAG_DOUBLE: {
+                uint64_t bits = 0;
+                for (int i = 0; i < 8; i++) {
+                    bits |= static_cast<uint64_t>(get8()) << (8 * i);
+                }
+                double value;
+                memcpy(&value, &bits, sizeof(value));
+                return cJSON_CreateNumber(value);
+            }
+            case LAYOUT_TAG_STRING:
+                return cJSON_CreateString(getString());
+            case LAYOUT_TAG_COLOR: {
+                uint32_t rgb = get8() << 16;
+                rgb |= get8() << 8;
+                rgb |= get8();
+                char color[8];
+                snprintf(color, sizeof(color), "#%06X", static_cast<unsigned>(rgb));
+                return cJSON_CreateString(color);
+            }
+            case LAYOUT_TAG_ARRAY: {
+                cJSON* array = cJSON_CreateArray();
+                uint64_t count = getVarint();
+                for (uint64_t i = 0; i < count && ok; i++) {
+                    cJSON_AddItemToArray(array, getValue(depth + 1));
+                }
+                return array;
+            }
+            case LAYOUT_TAG_OBJECT: {
+                cJSON* object = cJSON_CreateObject();
+                uint64_t count = getVarint();
+                for (uint64_t i = 0; i < count && ok; i++) {
+                    const char* key = getString();
+                    cJSON_AddItemToObject(object, key, getValue(depth + 1));
+                }
+                return object;
+            }
+            default:
+                ok = false;
+                return nullptr;
+        }
+    }
+};
+
+}  // namespace
+
+bool LayoutCache::compile(cJSON* root, std::string& payload) {
+    cJSON* widgets = cJSON_GetObjectItem(root, "widgets");
+    if (!cJSON_IsArray(widgets)) {
+        return false;
+    }
+
+    Encoder encoder;
+    cJSON* widget = nullptr;
+    cJSON_ArrayForEach(widget, widgets) {
+        encoder.putWidget(widget, 0, 0);
+    }
+
+    // Remaining root fields (pages and their settings) follow the widget table
+    uint32_t field_count = 0;
+    cJSON* field = nullptr;
+    cJSON_ArrayForEach(field, root) {
+        if (field->string && strcmp(field->string, "version") != 0 && strcmp(field->string, "widgets") != 0) {
+            field_count++;
+        }
+    }
+    encoder.putVarint(field_count);
+    cJSON_ArrayForEach(field, root) {
+        if (field->string && strcmp(field->string, "version") != 0 && strcmp(field->string, "widgets") != 0) {
+            encoder.putVarint(encoder.intern(field->string));
+            encoder.putValue(field, 0);
+        }
+    }
+
+    cJSON* version = cJSON_GetObjectItem(root, "version");
+    Encoder header;
+    header.putZigzag(cJSON_IsNumber(version) ? version->valueint : 0);
+    header.putVarint(encoder.strings.size());
+    for (const char* str : encoder.strings) {
+        size_t len = strlen(str);
+        header.putVarint(len);
+        header.body.append(str, len);
+    }
+    header.putVarint(encoder.widget_count);
+
+    payload = std::move(header.body);
+    payload += encoder.body;
+    return true;
+}
+
+cJSON* LayoutCache::decompile(const uint8_t* data, size_t len) {
+    Decoder decoder{data, data + len};
+    int64_t version = decoder.getZigzag();
+
+    uint64_t string_count = decoder.getVarint();
+    if (string_count > len) {
+        return nullptr;
+    }
+    decoder.strings.reserve(string_count);
+    for (uint64_t i = 0; i < string_count && decoder.ok; i++) {
+        uint64_t str_len = decoder.getVarint();
+        if (str_len > static_cast<uint64_t>(decoder.end - decoder.p)) {
+            return nullptr;
+        }
+        decoder.strings.emplace_back(reinterpret_cast<const char*>(decoder.p), str_len);
+        decoder.p += str_len;
+    }
+
+    uint64_t widget_count = decoder.getVarint();
+    if (!decoder.ok || widget_count > len) {
+        return nullptr;
+    }
+
+    cJSON* root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "version", static_cast<double>(version));
+    cJSON* widgets = cJSON_CreateArray();
+    cJSON_AddItemToObject(root, "widgets", widgets);
+
+    std::vector<cJSON*> table;
+    table.reserve(widget_count);
+    for (uint64_t i = 0; i < widget_count && decoder.ok; i++) {
+        uint8_t type = decoder.get8();
+        const char* id = decoder.getString();
+        uint64_t parent = decoder.getVarint();
+        uint64_t tab = decoder.getVarint();
+        if (type >= LAYOUT_TYPE_COUNT || parent > table.size() || tab > decoder.strings.size()) {
+            decoder.ok = false;
+            break;
+        }
+
+        cJSON* widget = cJSON_CreateObject();
+        cJSON_AddStringToObject(widget, "type", LAYOUT_WIDGET_TYPES[type]);
+        cJSON_AddStringToObject(widget, "id", id);
+        cJSON_AddNumberToObject(widget, "x", static_cast<double>(decoder.getZigzag()));
+        cJSON_AddNumberToObject(widget, "y", static_cast<double>(decoder.getZigzag()));
+        cJSON_AddNumberToObject(widget, "w", static_cast<double>(decoder.getZigzag()));
+        cJSON_AddNumberToObject(widget, "h", static_cast<double>(decoder.getZigzag()));
+        uint64_t extra_count = decoder.getVarint();
+        for (uint64_t f = 0; f < extra_count && decoder.ok; f++) {
+            const char* key = decoder.getString();
+            cJSON* value = decoder.getValue(0);
+            if (value) {
+                cJSON_AddItemToObject(widget, key, value);
+            }
+        }
+
+        // Attach to the screen, the parent's children array, or the parent's tab
+        cJSON* list = widgets;
+        if (parent > 0) {
+            cJSON* parent_widget = table[parent - 1];
+            cJSON* children = cJSON_GetObjectItem(parent_widget, "children");
+            if (!children) {
+                children = tab ? cJSON_CreateObject() : cJSON_CreateArray();
+                cJSON_AddItemToObject(parent_widget, "children", children);
+            }
+            if (tab) {
+                const char* tab_name = decoder.strings[tab - 1].c_str();
+                list = cJSON_GetObjectItemCaseSensitive(children, tab_name);
+                if (!list && cJSON_IsObject(children)) {
+                    list = cJSON_CreateArray();
+                    cJSON_AddItemToObject(children, tab_name, list);
+                }
+            } else {
+                list = children;
+            }
+            if (!cJSON_IsArray(list)) {
+                cJSON_Delete(widget);
+                decoder.ok = false;
+                break;
+            }
+        }
+        cJSON_AddItemToArray(list, widget);
+        table.push_back(widget);
+    }
+
+    uint64_t field_count = decoder.ok ? decoder.getVarint() : 0;
+    for (uint64_t f = 0; f < field_count && decoder.ok; f++) {
+        const char* key = decoder.getString();
+        cJSON* value = decoder.getValue(0);
+        if (value) {
+            cJSON_AddItemToObject(root, key, value);
+        }
+    }
+
+    if (!decoder.ok || decoder.p != decoder.end) {
+        ESP_LOGE(TAG, "Corrupt layout payload");
+        cJSON_Delete(root);
+        return nullptr;
+    }
+    return root;
+}
+
+// ---- Storage ----
+
+LayoutCache& LayoutCache::getInstance() {
+    static LayoutCache instance;
+    return instance;
+}
+
+LayoutCache::LayoutCache() {
+    m_mutex = xSemaphoreCreateMutex();
+    m_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                           static_cast<esp_partition_subtype_t>(LAYOUT_PARTITION_SUBTYPE), "layout");
+    if (!m_partition) {
+        ESP_LOGW(TAG, "No 'layout' partition, layout cache disabled");
+    }
+}
+
+cJSON* LayoutCache::load() {
+    if (!m_partition) {
+        return nullptr;
+    }
+
+    uint8_t header[LAYOUT_HEADER_SIZE];
+    if (esp_partition_read(m_partition, 0, header, sizeof(header)) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read layout header");
+        return nullptr;
+    }
+    uint16_t format = header[4] | (header[5] << 8);
+    uint32_t len = get32(header + 8);
+    uint32_t crc = get32(header + 12);
+    if (get32(header) != LAYOUT_MAGIC) {
+        ESP_LOGI(TAG, "No cached layout");
+        return nullptr;
+    }
+    if (format != LAYOUT_FORMAT_VERSION || len > m_partition->size - LAYOUT_HEADER_SIZE) {
+        ESP_LOGW(TAG, "Ignoring cached layout (format %d, %lu bytes)", format, (unsigned long)len);
+        return nullptr;
+    }
+
+    // Decode straight from the flash mapping, no RAM copy of the payload
+    const void* mapped = nullptr;
+    esp_partition_mmap_handle_t mmap_handle;
+    esp_err_t err = esp_partition_mmap(m_partition, 0, LAYOUT_HEADER_SIZE + len,
+                                       ESP_PARTITION_MMAP_DATA, &mapped, &mmap_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to map layout partition: %s", esp_err_to_name(err));
+        return nullptr;
+    }
+    const uint8_t* payload = static_cast<const uint8_t*>(mapped) + LAYOUT_HEADER_SIZE;
+
+    cJSON* root = nullptr;
+    if (layoutCrc(payload, len) != crc) {
+        ESP_LOGW(TAG, "Cached layout CRC mismatch, ignoring");
+    } else {
+        root = decompile(payload, len);
+        if (root) {
+            m_stored_crc = crc;
+            m_has_stored = true;
+            ESP_LOGI(TAG, "Loaded cached layout (%lu bytes)", (unsigned long)len);
+        }
+    }
+    esp_partition_munmap(mmap_handle);
+    return root;
+}
+
+void LayoutCache::storeAsync(cJSON* root) {
+    if (!m_partition) {
+        cJSON_Delete(root);
+        return;
+    }
+
+    bool start_writer = false;
+    if (xSemaphoreTake(m_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        ESP_LOGE(TAG, "Failed to queue layout - mutex timeout");
+        cJSON_Delete(root);
+        return;
+    }
+    cJSON_Delete(m_pending);
+    m_pending = root;
+    if (!m_writer_running) {
+        m_writer_running = true;
+        start_writer = true;
+    }
+    xSemaphoreGive(m_mutex);
+
+    if (start_writer && xTaskCreate(writerTask, "layout_cache", 6144, this, 2, nullptr) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to start layout writer task");
+        xSemaphoreTake(m_mutex, portMAX_DELAY);
+        m_writer_running = false;
+        xSemaphoreGive(m_mutex);
+    }
+}
+
+void LayoutCache::writerTask(void* arg) {
+    LayoutCache* cache = static_cast<LayoutCache*>(arg);
+
+    while (true) {
+        // Debounce bursts of patches into a single flash write
+        vTaskDelay(pdMS_TO_TICKS(WRITE_DELAY_MS));
+
+        xSemaphoreTake(cache->m_mutex, portMAX_DELAY);
+        cJSON* root = cache->m_pending;
+        cache->m_pending = nullptr;
+        if (!root) {
+            cache->m_writer_running = false;
+            xSemaphoreGive(cache->m_mutex);
+            break;
+        }
+        xSemaphoreGive(cache->m_mutex);
+
+        // Compiled here rather than by the caller, which holds the LVGL lock
+        std::string payload;
+        bool compiled = compile(root, payload);
+        cJSON_Delete(root);
+        if (!compiled) {
+            continue;
+        }
+
+        uint32_t crc = layoutCrc(reinterpret_cast<const uint8_t*>(payload.data()), payload.size());
+        if (cache->m_has_stored && crc == cache->m_stored_crc) {
+            ESP_LOGD(TAG, "Layout unchanged, not rewriting flash");
+            continue;
+        }
+        if (cache->write(payload, crc)) {
+            cache->m_stored_crc = crc;
+            cache->m_has_stored = true;
+        }
+    }
+
+    vTaskDelete(NULL);
+}
+
+bool LayoutCache::write(const std::string& payload, uint32_t crc) {
+    size_t total = LAYOUT_HEADER_SIZE + payload.size();
+    if (total > m_partition->size) {
+        ESP_LOGE(TAG, "Layout too large for partition (%lu > %lu bytes)", (unsigned long)total,
+                 (unsigned long)m_partition->size);
+        return false;
+    }
+
+    size_t erase_size = (total + m_partition->erase_size - 1) / m_partition->erase_size * m_partition->erase_size;
+    esp_err_t err = esp_partition_erase_range(m_partition, 0, erase_size);
+    if (err == ESP_OK) {
+        err = esp_partition_write(m_partition, LAYOUT_HEADER_SIZE, payload.data(), payload.size());
+    }
+    if (err == ESP_OK) {
+        // Header last, so an interrupted write leaves no valid layout behind
+        uint8_t header[LAYOUT_HEADER_SIZE] = {};
+        put32(header, LAYOUT_MAGIC);
+        header[4] = LAYOUT_FORMAT_VERSION & 0xFF;
+        header[5] = LAYOUT_FORMAT_VERSION >> 8;
+        put32(header + 8, payload.size());
+        put32(header + 12, crc);
+        err = esp_partition_write(m_partition, 0, header, sizeof(header));
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write layout: %s", esp_err_to_name(err));
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Stored layout (%lu bytes)", (unsigned long)payload.size());
+    return true;
+}
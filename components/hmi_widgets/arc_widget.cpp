@@ -41,6 +41,11 @@ ArcWidget::ArcWidget(const std::string& id, int x, int y, int w, int h, cJSON* p
             m_retained = cJSON_IsTrue(retained_item);
         }
         
+        cJSON* rate_item = cJSON_GetObjectItem(properties, "publish_rate_hz");
+        if (rate_item && cJSON_IsNumber(rate_item) && rate_item->valuedouble >= 0) {
+            m_publish_rate_hz = static_cast<float>(rate_item->valuedouble);
+        }
+        
         cJSON* color_item = cJSON_GetObjectItem(properties, "color");
         if (color_item && cJSON_IsString(color_item)) {
             const char* color_str = color_item->valuestring;
@@ -73,6 +78,7 @@ ArcWidget::ArcWidget(const std::string& id, int x, int y, int w, int h, cJSON* p
     
     // Add event callback
     lv_obj_add_event_cb(m_lvgl_obj, arc_event_cb, LV_EVENT_VALUE_CHANGED, this);
+    lv_obj_add_event_cb(m_lvgl_obj, release_event_cb, LV_EVENT_RELEASED, this);
     
     // Subscribe to mqtt_topic to receive external updates
     if (!m_mqtt_topic.empty()) {
@@ -87,7 +93,7 @@ ArcWidget::ArcWidget(const std::string& id, int x, int y, int w, int h, cJSON* p
 }
 
 ArcWidget::~ArcWidget() {
-    cancelAsync(async_update_cb, this);
+    cancelUpdate();
     if (m_subscription_handle != 0) {
         MQTTManager::getInstance().unsubscribe(m_subscription_handle);
         m_subscription_handle = 0;
@@ -114,7 +120,8 @@ void ArcWidget::arc_event_cb(lv_event_t* e) {
         if (!widget->m_mqtt_topic.empty()) {
             char payload[16];
             snprintf(payload, sizeof(payload), "%d", new_value);
-            MQTTManager::getInstance().publish(widget->m_mqtt_topic, payload, 0, widget->m_retained);
+            MQTTManager::getInstance().publishThrottled(widget->m_mqtt_topic, payload, 0, widget->m_retained,
+                                                    widget->m_publish_rate_hz);
             ESP_LOGD(TAG, "Arc %s changed to %d, published to %s (retained=%d)", 
                      widget->m_id.c_str(), new_value, widget->m_mqtt_topic.c_str(), widget->m_retained);
         }
@@ -130,7 +137,15 @@ void ArcWidget::onMqttMessage(const std::string& topic, const std::string& paylo
     
     if (new_value != m_value) {
         m_pending_value = new_value;
-        scheduleAsync(async_update_cb, this);
+        scheduleUpdate(async_update_cb, this);
+    }
+}
+
+void ArcWidget::release_event_cb(lv_event_t* e) {
+    ArcWidget* widget = static_cast<ArcWidget*>(lv_event_get_user_data(e));
+    if (widget && !widget->m_mqtt_topic.empty()) {
+        // Send the value the user let go at, even if the rate limit held it back
+        MQTTManager::getInstance().flushPublish(widget->m_mqtt_topic);
     }
 }
 
@@ -139,7 +154,10 @@ void ArcWidget::async_update_cb(void* user_data) {
     if (!widget) {
         return;
     }
-    widget->markAsyncComplete();
+    // Don't move the knob under the user's finger; the released value wins
+    if (widget->m_lvgl_obj && lv_obj_has_state(widget->m_lvgl_obj, LV_STATE_PRESSED)) {
+        return;
+    }
     widget->updateValue(widget->m_pending_value);
 }
 
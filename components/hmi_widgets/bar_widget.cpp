@@ -78,7 +78,7 @@ BarWidget::BarWidget(const std::string& id, int x, int y, int w, int h, cJSON* p
 }
 
 BarWidget::~BarWidget() {
-    cancelAsync(async_update_cb, this);
+    cancelUpdate();
     if (m_subscription_handle != 0) {
         MQTTManager::getInstance().unsubscribe(m_subscription_handle);
         m_subscription_handle = 0;
@@ -99,7 +99,7 @@ void BarWidget::onMqttMessage(const std::string& topic, const std::string& paylo
     
     // Schedule async update
     m_pending_value = new_value;
-    scheduleAsync(async_update_cb, this);
+    scheduleUpdate(async_update_cb, this);
 }
 
 void BarWidget::async_update_cb(void* user_data) {
@@ -107,7 +107,6 @@ void BarWidget::async_update_cb(void* user_data) {
     if (!widget) {
         return;
     }
-    widget->markAsyncComplete();
     widget->updateValue(widget->m_pending_value);
 }
 
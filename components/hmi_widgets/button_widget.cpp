@@ -1,6 +1,7 @@
 #include "button_widget.h"
 #include "mqtt_manager.h"
 #include <esp_log.h>
+#include <cstring>
 
 static const char *TAG = "ButtonWidget";
 
@@ -25,6 +26,11 @@ ButtonWidget::ButtonWidget(const std::string& id, int x, int y, int w, int h, cJ
             m_mqtt_payload = mqtt_payload_item->valuestring;
         }
         
+        cJSON* navigate_item = cJSON_GetObjectItem(properties, "navigate");
+        if (navigate_item && cJSON_IsString(navigate_item)) {
+            m_navigate = navigate_item->valuestring;
+        }
+        
         cJSON* retained_item = cJSON_GetObjectItem(properties, "mqtt_retained");
         if (retained_item && cJSON_IsBool(retained_item)) {
             m_retained = cJSON_IsTrue(retained_item);
@@ -84,6 +90,49 @@ void ButtonWidget::onMqttMessage(const std::string& topic, const std::string& pa
     ESP_LOGD(TAG, "Button %s received message: %s", m_id.c_str(), payload.c_str());
 }
 
+bool ButtonWidget::applyProperties(cJSON* changed) {
+    if (!m_lvgl_obj || !lv_obj_is_valid(m_lvgl_obj)) {
+        return false;
+    }
+
+    cJSON* item = nullptr;
+    cJSON_ArrayForEach(item, changed) {
+        const char* key = item->string;
+        bool ok = (strcmp(key, "text") == 0 && cJSON_IsString(item)) ||
+                  (strcmp(key, "mqtt_topic") == 0 && cJSON_IsString(item)) ||
+                  (strcmp(key, "mqtt_payload") == 0 && cJSON_IsString(item)) ||
+                  (strcmp(key, "mqtt_retained") == 0 && cJSON_IsBool(item)) ||
+                  (strcmp(key, "navigate") == 0 && cJSON_IsString(item)) ||
+                  (strcmp(key, "color") == 0 && cJSON_IsString(item) && item->valuestring[0] == '#');
+        if (!ok) {
+            return false;
+        }
+    }
+
+    cJSON_ArrayForEach(item, changed) {
+        const char* key = item->string;
+        if (strcmp(key, "text") == 0) {
+            m_button_text = item->valuestring;
+            if (m_label) {
+                lv_label_set_text(m_label, m_button_text.empty() ? "Button" : m_button_text.c_str());
+            }
+        } else if (strcmp(key, "mqtt_topic") == 0) {
+            m_mqtt_topic = item->valuestring;
+        } else if (strcmp(key, "mqtt_payload") == 0) {
+            m_mqtt_payload = item->valuestring;
+        } else if (strcmp(key, "mqtt_retained") == 0) {
+            m_retained = cJSON_IsTrue(item);
+        } else if (strcmp(key, "navigate") == 0) {
+            m_navigate = item->valuestring;
+        } else if (strcmp(key, "color") == 0) {
+            m_color = lv_color_hex(strtol(item->valuestring + 1, NULL, 16));
+            m_has_color = true;
+            lv_obj_set_style_bg_color(m_lvgl_obj, m_color, LV_PART_MAIN);
+        }
+    }
+    return true;
+}
+
 void ButtonWidget::button_event_cb(lv_event_t* e) {
     lv_obj_t* obj = (lv_obj_t*)lv_event_get_target(e);
     ButtonWidget* widget = static_cast<ButtonWidget*>(lv_obj_get_user_data(obj));
@@ -94,6 +143,10 @@ void ButtonWidget::button_event_cb(lv_event_t* e) {
         ESP_LOGI(TAG, "Button %s clicked, published to %s: %s (retained=%d)", 
                  widget->m_id.c_str(), widget->m_mqtt_topic.c_str(), payload.c_str(), widget->m_retained);
     }
+    if (widget && !widget->m_navigate.empty()) {
+        // Last: the page switch may rebuild or unload screens
+        navigate(widget->m_navigate);
+    }
 }
 
 // Register this widget type
@@ -82,7 +82,7 @@ CheckboxWidget::CheckboxWidget(const std::string& id, int x, int y, int w, int h
 }
 
 CheckboxWidget::~CheckboxWidget() {
-    cancelAsync(async_update_cb, this);
+    cancelUpdate();
     if (m_subscription_handle != 0) {
         MQTTManager::getInstance().unsubscribe(m_subscription_handle);
         m_subscription_handle = 0;
@@ -127,7 +127,7 @@ void CheckboxWidget::onMqttMessage(const std::string& topic, const std::string&
     
     if (new_state != m_checked) {
         m_pending_checked = new_state;
-        scheduleAsync(async_update_cb, this);
+        scheduleUpdate(async_update_cb, this);
     }
 }
 
@@ -136,7 +136,6 @@ void CheckboxWidget::async_update_cb(void* user_data) {
     if (!widget) {
         return;
     }
-    widget->markAsyncComplete();
     widget->updateState(widget->m_pending_checked);
 }
 
@@ -97,7 +97,7 @@ DropdownWidget::DropdownWidget(const std::string& id, int x, int y, int w, int h
 }
 
 DropdownWidget::~DropdownWidget() {
-    cancelAsync(async_update_cb, this);
+    cancelUpdate();
     if (m_subscription_handle != 0) {
         MQTTManager::getInstance().unsubscribe(m_subscription_handle);
         m_subscription_handle = 0;
@@ -170,7 +170,7 @@ void DropdownWidget::onMqttMessage(const std::string& topic, const std::string&
     
     if (new_selected != m_selected) {
         m_pending_selected = new_selected;
-        scheduleAsync(async_update_cb, this);
+        scheduleUpdate(async_update_cb, this);
     }
 }
 
@@ -179,7 +179,6 @@ void DropdownWidget::async_update_cb(void* user_data) {
     if (!widget) {
         return;
     }
-    widget->markAsyncComplete();
     widget->updateSelection(widget->m_pending_selected);
 }
 
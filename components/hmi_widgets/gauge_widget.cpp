@@ -108,7 +108,7 @@ GaugeWidget::GaugeWidget(const std::string& id, int x, int y, int w, int h, cJSO
 }
 
 GaugeWidget::~GaugeWidget() {
-    cancelAsync(async_update_cb, this);
+    cancelUpdate();
     if (m_subscription_handle != 0) {
         MQTTManager::getInstance().unsubscribe(m_subscription_handle);
         m_subscription_handle = 0;
@@ -130,7 +130,7 @@ void GaugeWidget::onMqttMessage(const std::string& topic, const std::string& pay
     if (new_value > m_max_value) new_value = m_max_value;
 
     m_pending_value = new_value;
-    scheduleAsync(async_update_cb, this);
+    scheduleUpdate(async_update_cb, this);
 }
 
 void GaugeWidget::async_update_cb(void* user_data) {
@@ -138,7 +138,6 @@ void GaugeWidget::async_update_cb(void* user_data) {
     if (!widget) {
         return;
     }
-    widget->markAsyncComplete();
     widget->updateValue(widget->m_pending_value);
 }
 
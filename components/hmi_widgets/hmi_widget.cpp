@@ -1,18 +1,24 @@
 #include "hmi_widget.h"
+#include "widget_update_bus.h"
 
-void HMIWidget::scheduleAsync(lv_async_cb_t cb, void* user_data) {
-	if (m_async_pending) {
-		return;
-	}
-	m_async_pending = true;
-	lv_async_call(cb, user_data);
+static HMIWidget::NavigateHandler s_navigate_handler;
+
+void HMIWidget::scheduleUpdate(lv_async_cb_t cb, void* user_data) {
+	m_update_cb.store(cb, std::memory_order_relaxed);
+	m_update_data.store(user_data, std::memory_order_relaxed);
+	WidgetUpdateBus::getInstance().schedule(this);
 }
 
-void HMIWidget::cancelAsync(lv_async_cb_t cb, void* user_data) {
-	lv_async_call_cancel(cb, user_data);
-	m_async_pending = false;
+void HMIWidget::cancelUpdate() {
+	WidgetUpdateBus::getInstance().cancel(this);
 }
 
-void HMIWidget::markAsyncComplete() {
-	m_async_pending = false;
+void HMIWidget::setNavigateHandler(NavigateHandler handler) {
+	s_navigate_handler = std::move(handler);
+}
+
+void HMIWidget::navigate(const std::string& target) {
+	if (s_navigate_handler) {
+		s_navigate_handler(target);
+	}
 }
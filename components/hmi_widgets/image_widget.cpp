@@ -124,10 +124,13 @@ ImageWidget::ImageWidget(const std::string& id, int x, int y, int w, int h, cJSO
         if (mqtt_topic && cJSON_IsString(mqtt_topic)) {
             m_mqtt_topic = mqtt_topic->valuestring;
         }
+
+        cJSON* max_size_item = cJSON_GetObjectItem(properties, "max_size");
+        if (max_size_item && cJSON_IsNumber(max_size_item) && max_size_item->valuedouble > 0) {
+            m_max_message_size = static_cast<size_t>(max_size_item->valuedouble);
+        }
     }
 
-    m_pending_data = m_image_path;
-    
     // Create image object
     lv_obj_t* parent_obj = parent ? parent : lv_screen_active();
     m_lvgl_obj = lv_image_create(parent_obj);
@@ -178,10 +181,13 @@ ImageWidget::ImageWidget(const std::string& id, int x, int y, int w, int h, cJSO
     
     // Subscribe to MQTT topic if specified
     if (!m_mqtt_topic.empty()) {
+        m_pending_mutex = xSemaphoreCreateMutex();
+        // Image topics are their own size class; the buffer is only allocated per message
+        m_size_limit_set = MQTTManager::getInstance().setMaxMessageSize(m_mqtt_topic, m_max_message_size);
         m_subscription_handle = MQTTManager::getInstance().subscribe(m_mqtt_topic, 0,
-            [this](const std::string& topic, const std::string& payload) {
-                this->onMqttMessage(topic, payload);
-            });
+            [this](const std::string& topic, const MqttPayload& payload) {
+                this->onMqttPayload(topic, payload);
+            }, MQTTManager::DeliveryClass::Bulk);
         
         if (m_subscription_handle != 0) {
             ESP_LOGI(TAG, "Image %s subscribed to %s for updates", id.c_str(), m_mqtt_topic.c_str());
@@ -193,11 +199,16 @@ ImageWidget::ImageWidget(const std::string& id, int x, int y, int w, int h, cJSO
 }
 
 ImageWidget::~ImageWidget() {
-    cancelAsync(async_update_cb, this);
+    // Unsubscribe first: it waits for a Bulk callback in progress, which may still schedule an update
     if (m_subscription_handle != 0) {
         MQTTManager::getInstance().unsubscribe(m_subscription_handle);
         m_subscription_handle = 0;
     }
+    cancelUpdate();
+    if (m_size_limit_set) {
+        MQTTManager::getInstance().clearMaxMessageSize(m_mqtt_topic, m_max_message_size);
+        m_size_limit_set = false;
+    }
     
     // Free base64 decoded data (only once!)
     if (m_decoded_data) {
@@ -236,28 +247,52 @@ ImageWidget::~ImageWidget() {
         lv_obj_delete(m_lvgl_obj);
         m_lvgl_obj = nullptr;
     }
+
+    m_pending_payload.reset();
+    if (m_pending_mutex) {
+        vSemaphoreDelete(m_pending_mutex);
+        m_pending_mutex = nullptr;
+    }
     
     ESP_LOGI(TAG, "Destroyed image widget: %s", m_id.c_str());
 }
 
 void ImageWidget::onMqttMessage(const std::string& topic, const std::string& payload) {
+    onMqttPayload(topic, MqttPayload(payload.data(), payload.size()));
+}
+
+void ImageWidget::onMqttPayload(const std::string& topic, const MqttPayload& payload) {
     // Payload can be either a file path or base64-encoded image data
     ESP_LOGI(TAG, "Image %s received MQTT message on %s (size: %d bytes)", 
              m_id.c_str(), topic.c_str(), payload.size());
 
-    m_pending_data = payload;
-    scheduleAsync(async_update_cb, this);
+    if (!m_pending_mutex) {
+        return;
+    }
+
+    // Keep a reference to the shared buffer; the LVGL thread decodes straight from it.
+    // The shared_ptr itself is written here and read there, so it is swapped under the mutex.
+    xSemaphoreTake(m_pending_mutex, portMAX_DELAY);
+    m_pending_payload = payload;
+    xSemaphoreGive(m_pending_mutex);
+    scheduleUpdate(async_update_cb, this);
     ESP_LOGI(TAG, "Scheduled async update for image %s", m_id.c_str());
 }
 
 void ImageWidget::async_update_cb(void* user_data) {
     ImageWidget* widget = static_cast<ImageWidget*>(user_data);
-    if (!widget) {
+    if (!widget || !widget->m_pending_mutex) {
         return;
     }
-    widget->markAsyncComplete();
-    ESP_LOGI(TAG, "Async callback executing for image update (size: %d bytes)", widget->m_pending_data.size());
-    widget->updateImage(widget->m_pending_data);
+    xSemaphoreTake(widget->m_pending_mutex, portMAX_DELAY);
+    MqttPayload payload = std::move(widget->m_pending_payload);
+    widget->m_pending_payload.reset();
+    xSemaphoreGive(widget->m_pending_mutex);
+    if (payload.empty()) {
+        return;
+    }
+    ESP_LOGI(TAG, "Async callback executing for image update (size: %d bytes)", payload.size());
+    widget->updateImage(payload.str());
 }
 
 void ImageWidget::updateImage(const std::string& data) {
@@ -271,13 +306,18 @@ void ImageWidget::updateImage(const std::string& data) {
     if (isBase64Data(data)) {
         ESP_LOGI(TAG, "Detected base64-encoded image data");
         success = loadImageFromBase64(data);
+        if (success) {
+            m_image_path.clear();  // Don't keep a second copy of the encoded image
+        }
     } else {
         ESP_LOGI(TAG, "Detected file path: %s", data.c_str());
         success = loadImageFromPath(data);
+        if (success) {
+            m_image_path = data;
+        }
     }
     
     if (success) {
-        m_image_path = data;
         ESP_LOGI(TAG, "Updated image %s successfully", m_id.c_str());
     } else {
         ESP_LOGE(TAG, "Failed to update image %s", m_id.c_str());
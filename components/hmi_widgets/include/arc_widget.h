@@ -10,6 +10,7 @@ public:
     
 private:
     static void arc_event_cb(lv_event_t* e);
+    static void release_event_cb(lv_event_t* e);
     static void async_update_cb(void* user_data);
     
     void updateValue(int value);
@@ -20,6 +21,7 @@ private:
     int m_value;
     int m_pending_value = 0;
     bool m_retained;
+    float m_publish_rate_hz = 10.0f;  // Max publishes per second while dragging, 0 = unlimited
     bool m_updating_from_mqtt = false;
     uint32_t m_subscription_handle = 0;  // MQTT subscription handle
     lv_color_t m_color;
@@ -5,13 +5,14 @@
 #include "cJSON.h"
 
 /**
- * @brief Button widget - publishes MQTT message on click
+ * @brief Button widget - publishes MQTT message and/or switches page on click
  */
 class ButtonWidget : public HMIWidget {
 public:
     ButtonWidget(const std::string& id, int x, int y, int w, int h, cJSON* properties, lv_obj_t* parent = nullptr);
     ~ButtonWidget() override;
     void onMqttMessage(const std::string& topic, const std::string& payload) override;
+    bool applyProperties(cJSON* changed) override;
 
 private:
     static void button_event_cb(lv_event_t* e);
@@ -19,6 +20,7 @@ private:
     std::string m_button_text;
     std::string m_mqtt_topic;
     std::string m_mqtt_payload;
+    std::string m_navigate;   // Page to show on click ("back", "next", "prev" or a page id)
     lv_obj_t* m_label;
     lv_color_t m_color;
     bool m_has_color = false;
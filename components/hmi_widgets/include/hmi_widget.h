@@ -1,9 +1,12 @@
 #ifndef HMI_WIDGET_H
 #define HMI_WIDGET_H
 
+#include <atomic>
+#include <functional>
 #include <string>
 #include "lvgl.h"
 #include "cJSON.h"
+#include "mqtt_payload.h"
 
 /**
  * @brief Base class for all HMI widgets
@@ -18,7 +21,28 @@ public:
      * @param payload Message payload
      */
     virtual void onMqttMessage(const std::string& topic, const std::string& payload) = 0;
+
+    /**
+     * @brief Handle incoming MQTT message as a shared payload buffer
+     *
+     * Widgets that defer large payloads to the LVGL thread override this to keep
+     * a reference to the buffer instead of copying it. Default forwards to onMqttMessage.
+     * @param topic MQTT topic
+     * @param payload Shared immutable payload
+     */
+    virtual void onMqttPayload(const std::string& topic, const MqttPayload& payload) {
+        onMqttMessage(topic, payload.str());
+    }
     
+    /**
+     * @brief Apply changed properties to the live widget on config reload
+     *
+     * Called on the LVGL thread with only the properties whose values changed.
+     * Return false if any of them cannot be applied in place; the widget is then recreated.
+     * @param changed Object holding the changed properties
+     */
+    virtual bool applyProperties(cJSON* changed) { return false; }
+
     /**
      * @brief Get widget ID
      */
@@ -29,14 +53,43 @@ public:
      */
     lv_obj_t* getLvglObject() const { return m_lvgl_obj; }
 
+    /**
+     * @brief Handler for page navigation requested by widgets ("navigate" property)
+     *
+     * Installed by ConfigManager; called on the LVGL thread with a page id, "back", "next" or "prev".
+     */
+    using NavigateHandler = std::function<void(const std::string& target)>;
+    static void setNavigateHandler(NavigateHandler handler);
+
 protected:
-    void scheduleAsync(lv_async_cb_t cb, void* user_data);
-    void cancelAsync(lv_async_cb_t cb, void* user_data);
-    void markAsyncComplete();
+    /**
+     * @brief Run cb(user_data) on the LVGL thread before the next frame (any task)
+     *
+     * Calls made while an update is pending coalesce into it, so cb should apply
+     * the latest pending value. See WidgetUpdateBus.
+     */
+    void scheduleUpdate(lv_async_cb_t cb, void* user_data);
+
+    /**
+     * @brief Drop a pending update; call from the destructor (LVGL thread)
+     */
+    void cancelUpdate();
+
+    /**
+     * @brief Switch to another page (LVGL thread)
+     */
+    static void navigate(const std::string& target);
 
     std::string m_id;
     lv_obj_t* m_lvgl_obj = nullptr;
-    bool m_async_pending = false;
+
+private:
+    friend class WidgetUpdateBus;
+
+    std::atomic<bool> m_update_pending{false};
+    std::atomic<lv_async_cb_t> m_update_cb{nullptr};
+    std::atomic<void*> m_update_data{nullptr};
+    HMIWidget* m_next_dirty = nullptr;  // Link in the WidgetUpdateBus queue
 };
 
 #endif // HMI_WIDGET_H
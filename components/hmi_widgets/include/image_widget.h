@@ -5,6 +5,8 @@
 #include "cJSON.h"
 #include <string>
 #include <vector>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
 /**
  * @brief Image widget - displays images from SD card or base64-encoded data
@@ -17,6 +19,7 @@ public:
     ImageWidget(const std::string& id, int x, int y, int w, int h, cJSON* properties, lv_obj_t* parent = nullptr);
     ~ImageWidget() override;
     void onMqttMessage(const std::string& topic, const std::string& payload) override;
+    void onMqttPayload(const std::string& topic, const MqttPayload& payload) override;
 
 private:
     static void async_update_cb(void* user_data);
@@ -34,9 +37,12 @@ private:
     void schedule_free(lv_image_dsc_t* dsc, uint8_t* data);
     
     std::string m_image_path;
-    std::string m_pending_data;
+    MqttPayload m_pending_payload;  // Shared with MQTTManager, not copied (guarded by m_pending_mutex)
+    SemaphoreHandle_t m_pending_mutex = nullptr;
     std::string m_mqtt_topic;
     uint32_t m_subscription_handle = 0;
+    size_t m_max_message_size = 3 * 1024 * 1024;  // Base64 QOI of a full-screen image exceeds the 1MB MQTT default
+    bool m_size_limit_set = false;  // Claimed with setMaxMessageSize(), cleared on destruction
     lv_image_dsc_t* m_img_dsc = nullptr;
     uint8_t* m_decoded_data = nullptr;  // For base64 decoded images
     size_t m_decoded_size = 0;
@@ -12,6 +12,7 @@ public:
     LabelWidget(const std::string& id, int x, int y, int w, int h, cJSON* properties, lv_obj_t* parent = nullptr);
     ~LabelWidget() override;
     void onMqttMessage(const std::string& topic, const std::string& payload) override;
+    bool applyProperties(cJSON* changed) override;
 
 private:
     static void async_update_cb(void* user_data);
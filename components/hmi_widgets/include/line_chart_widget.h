@@ -1,7 +1,22 @@
 #pragma once
 
 #include "hmi_widget.h"
+#include <vector>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
+/**
+ * @brief Line chart widget - scrolling trace of numeric MQTT samples
+ *
+ * One or more series, each fed by its own topic and optionally a JSON field of
+ * the payload. A message carries one sample or a batch ("[1,2,3]", "1,2,3" or an
+ * array of objects). Values are floats scaled by `decimals` onto the chart axis.
+ *
+ * When the history window (`history` samples or `window_ms`) is longer than the
+ * chart has points, samples are min/max decimated as they arrive: each bucket is
+ * drawn as two points (its minimum and maximum) so peaks survive. Raw samples are
+ * never stored, so memory is proportional to `points` (default: chart width).
+ */
 class LineChartWidget : public HMIWidget {
 public:
     LineChartWidget(const std::string& id, int x, int y, int w, int h, cJSON* properties, lv_obj_t* parent = nullptr);
@@ -9,14 +24,48 @@ public:
     void onMqttMessage(const std::string& topic, const std::string& payload) override;
 
 private:
+    struct Series {
+        std::string mqtt_topic;   // Empty: samples from any topic delivered to the chart
+        std::string field;        // Dotted JSON path of the value, empty for plain numbers
+        float scale = 1.0f;
+        float offset = 0.0f;
+        lv_color_t color;
+        lv_chart_series_t* lv_series = nullptr;
+
+        // Bucket being decimated
+        uint32_t bucket_samples = 0;
+        int64_t bucket_index = -1;  // Time mode: bucket number of the open bucket
+        int32_t bucket_min = 0;
+        int32_t bucket_max = 0;
+        bool min_first = true;
+
+        // Chart points waiting for the next frame, oldest first
+        std::vector<int32_t> pending;
+        size_t pending_start = 0;
+        size_t pending_count = 0;
+        uint32_t dropped = 0;
+    };
+
     static void async_update_cb(void* user_data);
-    void pushValue(int value);
+    void parseSeries(cJSON* properties, lv_color_t default_color);
+    bool ingestNumbers(Series& series, const std::string& payload, uint32_t now_ms);
+    bool ingestJson(Series& series, cJSON* root, uint32_t now_ms);
+    bool ingestObject(Series& series, cJSON* object, uint32_t now_ms);
+    void addSample(Series& series, double value, int64_t time_ms);
+    void closeBucket(Series& series);
+    void queuePoint(Series& series, int32_t point);
+    int32_t toAxis(double value) const;
+    void applyPendingPoints();
 
     std::string m_mqtt_topic;
-    int m_min_value = 0;
-    int m_max_value = 100;
-    int m_pending_value = 0;
+    float m_min_value = 0;
+    float m_max_value = 100;
+    float m_axis_factor = 1.0f;          // 10^decimals
     int m_point_count = 32;
-    uint32_t m_subscription_handle = 0;
-    lv_chart_series_t* m_series = nullptr;
+    uint32_t m_samples_per_bucket = 1;   // Count mode; 1 means no decimation
+    uint32_t m_bucket_ms = 0;            // Time mode when non-zero
+    std::string m_time_field;            // JSON field with the sample time in ms
+    std::vector<Series> m_series;
+    std::vector<uint32_t> m_subscription_handles;
+    SemaphoreHandle_t m_pending_mutex = nullptr;
 };
@@ -10,6 +10,7 @@ public:
     
 private:
     static void slider_event_cb(lv_event_t* e);
+    static void release_event_cb(lv_event_t* e);
     static void async_update_cb(void* user_data);
     
     void updateValue(int value);
@@ -21,6 +22,7 @@ private:
     int m_value;
     int m_pending_value = 0;
     bool m_retained;
+    float m_publish_rate_hz = 10.0f;  // Max publishes per second while dragging, 0 = unlimited
     bool m_updating_from_mqtt = false;  // Prevent feedback loop
     int m_last_published_value = -1;  // Track last published value to ignore echo
     uint32_t m_subscription_handle = 0;  // MQTT subscription handle
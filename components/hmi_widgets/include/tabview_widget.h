@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <functional>
 
 class TabviewWidget : public HMIWidget {
 public:
@@ -17,6 +18,9 @@ public:
     // Get all tab names
     const std::vector<std::string>& getTabNames() const { return m_tab_names; }
 
+    // Called on the LVGL thread with the tab index whenever a tab becomes active (touch or MQTT)
+    void setTabActivatedCallback(std::function<void(uint32_t)> callback) { m_tab_activated = std::move(callback); }
+
 private:
     static void tab_changed_event_cb(lv_event_t* e);
     static void async_tab_update(void * user_data);
@@ -29,4 +33,5 @@ private:
     bool m_updating_from_mqtt;
     uint32_t m_active_tab;
     uint32_t m_subscription_handle = 0;  // MQTT subscription handle
+    std::function<void(uint32_t)> m_tab_activated;
 };
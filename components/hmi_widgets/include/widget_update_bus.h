@@ -0,0 +1,80 @@
+#ifndef WIDGET_UPDATE_BUS_H
+#define WIDGET_UPDATE_BUS_H
+
+#include <atomic>
+#include <cstdint>
+#include "lvgl.h"
+
+class HMIWidget;
+
+/**
+ * @brief Per-frame queue of widgets with pending MQTT updates
+ *
+ * Any task marks a widget dirty with HMIWidget::scheduleUpdate(); the widget is
+ * linked into a lock-free multi-producer list at most once, no matter how many
+ * messages arrive before the next frame. One LVGL timer running at the display
+ * refresh period drains the list and applies every pending update in a single
+ * pass, so no timer or allocation is needed per update.
+ */
+class WidgetUpdateBus {
+public:
+    static WidgetUpdateBus& getInstance();
+
+    /**
+     * @brief Start draining once per display refresh period (LVGL thread only)
+     */
+    void init();
+
+    /**
+     * @brief Mark a widget dirty (any task)
+     * @return false if an update was already pending and this one was coalesced into it
+     */
+    bool schedule(HMIWidget* widget);
+
+    /**
+     * @brief Drop a pending update of a widget that is being destroyed (LVGL thread only)
+     *
+     * If another task is still inside schedule() for it, waits until it has linked the widget.
+     */
+    void cancel(HMIWidget* widget);
+
+    /**
+     * @brief Apply all pending updates now (LVGL thread only)
+     */
+    void drain();
+
+    /** @brief Updates applied since boot */
+    uint32_t getAppliedUpdates() const { return m_applied.load(std::memory_order_relaxed); }
+
+    /** @brief Updates dropped because a newer value superseded them before the frame */
+    uint32_t getCoalescedUpdates() const { return m_coalesced.load(std::memory_order_relaxed); }
+
+    /** @brief Largest number of widgets updated in one frame */
+    uint32_t getMaxBatch() const { return m_max_batch.load(std::memory_order_relaxed); }
+
+private:
+    WidgetUpdateBus() = default;
+    WidgetUpdateBus(const WidgetUpdateBus&) = delete;
+    WidgetUpdateBus& operator=(const WidgetUpdateBus&) = delete;
+
+    static void timer_cb(lv_timer_t* timer);
+
+    // Move everything pushed so far to the end of m_ready, in arrival order
+    void collect();
+    // Remove a widget from m_ready; false if it is not there
+    bool unlink(HMIWidget* widget);
+    void logStats();
+
+    std::atomic<HMIWidget*> m_head{nullptr};  // Producers push here (LIFO)
+    HMIWidget* m_ready = nullptr;             // LVGL thread only (FIFO)
+    HMIWidget* m_ready_tail = nullptr;
+    lv_timer_t* m_timer = nullptr;
+
+    std::atomic<uint32_t> m_applied{0};
+    std::atomic<uint32_t> m_coalesced{0};
+    std::atomic<uint32_t> m_max_batch{0};
+    uint32_t m_logged_applied = 0;
+    uint32_t m_last_log_ms = 0;
+};
+
+#endif // WIDGET_UPDATE_BUS_H
@@ -2,9 +2,35 @@
 #include "mqtt_manager.h"
 #include <esp_log.h>
 #include <cstdio>
+#include <cstring>
 
 static const char *TAG = "LabelWidget";
 
+// LVGL built-in fonts: 10, 12, 14, 16, 18, 20, 24, 28, 32, 36, 48
+static const lv_font_t* fontForSize(int font_size) {
+    if (font_size <= 10) return &lv_font_montserrat_10;
+    if (font_size <= 12) return &lv_font_montserrat_12;
+    if (font_size <= 14) return &lv_font_montserrat_14;
+    if (font_size <= 16) return &lv_font_montserrat_16;
+    if (font_size <= 18) return &lv_font_montserrat_18;
+    if (font_size <= 20) return &lv_font_montserrat_20;
+    if (font_size <= 24) return &lv_font_montserrat_24;
+    if (font_size <= 28) return &lv_font_montserrat_28;
+    if (font_size <= 32) return &lv_font_montserrat_32;
+    if (font_size <= 36) return &lv_font_montserrat_36;
+    return &lv_font_montserrat_48;
+}
+
+static void applyAlign(lv_obj_t* obj, const char* align_str) {
+    if (strcmp(align_str, "center") == 0) {
+        lv_obj_set_style_text_align(obj, LV_TEXT_ALIGN_CENTER, LV_PART_MAIN);
+    } else if (strcmp(align_str, "right") == 0) {
+        lv_obj_set_style_text_align(obj, LV_TEXT_ALIGN_RIGHT, LV_PART_MAIN);
+    } else if (strcmp(align_str, "left") == 0) {
+        lv_obj_set_style_text_align(obj, LV_TEXT_ALIGN_LEFT, LV_PART_MAIN);
+    }
+}
+
 LabelWidget::LabelWidget(const std::string& id, int x, int y, int w, int h, cJSON* properties, lv_obj_t* parent) {
     m_id = id;
     
@@ -66,34 +92,12 @@ LabelWidget::LabelWidget(const std::string& id, int x, int y, int w, int h, cJSO
     
     // Apply text alignment
     if (align_str) {
-        if (strcmp(align_str, "center") == 0) {
-            lv_obj_set_style_text_align(m_lvgl_obj, LV_TEXT_ALIGN_CENTER, LV_PART_MAIN);
-        } else if (strcmp(align_str, "right") == 0) {
-            lv_obj_set_style_text_align(m_lvgl_obj, LV_TEXT_ALIGN_RIGHT, LV_PART_MAIN);
-        } else if (strcmp(align_str, "left") == 0) {
-            lv_obj_set_style_text_align(m_lvgl_obj, LV_TEXT_ALIGN_LEFT, LV_PART_MAIN);
-        }
+        applyAlign(m_lvgl_obj, align_str);
     }
     
     // Apply font size
     if (font_size > 0) {
-        // LVGL built-in fonts: 10, 12, 14, 16, 18, 20, 24, 28, 32, 36, 48
-        const lv_font_t* font = nullptr;
-        if (font_size <= 10) font = &lv_font_montserrat_10;
-        else if (font_size <= 12) font = &lv_font_montserrat_12;
-        else if (font_size <= 14) font = &lv_font_montserrat_14;
-        else if (font_size <= 16) font = &lv_font_montserrat_16;
-        else if (font_size <= 18) font = &lv_font_montserrat_18;
-        else if (font_size <= 20) font = &lv_font_montserrat_20;
-        else if (font_size <= 24) font = &lv_font_montserrat_24;
-        else if (font_size <= 28) font = &lv_font_montserrat_28;
-        else if (font_size <= 32) font = &lv_font_montserrat_32;
-        else if (font_size <= 36) font = &lv_font_montserrat_36;
-        else font = &lv_font_montserrat_48;
-        
-        if (font) {
-            lv_obj_set_style_text_font(m_lvgl_obj, font, LV_PART_MAIN);
-        }
+        lv_obj_set_style_text_font(m_lvgl_obj, fontForSize(font_size), LV_PART_MAIN);
     }
     
     // Apply custom color if specified
@@ -118,7 +122,7 @@ LabelWidget::LabelWidget(const std::string& id, int x, int y, int w, int h, cJSO
 }
 
 LabelWidget::~LabelWidget() {
-    cancelAsync(async_update_cb, this);
+    cancelUpdate();
     if (m_subscription_handle != 0) {
         MQTTManager::getInstance().unsubscribe(m_subscription_handle);
         m_subscription_handle = 0;
@@ -144,7 +148,48 @@ void LabelWidget::onMqttMessage(const std::string& topic, const std::string& pay
     
     // Use async call to update LVGL widget from LVGL thread
     m_pending_text = new_text;
-    scheduleAsync(async_update_cb, this);
+    scheduleUpdate(async_update_cb, this);
+}
+
+bool LabelWidget::applyProperties(cJSON* changed) {
+    if (!m_lvgl_obj || !lv_obj_is_valid(m_lvgl_obj)) {
+        return false;
+    }
+
+    // Validate everything first so a rejected update leaves the label untouched
+    cJSON* item = nullptr;
+    cJSON_ArrayForEach(item, changed) {
+        const char* key = item->string;
+        bool ok = (strcmp(key, "text") == 0 && cJSON_IsString(item)) ||
+                  (strcmp(key, "format") == 0 && cJSON_IsString(item)) ||
+                  (strcmp(key, "color") == 0 && cJSON_IsString(item) && item->valuestring[0] == '#') ||
+                  (strcmp(key, "font_size") == 0 && cJSON_IsNumber(item) && item->valueint > 0) ||
+                  (strcmp(key, "align") == 0 && cJSON_IsString(item));
+        if (!ok) {
+            return false;
+        }
+    }
+
+    cJSON_ArrayForEach(item, changed) {
+        const char* key = item->string;
+        if (strcmp(key, "text") == 0) {
+            // Static text only shows until the first MQTT update
+            if (m_mqtt_topic.empty()) {
+                updateText(item->valuestring);
+            }
+        } else if (strcmp(key, "format") == 0) {
+            m_format = item->valuestring;
+        } else if (strcmp(key, "color") == 0) {
+            m_color = lv_color_hex(strtol(item->valuestring + 1, NULL, 16));
+            m_has_color = true;
+            lv_obj_set_style_text_color(m_lvgl_obj, m_color, LV_PART_MAIN);
+        } else if (strcmp(key, "font_size") == 0) {
+            lv_obj_set_style_text_font(m_lvgl_obj, fontForSize(item->valueint), LV_PART_MAIN);
+        } else if (strcmp(key, "align") == 0) {
+            applyAlign(m_lvgl_obj, item->valuestring);
+        }
+    }
+    return true;
 }
 
 void LabelWidget::async_update_cb(void* user_data) {
@@ -152,7 +197,6 @@ void LabelWidget::async_update_cb(void* user_data) {
     if (!widget) {
         return;
     }
-    widget->markAsyncComplete();
     widget->updateText(widget->m_pending_text);
 }
 
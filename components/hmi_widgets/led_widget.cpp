@@ -73,7 +73,7 @@ LEDWidget::LEDWidget(const std::string& id, int x, int y, int w, int h, cJSON* p
 }
 
 LEDWidget::~LEDWidget() {
-    cancelAsync(async_update_cb, this);
+    cancelUpdate();
     if (m_subscription_handle != 0) {
         MQTTManager::getInstance().unsubscribe(m_subscription_handle);
         m_subscription_handle = 0;
@@ -99,7 +99,7 @@ void LEDWidget::onMqttMessage(const std::string& topic, const std::string& paylo
     }
 
     m_pending_brightness = new_brightness;
-    scheduleAsync(async_update_cb, this);
+    scheduleUpdate(async_update_cb, this);
 }
 
 void LEDWidget::async_update_cb(void* user_data) {
@@ -107,7 +107,6 @@ void LEDWidget::async_update_cb(void* user_data) {
     if (!widget) {
         return;
     }
-    widget->markAsyncComplete();
     widget->updateBrightness(widget->m_pending_brightness);
 }
 
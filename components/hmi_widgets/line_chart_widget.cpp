@@ -1,34 +1,83 @@
 #include "line_chart_widget.h"
 #include "mqtt_manager.h"
 #include <esp_log.h>
+#include "freertos/task.h"
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>
 
 static const char *TAG = "LineChartWidget";
 
+static constexpr size_t MAX_SERIES = 8;
+static constexpr int MAX_DECIMALS = 6;
+
+static const lv_palette_t SERIES_PALETTE[] = {
+    LV_PALETTE_BLUE, LV_PALETTE_RED, LV_PALETTE_GREEN, LV_PALETTE_ORANGE,
+    LV_PALETTE_PURPLE, LV_PALETTE_TEAL, LV_PALETTE_PINK, LV_PALETTE_LIME,
+};
+
+static bool isSampleSeparator(char c) {
+    return c == ',' || c == ';' || c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '[' || c == ']';
+}
+
+// A series subscribes with its own topic, which may be a wildcard filter, or takes every message
+static bool seriesReceives(const std::string& series_topic, const std::string& topic) {
+    return series_topic.empty() || TopicTrie<int>::filterMatches(series_topic, topic);
+}
+
+static bool parseColor(cJSON* item, lv_color_t& color) {
+    if (!item || !cJSON_IsString(item) || item->valuestring[0] != '#') {
+        return false;
+    }
+    color = lv_color_hex(strtol(item->valuestring + 1, NULL, 16));
+    return true;
+}
+
+// Resolve a dotted path such as "sensor.temp" inside a JSON object
+static cJSON* findField(cJSON* object, const std::string& path) {
+    size_t start = 0;
+    cJSON* item = object;
+    while (item && start <= path.size()) {
+        size_t dot = path.find('.', start);
+        std::string key = path.substr(start, dot == std::string::npos ? std::string::npos : dot - start);
+        item = cJSON_IsObject(item) ? cJSON_GetObjectItemCaseSensitive(item, key.c_str()) : nullptr;
+        if (dot == std::string::npos) {
+            break;
+        }
+        start = dot + 1;
+    }
+    return item;
+}
+
 LineChartWidget::LineChartWidget(const std::string& id, int x, int y, int w, int h, cJSON* properties, lv_obj_t* parent) {
     m_id = id;
-    int initial_value = 0;
+    double initial_value = 0;
+    int decimals = 0;
+    int history = 0;
+    int window_ms = 0;
+    bool has_points = false;
     lv_color_t line_color = lv_palette_main(LV_PALETTE_BLUE);
 
     if (properties) {
         cJSON* min_item = cJSON_GetObjectItem(properties, "min");
         if (min_item && cJSON_IsNumber(min_item)) {
-            m_min_value = min_item->valueint;
+            m_min_value = min_item->valuedouble;
         }
 
         cJSON* max_item = cJSON_GetObjectItem(properties, "max");
         if (max_item && cJSON_IsNumber(max_item)) {
-            m_max_value = max_item->valueint;
+            m_max_value = max_item->valuedouble;
         }
 
         cJSON* points_item = cJSON_GetObjectItem(properties, "points");
         if (points_item && cJSON_IsNumber(points_item)) {
             m_point_count = points_item->valueint;
+            has_points = true;
         }
 
         cJSON* value_item = cJSON_GetObjectItem(properties, "value");
         if (value_item && cJSON_IsNumber(value_item)) {
-            initial_value = value_item->valueint;
+            initial_value = value_item->valuedouble;
         }
 
         cJSON* mqtt_topic = cJSON_GetObjectItem(properties, "mqtt_topic");
@@ -36,29 +85,53 @@ LineChartWidget::LineChartWidget(const std::string& id, int x, int y, int w, int
             m_mqtt_topic = mqtt_topic->valuestring;
         }
 
-        cJSON* color_item = cJSON_GetObjectItem(properties, "color");
-        if (color_item && cJSON_IsString(color_item)) {
-            const char* color_str = color_item->valuestring;
-            if (color_str[0] == '#') {
-                uint32_t color = strtol(color_str + 1, NULL, 16);
-                line_color = lv_color_hex(color);
-            }
+        parseColor(cJSON_GetObjectItem(properties, "color"), line_color);
+
+        cJSON* decimals_item = cJSON_GetObjectItem(properties, "decimals");
+        if (decimals_item && cJSON_IsNumber(decimals_item)) {
+            decimals = std::clamp(decimals_item->valueint, 0, MAX_DECIMALS);
+        }
+
+        cJSON* history_item = cJSON_GetObjectItem(properties, "history");
+        if (history_item && cJSON_IsNumber(history_item)) {
+            history = history_item->valueint;
+        }
+
+        cJSON* window_item = cJSON_GetObjectItem(properties, "window_ms");
+        if (window_item && cJSON_IsNumber(window_item)) {
+            window_ms = window_item->valueint;
+        }
+
+        cJSON* time_field = cJSON_GetObjectItem(properties, "time_field");
+        if (time_field && cJSON_IsString(time_field)) {
+            m_time_field = time_field->valuestring;
         }
     }
 
     if (m_min_value > m_max_value) {
-        int temp = m_min_value;
-        m_min_value = m_max_value;
-        m_max_value = temp;
+        std::swap(m_min_value, m_max_value);
     }
 
+    // A decimated window is drawn at one point per pixel unless told otherwise
+    if (!has_points && (history > 0 || window_ms > 0)) {
+        m_point_count = w;
+    }
     if (m_point_count < 1) {
         m_point_count = 1;
     }
 
-    if (initial_value < m_min_value) initial_value = m_min_value;
-    if (initial_value > m_max_value) initial_value = m_max_value;
-    m_pending_value = initial_value;
+    m_axis_factor = std::pow(10.0f, decimals);
+
+    // Each bucket becomes a min and a max point
+    int buckets = std::max(1, m_point_count / 2);
+    if (window_ms > 0) {
+        m_bucket_ms = std::max(1, window_ms / buckets);
+    } else if (history > m_point_count) {
+        m_samples_per_bucket = (history + buckets - 1) / buckets;
+    }
+
+    parseSeries(properties, line_color);
+    m_pending_mutex = xSemaphoreCreateMutex();
 
     lv_obj_t* parent_obj = parent ? parent : lv_screen_active();
     m_lvgl_obj = lv_chart_create(parent_obj);
@@ -71,56 +144,289 @@ LineChartWidget::LineChartWidget(const std::string& id, int x, int y, int w, int
     lv_obj_set_size(m_lvgl_obj, w, h);
 
     lv_chart_set_type(m_lvgl_obj, LV_CHART_TYPE_LINE);
-    lv_chart_set_range(m_lvgl_obj, LV_CHART_AXIS_PRIMARY_Y, m_min_value, m_max_value);
+    lv_chart_set_range(m_lvgl_obj, LV_CHART_AXIS_PRIMARY_Y, toAxis(m_min_value), toAxis(m_max_value));
     lv_chart_set_point_count(m_lvgl_obj, m_point_count);
     lv_chart_set_div_line_count(m_lvgl_obj, 5, 5);
 
-    m_series = lv_chart_add_series(m_lvgl_obj, line_color, LV_CHART_AXIS_PRIMARY_Y);
-    if (!m_series) {
-        ESP_LOGE(TAG, "Failed to create line chart series: %s", id.c_str());
-        return;
-    }
-
-    for (int i = 0; i < m_point_count; i++) {
-        lv_chart_set_next_value(m_lvgl_obj, m_series, initial_value);
+    int32_t initial_point = toAxis(std::clamp<double>(initial_value, m_min_value, m_max_value));
+    for (auto& series : m_series) {
+        series.lv_series = lv_chart_add_series(m_lvgl_obj, series.color, LV_CHART_AXIS_PRIMARY_Y);
+        if (!series.lv_series) {
+            ESP_LOGE(TAG, "Failed to create line chart series: %s", id.c_str());
+            continue;
+        }
+        lv_chart_set_all_value(m_lvgl_obj, series.lv_series, initial_point);
     }
     lv_chart_refresh(m_lvgl_obj);
 
-    if (!m_mqtt_topic.empty()) {
-        m_subscription_handle = MQTTManager::getInstance().subscribe(m_mqtt_topic, 0,
+    // One subscription per distinct topic; the message is routed to its series
+    std::vector<std::string> topics;
+    for (const auto& series : m_series) {
+        if (!series.mqtt_topic.empty() &&
+            std::find(topics.begin(), topics.end(), series.mqtt_topic) == topics.end()) {
+            topics.push_back(series.mqtt_topic);
+        }
+    }
+    for (const auto& topic : topics) {
+        uint32_t handle = MQTTManager::getInstance().subscribe(topic, 0,
             [this](const std::string& topic, const std::string& payload) {
                 this->onMqttMessage(topic, payload);
             });
 
-        if (m_subscription_handle != 0) {
-            ESP_LOGI(TAG, "Line chart %s subscribed to %s", id.c_str(), m_mqtt_topic.c_str());
+        if (handle != 0) {
+            m_subscription_handles.push_back(handle);
+            ESP_LOGI(TAG, "Line chart %s subscribed to %s", id.c_str(), topic.c_str());
         }
     }
 
-    ESP_LOGI(TAG, "Created line chart widget: %s at (%d,%d) size (%dx%d), points=%d range=[%d,%d]",
-             id.c_str(), x, y, w, h, m_point_count, m_min_value, m_max_value);
+    ESP_LOGI(TAG, "Created line chart widget: %s at (%d,%d) size (%dx%d), series=%d points=%d range=[%g,%g] "
+             "samples/bucket=%lu bucket_ms=%lu",
+             id.c_str(), x, y, w, h, (int)m_series.size(), m_point_count, m_min_value, m_max_value,
+             (unsigned long)m_samples_per_bucket, (unsigned long)m_bucket_ms);
 }
 
 LineChartWidget::~LineChartWidget() {
-    cancelAsync(async_update_cb, this);
-    if (m_subscription_handle != 0) {
-        MQTTManager::getInstance().unsubscribe(m_subscription_handle);
-        m_subscription_handle = 0;
+    cancelUpdate();
+    for (uint32_t handle : m_subscription_handles) {
+        MQTTManager::getInstance().unsubscribe(handle);
     }
+    m_subscription_handles.clear();
 
     if (m_lvgl_obj && lv_obj_is_valid(m_lvgl_obj)) {
         lv_obj_delete(m_lvgl_obj);
         m_lvgl_obj = nullptr;
     }
+
+    if (m_pending_mutex) {
+        vSemaphoreDelete(m_pending_mutex);
+        m_pending_mutex = nullptr;
+    }
+}
+
+void LineChartWidget::parseSeries(cJSON* properties, lv_color_t default_color) {
+    // Per-series settings; the chart's own properties are the defaults
+    auto addSeries = [this](cJSON* source, lv_color_t color) {
+        Series series;
+        series.mqtt_topic = m_mqtt_topic;
+        series.color = color;
+
+        cJSON* topic = cJSON_GetObjectItem(source, "mqtt_topic");
+        if (topic && cJSON_IsString(topic)) {
+            series.mqtt_topic = topic->valuestring;
+        }
+        cJSON* field = cJSON_GetObjectItem(source, "field");
+        if (field && cJSON_IsString(field)) {
+            series.field = field->valuestring;
+        }
+        cJSON* scale = cJSON_GetObjectItem(source, "scale");
+        if (scale && cJSON_IsNumber(scale)) {
+            series.scale = scale->valuedouble;
+        }
+        cJSON* offset = cJSON_GetObjectItem(source, "offset");
+        if (offset && cJSON_IsNumber(offset)) {
+            series.offset = offset->valuedouble;
+        }
+
+        series.pending.resize(m_point_count);
+        m_series.push_back(std::move(series));
+    };
+
+    cJSON* series_array = properties ? cJSON_GetObjectItem(properties, "series") : nullptr;
+    if (series_array && cJSON_IsArray(series_array)) {
+        cJSON* item = nullptr;
+        cJSON_ArrayForEach(item, series_array) {
+            if (!cJSON_IsObject(item)) {
+                continue;
+            }
+            if (m_series.size() == MAX_SERIES) {
+                ESP_LOGW(TAG, "Line chart %s: more than %d series, ignoring the rest", m_id.c_str(), (int)MAX_SERIES);
+                break;
+            }
+            lv_color_t color = lv_palette_main(SERIES_PALETTE[m_series.size()]);
+            parseColor(cJSON_GetObjectItem(item, "color"), color);
+            addSeries(item, color);
+        }
+    }
+
+    if (m_series.empty()) {
+        // Single series configured directly on the chart
+        addSeries(properties, default_color);
+    }
 }
 
 void LineChartWidget::onMqttMessage(const std::string& topic, const std::string& payload) {
-    int value = atoi(payload.c_str());
-    if (value < m_min_value) value = m_min_value;
-    if (value > m_max_value) value = m_max_value;
+    if (!m_pending_mutex) {
+        return;
+    }
+
+    // Parse JSON once per message, only if a receiving series reads a field
+    cJSON* root = nullptr;
+    for (const auto& series : m_series) {
+        if (seriesReceives(series.mqtt_topic, topic) && !series.field.empty()) {
+            root = cJSON_ParseWithLength(payload.data(), payload.size());
+            if (!root) {
+                ESP_LOGW(TAG, "Line chart %s: payload on %s is not JSON", m_id.c_str(), topic.c_str());
+            }
+            break;
+        }
+    }
 
-    m_pending_value = value;
-    scheduleAsync(async_update_cb, this);
+    uint32_t now_ms = pdTICKS_TO_MS(xTaskGetTickCount());
+    bool queued = false;
+    xSemaphoreTake(m_pending_mutex, portMAX_DELAY);
+    for (auto& series : m_series) {
+        if (!seriesReceives(series.mqtt_topic, topic)) {
+            continue;
+        }
+        if (series.field.empty()) {
+            queued |= ingestNumbers(series, payload, now_ms);
+        } else if (root) {
+            queued |= ingestJson(series, root, now_ms);
+        }
+    }
+    xSemaphoreGive(m_pending_mutex);
+    cJSON_Delete(root);
+
+    if (queued) {
+        scheduleUpdate(async_update_cb, this);
+    }
+}
+
+// One sample or a batch: JSON array or comma/space separated list (caller holds m_pending_mutex)
+bool LineChartWidget::ingestNumbers(Series& series, const std::string& payload, uint32_t now_ms) {
+    size_t queued_before = series.pending_count + series.dropped;
+    int invalid = 0;
+    const char* p = payload.c_str();
+    const char* end = p + payload.size();
+    while (p < end) {
+        if (isSampleSeparator(*p)) {
+            p++;
+            continue;
+        }
+        char* next = nullptr;
+        double value = strtod(p, &next);
+        if (next == p || std::isnan(value)) {
+            // Not a number: skip the token
+            while (p < end && !isSampleSeparator(*p)) {
+                p++;
+            }
+            invalid++;
+            continue;
+        }
+        p = next;
+        addSample(series, value, now_ms);
+    }
+
+    if (invalid > 0) {
+        ESP_LOGW(TAG, "Line chart %s: ignored %d invalid sample(s)", m_id.c_str(), invalid);
+    }
+    return series.pending_count + series.dropped != queued_before;
+}
+
+// Object, array of objects, or plain numbers (caller holds m_pending_mutex)
+bool LineChartWidget::ingestJson(Series& series, cJSON* root, uint32_t now_ms) {
+    size_t queued_before = series.pending_count + series.dropped;
+    if (cJSON_IsArray(root)) {
+        cJSON* element = nullptr;
+        cJSON_ArrayForEach(element, root) {
+            if (cJSON_IsObject(element)) {
+                ingestObject(series, element, now_ms);
+            } else if (cJSON_IsNumber(element)) {
+                addSample(series, element->valuedouble, now_ms);
+            }
+        }
+    } else if (cJSON_IsObject(root)) {
+        ingestObject(series, root, now_ms);
+    } else if (cJSON_IsNumber(root)) {
+        addSample(series, root->valuedouble, now_ms);
+    }
+    return series.pending_count + series.dropped != queued_before;
+}
+
+bool LineChartWidget::ingestObject(Series& series, cJSON* object, uint32_t now_ms) {
+    cJSON* value = findField(object, series.field);
+    if (!value || !cJSON_IsNumber(value)) {
+        return false;
+    }
+    int64_t time_ms = now_ms;
+    if (!m_time_field.empty()) {
+        cJSON* time_item = findField(object, m_time_field);
+        if (time_item && cJSON_IsNumber(time_item)) {
+            time_ms = static_cast<int64_t>(time_item->valuedouble);
+        }
+    }
+    addSample(series, value->valuedouble, time_ms);
+    return true;
+}
+
+void LineChartWidget::addSample(Series& series, double value, int64_t time_ms) {
+    value = std::clamp<double>(value * series.scale + series.offset, m_min_value, m_max_value);
+    int32_t point = toAxis(value);
+
+    if (m_bucket_ms > 0) {
+        int64_t index = time_ms / m_bucket_ms;
+        int64_t buckets = std::max(1, m_point_count / 2);
+        if (series.bucket_index < 0 || index < series.bucket_index - buckets) {
+            series.bucket_index = index;  // First sample, or the source clock jumped back
+        } else if (index > series.bucket_index) {
+            closeBucket(series);
+            // Buckets without samples are drawn as gaps
+            int64_t gaps = std::min(index - series.bucket_index - 1, buckets);
+            for (int64_t i = 0; i < gaps; i++) {
+                queuePoint(series, LV_CHART_POINT_NONE);
+                queuePoint(series, LV_CHART_POINT_NONE);
+            }
+            series.bucket_index = index;
+        }
+        // Late samples fold into the open bucket
+    } else if (m_samples_per_bucket == 1) {
+        queuePoint(series, point);
+        return;
+    }
+
+    if (series.bucket_samples == 0) {
+        series.bucket_min = point;
+        series.bucket_max = point;
+        series.min_first = true;
+    } else if (point < series.bucket_min) {
+        series.bucket_min = point;
+        series.min_first = false;
+    } else if (point > series.bucket_max) {
+        series.bucket_max = point;
+        series.min_first = true;
+    }
+    series.bucket_samples++;
+
+    if (m_bucket_ms == 0 && series.bucket_samples >= m_samples_per_bucket) {
+        closeBucket(series);
+    }
+}
+
+// Emit the open bucket as its min and max, in the order they occurred
+void LineChartWidget::closeBucket(Series& series) {
+    if (series.bucket_samples == 0) {
+        return;
+    }
+    queuePoint(series, series.min_first ? series.bucket_min : series.bucket_max);
+    queuePoint(series, series.min_first ? series.bucket_max : series.bucket_min);
+    series.bucket_samples = 0;
+}
+
+// Points older than one screen would scroll out before they are drawn
+void LineChartWidget::queuePoint(Series& series, int32_t point) {
+    size_t capacity = series.pending.size();
+    if (series.pending_count == capacity) {
+        series.pending_start = (series.pending_start + 1) % capacity;
+        series.pending_count--;
+        series.dropped++;
+    }
+    series.pending[(series.pending_start + series.pending_count) % capacity] = point;
+    series.pending_count++;
+}
+
+int32_t LineChartWidget::toAxis(double value) const {
+    double scaled = std::round(value * m_axis_factor);
+    return static_cast<int32_t>(std::clamp(scaled, -2147483647.0, 2147483647.0));
 }
 
 void LineChartWidget::async_update_cb(void* user_data) {
@@ -128,15 +434,47 @@ void LineChartWidget::async_update_cb(void* user_data) {
     if (!widget) {
         return;
     }
-    widget->markAsyncComplete();
-    widget->pushValue(widget->m_pending_value);
+    widget->applyPendingPoints();
 }
 
-void LineChartWidget::pushValue(int value) {
-    if (!m_lvgl_obj || !lv_obj_is_valid(m_lvgl_obj) || !m_series) {
+void LineChartWidget::applyPendingPoints() {
+    if (!m_lvgl_obj || !lv_obj_is_valid(m_lvgl_obj)) {
         return;
     }
 
-    lv_chart_set_next_value(m_lvgl_obj, m_series, value);
+    bool changed = false;
+    uint32_t dropped = 0;
+    xSemaphoreTake(m_pending_mutex, portMAX_DELAY);
+    for (auto& series : m_series) {
+        if (!series.lv_series || series.pending_count == 0) {
+            series.pending_count = 0;
+            continue;
+        }
+
+        // Write straight into the series ring and move its start once
+        int32_t* points = lv_chart_get_y_array(m_lvgl_obj, series.lv_series);
+        uint32_t next = lv_chart_get_x_start_point(m_lvgl_obj, series.lv_series);
+        size_t capacity = series.pending.size();
+        for (size_t i = 0; i < series.pending_count; i++) {
+            points[next] = series.pending[(series.pending_start + i) % capacity];
+            next = (next + 1) % m_point_count;
+        }
+        lv_chart_set_x_start_point(m_lvgl_obj, series.lv_series, next);
+
+        series.pending_start = 0;
+        series.pending_count = 0;
+        dropped += series.dropped;
+        series.dropped = 0;
+        changed = true;
+    }
+    xSemaphoreGive(m_pending_mutex);
+
+    if (!changed) {
+        return;
+    }
     lv_chart_refresh(m_lvgl_obj);
+
+    if (dropped > 0) {
+        ESP_LOGD(TAG, "Line chart %s: %u point(s) scrolled out before the frame", m_id.c_str(), (unsigned)dropped);
+    }
 }
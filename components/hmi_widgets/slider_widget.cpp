@@ -46,6 +46,11 @@ SliderWidget::SliderWidget(const std::string& id, int x, int y, int w, int h, cJ
             m_retained = cJSON_IsTrue(retained_item);
         }
         
+        cJSON* rate_item = cJSON_GetObjectItem(properties, "publish_rate_hz");
+        if (rate_item && cJSON_IsNumber(rate_item) && rate_item->valuedouble >= 0) {
+            m_publish_rate_hz = static_cast<float>(rate_item->valuedouble);
+        }
+        
         cJSON* color_item = cJSON_GetObjectItem(properties, "color");
         if (color_item && cJSON_IsString(color_item)) {
             const char* color_str = color_item->valuestring;
@@ -86,6 +91,7 @@ SliderWidget::SliderWidget(const std::string& id, int x, int y, int w, int h, cJ
     
     // Add event callback
     lv_obj_add_event_cb(m_lvgl_obj, slider_event_cb, LV_EVENT_VALUE_CHANGED, this);
+    lv_obj_add_event_cb(m_lvgl_obj, release_event_cb, LV_EVENT_RELEASED, this);
     
     // Create value label below slider
     m_value_label = lv_label_create(parent_obj);
@@ -108,7 +114,7 @@ SliderWidget::SliderWidget(const std::string& id, int x, int y, int w, int h, cJ
 }
 
 SliderWidget::~SliderWidget() {
-    cancelAsync(async_update_cb, this);
+    cancelUpdate();
     if (m_subscription_handle != 0) {
         MQTTManager::getInstance().unsubscribe(m_subscription_handle);
         m_subscription_handle = 0;
@@ -148,18 +154,29 @@ void SliderWidget::onMqttMessage(const std::string& topic, const std::string& pa
         }
 
         m_pending_value = value;
-        scheduleAsync(async_update_cb, this);
+        scheduleUpdate(async_update_cb, this);
         
         ESP_LOGD(TAG, "Scheduled async update for slider %s: %d", m_id.c_str(), value);
     }
 }
 
+void SliderWidget::release_event_cb(lv_event_t* e) {
+    SliderWidget* widget = static_cast<SliderWidget*>(lv_event_get_user_data(e));
+    if (widget && !widget->m_mqtt_topic.empty()) {
+        // Send the value the user let go at, even if the rate limit held it back
+        MQTTManager::getInstance().flushPublish(widget->m_mqtt_topic);
+    }
+}
+
 void SliderWidget::async_update_cb(void* user_data) {
     SliderWidget* widget = static_cast<SliderWidget*>(user_data);
     if (!widget) {
         return;
     }
-    widget->markAsyncComplete();
+    // Don't move the knob under the user's finger; the released value wins
+    if (widget->m_lvgl_obj && lv_obj_has_state(widget->m_lvgl_obj, LV_STATE_PRESSED)) {
+        return;
+    }
     widget->updateValue(widget->m_pending_value);
 }
 
@@ -212,7 +229,8 @@ void SliderWidget::slider_event_cb(lv_event_t* e) {
         char payload[16];
         snprintf(payload, sizeof(payload), "%d", value);
         widget->m_last_published_value = value;  // Track published value to ignore echo
-        MQTTManager::getInstance().publish(widget->m_mqtt_topic, payload, 0, widget->m_retained);
+        MQTTManager::getInstance().publishThrottled(widget->m_mqtt_topic, payload, 0, widget->m_retained,
+                                                    widget->m_publish_rate_hz);
         ESP_LOGD(TAG, "Slider %s changed to %d, published to %s (retained=%d)", 
                  widget->m_id.c_str(), value, widget->m_mqtt_topic.c_str(), widget->m_retained);
     }
@@ -57,7 +57,7 @@ SpinnerWidget::SpinnerWidget(const std::string& id, int x, int y, int w, int h,
 }
 
 SpinnerWidget::~SpinnerWidget() {
-    cancelAsync(async_update_cb, this);
+    cancelUpdate();
     if (m_subscription_handle != 0) {
         MQTTManager::getInstance().unsubscribe(m_subscription_handle);
         m_subscription_handle = 0;
@@ -79,7 +79,7 @@ void SpinnerWidget::onMqttMessage(const std::string& topic, const std::string& p
     }
 
     m_pending_visible = visible;
-    scheduleAsync(async_update_cb, this);
+    scheduleUpdate(async_update_cb, this);
 }
 
 void SpinnerWidget::async_update_cb(void* user_data) {
@@ -87,7 +87,6 @@ void SpinnerWidget::async_update_cb(void* user_data) {
     if (!widget) {
         return;
     }
-    widget->markAsyncComplete();
     widget->updateVisibility(widget->m_pending_visible);
 }
 
@@ -77,7 +77,7 @@ SwitchWidget::SwitchWidget(const std::string& id, int x, int y, int w, int h, cJ
 }
 
 SwitchWidget::~SwitchWidget() {
-    cancelAsync(async_update_cb, this);
+    cancelUpdate();
     if (m_subscription_handle != 0) {
         MQTTManager::getInstance().unsubscribe(m_subscription_handle);
         m_subscription_handle = 0;
@@ -103,7 +103,7 @@ void SwitchWidget::onMqttMessage(const std::string& topic, const std::string& pa
     }
 
     m_pending_state = new_state;
-    scheduleAsync(async_update_cb, this);
+    scheduleUpdate(async_update_cb, this);
     
     ESP_LOGD(TAG, "Scheduled async update for switch %s: %s", m_id.c_str(), new_state ? "ON" : "OFF");
 }
@@ -113,7 +113,6 @@ void SwitchWidget::async_update_cb(void* user_data) {
     if (!widget) {
         return;
     }
-    widget->markAsyncComplete();
     widget->updateState(widget->m_pending_state);
 }
 
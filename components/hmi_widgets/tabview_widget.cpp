@@ -135,7 +135,7 @@ TabviewWidget::TabviewWidget(const std::string& id, int x, int y, int w, int h,
 }
 
 TabviewWidget::~TabviewWidget() {
-    cancelAsync(async_tab_update, this);
+    cancelUpdate();
     if (m_subscription_handle != 0) {
         MQTTManager::getInstance().unsubscribe(m_subscription_handle);
         m_subscription_handle = 0;
@@ -154,6 +154,9 @@ void TabviewWidget::tab_changed_event_cb(lv_event_t* e) {
     
     uint32_t tab_index = lv_tabview_get_tab_active(tabview);
     widget->onTabChanged(tab_index);
+    if (widget->m_tab_activated) {
+        widget->m_tab_activated(tab_index);
+    }
 }
 
 void TabviewWidget::onTabChanged(uint32_t tab_index) {
@@ -209,7 +212,7 @@ void TabviewWidget::onMqttMessage(const std::string& topic, const std::string& p
     }
     
     m_active_tab = new_tab_index;
-    scheduleAsync(async_tab_update, this);
+    scheduleUpdate(async_tab_update, this);
 }
 
 void TabviewWidget::async_tab_update(void * user_data) {
@@ -217,11 +220,13 @@ void TabviewWidget::async_tab_update(void * user_data) {
     if (!widget) {
         return;
     }
-    widget->markAsyncComplete();
     if (widget->m_lvgl_obj && lv_obj_is_valid(widget->m_lvgl_obj)) {
         widget->m_updating_from_mqtt = true;
         lv_tabview_set_active(widget->m_lvgl_obj, widget->m_active_tab, LV_ANIM_ON);
         widget->m_updating_from_mqtt = false;
+        if (widget->m_tab_activated) {
+            widget->m_tab_activated(widget->m_active_tab);
+        }
         ESP_LOGI(TAG, "Tabview '%s' changed to tab %d via MQTT", widget->m_id.c_str(), widget->m_active_tab);
     }
 }
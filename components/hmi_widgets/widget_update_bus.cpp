@@ -0,0 +1,157 @@
+#include "widget_update_bus.h"
+#include "hmi_widget.h"
+#include <esp_log.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "WidgetUpdateBus";
+
+static constexpr uint32_t STATS_LOG_PERIOD_MS = 30000;
+static constexpr uint32_t CANCEL_WARN_TICKS = 10;
+
+WidgetUpdateBus& WidgetUpdateBus::getInstance() {
+    static WidgetUpdateBus instance;
+    return instance;
+}
+
+void WidgetUpdateBus::init() {
+    if (m_timer) {
+        return;
+    }
+    m_timer = lv_timer_create(timer_cb, LV_DEF_REFR_PERIOD, this);
+    m_last_log_ms = lv_tick_get();
+    ESP_LOGI(TAG, "Widget updates drained every %d ms", LV_DEF_REFR_PERIOD);
+}
+
+bool WidgetUpdateBus::schedule(HMIWidget* widget) {
+    if (widget->m_update_pending.exchange(true, std::memory_order_acq_rel)) {
+        m_coalesced.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Treiber push; the pending flag guarantees a widget is linked at most once
+    HMIWidget* head = m_head.load(std::memory_order_relaxed);
+    do {
+        widget->m_next_dirty = head;
+    } while (!m_head.compare_exchange_weak(head, widget, std::memory_order_release, std::memory_order_relaxed));
+    return true;
+}
+
+void WidgetUpdateBus::collect() {
+    HMIWidget* list = m_head.exchange(nullptr, std::memory_order_acquire);
+    if (!list) {
+        return;
+    }
+
+    // The newest push is first; reverse so updates apply in arrival order
+    HMIWidget* tail = list;
+    HMIWidget* fifo = nullptr;
+    while (list) {
+        HMIWidget* next = list->m_next_dirty;
+        list->m_next_dirty = fifo;
+        fifo = list;
+        list = next;
+    }
+
+    if (m_ready_tail) {
+        m_ready_tail->m_next_dirty = fifo;
+    } else {
+        m_ready = fifo;
+    }
+    m_ready_tail = tail;
+}
+
+void WidgetUpdateBus::cancel(HMIWidget* widget) {
+    if (!widget->m_update_pending.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    // Flag set but not linked yet means a producer is still inside schedule(); it links the
+    // widget within a few instructions, but may run at a lower priority, so sleep rather than spin
+    for (uint32_t waited = 0;; waited++) {
+        collect();
+        if (unlink(widget)) {
+            widget->m_update_pending.store(false, std::memory_order_release);
+            return;
+        }
+        if (waited == CANCEL_WARN_TICKS) {
+            ESP_LOGW(TAG, "Widget %s destroyed while an update was being scheduled, waiting for it",
+                     widget->getId().c_str());
+        }
+        vTaskDelay(1);
+    }
+}
+
+bool WidgetUpdateBus::unlink(HMIWidget* widget) {
+    HMIWidget* prev = nullptr;
+    for (HMIWidget* node = m_ready; node; prev = node, node = node->m_next_dirty) {
+        if (node != widget) {
+            continue;
+        }
+        if (prev) {
+            prev->m_next_dirty = node->m_next_dirty;
+        } else {
+            m_ready = node->m_next_dirty;
+        }
+        if (m_ready_tail == node) {
+            m_ready_tail = prev;
+        }
+        node->m_next_dirty = nullptr;
+        return true;
+    }
+    return false;
+}
+
+void WidgetUpdateBus::drain() {
+    collect();
+
+    // Only what was pending at the start of the frame; later updates wait for the next one
+    uint32_t batch = 0;
+    for (HMIWidget* node = m_ready; node; node = node->m_next_dirty) {
+        batch++;
+    }
+
+    for (uint32_t i = 0; i < batch && m_ready; i++) {
+        HMIWidget* widget = m_ready;
+        m_ready = widget->m_next_dirty;
+        if (!m_ready) {
+            m_ready_tail = nullptr;
+        }
+        widget->m_next_dirty = nullptr;
+
+        // Clear before applying: a message arriving meanwhile schedules the next frame
+        lv_async_cb_t cb = widget->m_update_cb.load(std::memory_order_relaxed);
+        void* user_data = widget->m_update_data.load(std::memory_order_relaxed);
+        widget->m_update_pending.store(false, std::memory_order_release);
+        if (cb) {
+            cb(user_data);
+        }
+    }
+
+    if (batch > 0) {
+        m_applied.fetch_add(batch, std::memory_order_relaxed);
+        if (batch > m_max_batch.load(std::memory_order_relaxed)) {
+            m_max_batch.store(batch, std::memory_order_relaxed);
+        }
+    }
+}
+
+void WidgetUpdateBus::logStats() {
+    uint32_t applied = getAppliedUpdates();
+    if (applied == m_logged_applied) {
+        return;
+    }
+    ESP_LOGI(TAG, "Widget updates: applied=%lu coalesced=%lu max_batch=%lu",
+             (unsigned long)applied, (unsigned long)getCoalescedUpdates(), (unsigned long)getMaxBatch());
+    m_logged_applied = applied;
+}
+
+void WidgetUpdateBus::timer_cb(lv_timer_t* timer) {
+    WidgetUpdateBus* bus = static_cast<WidgetUpdateBus*>(lv_timer_get_user_data(timer));
+    bus->drain();
+
+    if (lv_tick_elaps(bus->m_last_log_ms) >= STATS_LOG_PERIOD_MS) {
+        bus->m_last_log_ms = lv_tick_get();
+        bus->logStats();
+    }
+}
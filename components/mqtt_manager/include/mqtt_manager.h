@@ -1,22 +1,97 @@
 #pragma once
 
 #include <string>
+#include <atomic>
+#include <deque>
+#include <list>
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include <functional>
 #include <memory>
 #include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 #include "freertos/semphr.h"
+#include "esp_timer.h"
 #include "mqtt_client.h"
+#include "mqtt_payload.h"
+#include "topic_trie.h"
 
 class MQTTManager {
 public:
     using MessageCallback = std::function<void(const std::string& topic, const std::string& payload)>;
+    using PayloadCallback = std::function<void(const std::string& topic, const MqttPayload& payload)>;
+    // Raw piece of a message as it arrives: offset of this piece and total message length.
+    // data == nullptr means the message was abandoned (timeout, gap or disconnect) before it completed.
+    using ChunkCallback = std::function<void(const std::string& topic, const char* data, size_t len,
+                                             size_t offset, size_t total)>;
     using StatusCallback = std::function<void(bool connected, uint32_t messages_received, uint32_t messages_sent)>;
     using SubscriptionHandle = uint32_t;  // Unique handle for each subscription
+
+    // Delivery class of a payload subscription. Each class has its own queue and task, by priority:
+    // Alarm above the MQTT task, then Config, Telemetry and Bulk (images, media) below it. The MQTT
+    // task only queues a completed message, so an alarm pre-empts telemetry and image handlers that
+    // are still busy with earlier messages. Within a class, messages are delivered in arrival order.
+    enum class DeliveryClass : uint8_t { Alarm, Config, Telemetry, Bulk };
+    static constexpr size_t DELIVERY_CLASSES = 4;
+
+    // Per delivery class; latency is from message completion until the callback returned
+    struct DispatchStats {
+        uint32_t delivered = 0;           // Callback invocations
+        uint32_t dropped = 0;             // Queue full
+        uint32_t depth = 0;               // Messages waiting now
+        uint32_t peak_depth = 0;
+        uint32_t max_latency_us = 0;
+        uint64_t total_latency_us = 0;    // Divide by delivered for the average
+    };
+
+    // Outcome of multi-chunk messages
+    struct ReassemblyStats {
+        uint32_t completed = 0;      // Received in full
+        uint32_t timeouts = 0;       // No chunk for the reassembly timeout
+        uint32_t gaps = 0;           // A chunk arrived at an unexpected offset
+        uint32_t orphan_chunks = 0;  // Continuation chunks whose message start was missed
+        uint32_t oversize = 0;       // Larger than the size limit for their topic
+        uint32_t evicted = 0;        // Dropped to make room for another message
+        uint32_t aborted = 0;        // In progress when the connection dropped
+        size_t peak_bytes = 0;       // Largest total of bytes being assembled at once
+    };
+
+    // Last value received per topic, replayed to new subscribers
+    struct LastValueStats {
+        size_t entries = 0;
+        size_t bytes = 0;
+        uint32_t replayed = 0;            // Cached values delivered on subscribe
+        uint32_t duplicates_skipped = 0;  // Deliveries skipped: retained copy of a value the subscriber had
+        uint32_t evicted = 0;             // Dropped to stay within the cache limits
+    };
+
+    // Outbound messages handed to the publisher task
+    struct PublishStats {
+        uint32_t queued = 0;
+        uint32_t sent = 0;
+        uint32_t failed = 0;              // Rejected by the MQTT client
+        uint32_t dropped = 0;             // Publish queue was full
+        uint32_t depth = 0;               // Messages waiting now
+        uint32_t peak_depth = 0;
+        uint32_t last_latency_us = 0;     // Enqueue until handed to the socket
+        uint32_t max_latency_us = 0;
+        uint64_t total_latency_us = 0;    // Divide by sent for the average
+        // Store-and-forward while disconnected
+        uint32_t offline_queued = 0;
+        uint32_t offline_dropped = 0;     // Offline queue full, or queueing disabled
+        uint32_t offline_coalesced = 0;   // Retained values replaced by a newer one on the same topic
+        uint32_t offline_replayed = 0;
+        uint32_t offline_depth = 0;
+    };
     
     static MQTTManager& getInstance();
     
+    // Use MQTT 5 with topic aliases (needs CONFIG_MQTT_PROTOCOL_5; call before init; off by default). Up to
+    // topic_alias_max topics per direction are replaced by a 2 byte alias after their first message.
+    void setMqtt5(bool enable, uint16_t topic_alias_max = 16);
+    bool isMqtt5() const { return m_mqtt5; }
+
     // Initialize and connect to MQTT broker
     bool init(const std::string& broker_uri, const std::string& client_id = "");
     
@@ -27,17 +102,46 @@ public:
     // Disconnect and cleanup
     void deinit();
     
-    // Subscribe to a topic with callback, returns handle for unsubscribing
-    SubscriptionHandle subscribe(const std::string& topic, int qos, MessageCallback callback);
+    // Subscribe to a topic or wildcard filter ('+', '#') with callback, returns handle for unsubscribing.
+    // The payload is a shared immutable buffer; keep a copy of the MqttPayload to use it later without copying bytes.
+    // The last cached value of every matching topic is delivered before this returns, on the caller's task.
+    SubscriptionHandle subscribe(const std::string& topic, int qos, PayloadCallback callback,
+                                 DeliveryClass delivery = DeliveryClass::Telemetry);
+
+    // Subscribe with a plain string callback (adapter over the payload variant, payload is passed by reference)
+    SubscriptionHandle subscribe(const std::string& topic, int qos, MessageCallback callback,
+                                 DeliveryClass delivery = DeliveryClass::Telemetry);
+
+    // Subscribe to the raw chunks of each message instead of the assembled payload.
+    // A message that only has chunk subscribers is never buffered in full.
+    SubscriptionHandle subscribeChunks(const std::string& topic, int qos, ChunkCallback callback);
     
-    // Unsubscribe using subscription handle
+    // Unsubscribe using subscription handle. If the handle's callback is running on its delivery
+    // task, this waits for it to return, so the callback's owner can be freed afterwards.
     bool unsubscribe(SubscriptionHandle handle);
+
+    // Group broker subscription changes: SUBSCRIBE/UNSUBSCRIBE requests made until the matching
+    // endBatch() are sent together, several topics per SUBSCRIBE packet. A topic subscribed and
+    // unsubscribed within the batch causes no broker traffic. Batches nest.
+    void beginBatch();
+    void endBatch();
     
     // Unsubscribe all callbacks from a topic (legacy)
     bool unsubscribeTopic(const std::string& topic);
     
-    // Publish a message
+    // Queue a message for the publisher task and return at once. While disconnected the message is
+    // kept in the offline queue and sent after reconnecting. Returns false if it was dropped.
     bool publish(const std::string& topic, const std::string& payload, int qos = 0, bool retain = false);
+
+    // Publish at most rate_hz times per second on a topic. Values published sooner are coalesced:
+    // only the latest one is sent when the interval ends. rate_hz <= 0 publishes immediately.
+    bool publishThrottled(const std::string& topic, const std::string& payload, int qos, bool retain, float rate_hz);
+
+    // Send the coalesced value of a topic now (e.g. when a slider is released), if one is waiting
+    void flushPublish(const std::string& topic);
+
+    // Throttled publishes replaced by a newer value before they were sent
+    uint32_t getCoalescedPublishes() const { return m_publishes_coalesced; }
     
     // Check connection status
     bool isConnected() const { return m_connected; }
@@ -47,12 +151,51 @@ public:
     uint32_t getMessagesSent() const { return m_messages_sent; }
     void resetStatistics() { m_messages_received = 0; m_messages_sent = 0; }
     
-    // Register status change callback
-    void setStatusCallback(StatusCallback callback) { m_status_callback = callback; }
+    // Register status callback: called at once on connect and disconnect, otherwise at most every
+    // interval_ms and only when the counters changed (from the esp_timer task, never per message)
+    void setStatusCallback(StatusCallback callback, uint32_t interval_ms = 1000);
+
+    PublishStats getPublishStats() const;
+
+    DispatchStats getDispatchStats(DeliveryClass delivery) const;
+
+    // Outbound bytes not sent because topics were replaced by MQTT 5 topic aliases
+    uint64_t getTopicAliasBytesSaved() const { return m_topic_alias_bytes_saved.load(std::memory_order_relaxed); }
+
+    // Bound the messages kept while disconnected; max_messages == 0 drops them instead
+    void setOfflineQueueLimits(size_t max_messages, size_t max_bytes);
+
+    // Time from (re)connect or batch flush until the broker acknowledged every SUBSCRIBE
+    uint32_t getLastSubscribeTimeMs() const { return m_last_subscribe_ms; }
 
     // Debug counters
     size_t getSubscriberCount() const { return m_handle_to_topic.size(); }
     size_t getTopicCount() const { return m_subscribers.size(); }
+    uint32_t getUnmatchedMessages() const { return m_messages_unmatched; }
+    ReassemblyStats getReassemblyStats() const { return m_reassembly_stats; }
+
+    // Limit the assembled size of messages on topics matching a filter (a topic class, e.g.
+    // "camera/+/image"); the smallest matching limit applies and may be above the default.
+    // Chunk subscribers still receive larger messages. Each call is a claim that lasts until
+    // clearMaxMessageSize() with the same arguments; a filter claimed more than once uses its
+    // largest claim, so widgets sharing a topic do not cut each other's messages short.
+    bool setMaxMessageSize(const std::string& filter, size_t max_bytes);
+    void clearMaxMessageSize(const std::string& filter, size_t max_bytes);
+
+    // Limit for topics that match no setMaxMessageSize() filter (default 1MB)
+    void setDefaultMaxMessageSize(size_t max_bytes);
+
+    // Size of the esp-mqtt receive buffer (default 16KB, call before init). Larger messages
+    // are received in chunks, so this bounds steady-state RAM, not the message size.
+    void setReceiveBufferSize(size_t bytes);
+
+    LastValueStats getLastValueStats() const;
+
+    // Bound the last-value cache: total bytes, and largest payload worth caching
+    void setLastValueCacheLimits(size_t max_bytes, size_t max_entry_bytes);
+
+    // Abandon a multi-chunk message when no chunk arrived for this long
+    void setReassemblyTimeout(uint32_t timeout_ms) { m_reassembly_timeout = pdMS_TO_TICKS(timeout_ms); }
     
 private:
     MQTTManager();
@@ -63,27 +206,229 @@ private:
     static void mqtt_event_handler(void* handler_args, esp_event_base_t base,
                                    int32_t event_id, void* event_data);
     
+    // Latest value waiting for the end of a topic's publish interval
+    struct ThrottledTopic {
+        int64_t last_sent_us = 0;
+        int64_t interval_us = 0;
+        std::string payload;
+        int qos = 0;
+        bool retain = false;
+        bool pending = false;
+    };
+
+    struct PublishRequest {
+        std::string topic;
+        std::string payload;
+        int qos;
+        bool retain;
+        int64_t enqueued_us;
+    };
+
+    void startPublisher();
+    void startDispatcher();
+    static void publisher_task(void* arg);
+    bool sendPublish(const PublishRequest& request);  // Publisher task only
+    int publishWithAlias(const PublishRequest& request);  // Publisher task only, holds m_client_mutex
+    void configureMqtt5();
+    void applyCommonConfig(esp_mqtt_client_config_t& mqtt_cfg) const;
+    bool storeOffline(PublishRequest request);        // Caller holds m_publish_mutex
+    void replayOffline();                             // Publisher task only
+    static void publish_timer_cb(void* arg);
+    static void status_timer_cb(void* arg);
+    void notifyStatus(bool force);
+    void publishDue();
+    void armPublishTimer(int64_t due_us);  // Caller holds m_publish_mutex
+
     void handleConnected();
     void handleDisconnected();
+    void handleSubscribed();
     void handleData(esp_mqtt_event_handle_t event);
     
     struct Subscription {
         SubscriptionHandle handle;
-        MessageCallback callback;
+        PayloadCallback callback;        // Assembled payload (null for chunk subscribers)
+        ChunkCallback chunk_callback;    // Raw chunks (null for payload subscribers)
+        DeliveryClass delivery = DeliveryClass::Telemetry;
+    };
+
+    // Subscriber lists are copy-on-write: dispatch takes a reference instead of copying the vector
+    using SubscriberList = std::vector<Subscription>;
+    using SubscriberListPtr = std::shared_ptr<const SubscriberList>;
+
+    struct TopicEntry {
+        SubscriberListPtr subscribers;
+        int qos = 0;
+    };
+
+    SubscriptionHandle addSubscription(const std::string& topic, int qos, Subscription subscription);
+
+    // Send SUBSCRIBE packets for (filter, qos) pairs, several filters per packet; returns packets sent
+    size_t sendSubscribe(const std::vector<std::pair<std::string, int>>& topics);
+    bool sendUnsubscribe(const std::string& topic);
+    // Record a broker subscription change while a batch is open (caller holds m_mutex)
+    void recordBatchChange(const std::string& topic, bool subscribe);
+
+    // One message being received; multi-chunk messages on different topics can interleave
+    struct ReassemblySlot {
+        bool active = false;
+        std::string topic;
+        int msg_id = 0;
+        size_t total = 0;
+        size_t received = 0;         // Offset of the next expected chunk
+        TickType_t last_chunk = 0;
+        size_t max_size = 0;         // Size limit for this topic
+        std::vector<SubscriberListPtr> dispatch_lists;  // Snapshot taken at the first chunk
+        bool has_payload_subscribers = false;
+        bool has_chunk_subscribers = false;
+        bool assemble = false;       // Buffering for payload subscribers (counted in m_buffered_bytes)
+        bool retain = false;
+        std::string buffer;
+    };
+
+    struct LastValue {
+        MqttPayload payload;
+        std::list<std::string>::iterator lru;
+        std::vector<SubscriptionHandle> seen;  // Subscribers that were given this value
+    };
+
+    static constexpr size_t REASSEMBLY_SLOTS = 4;
+
+    // Resolve subscribers and the size limit of the slot's topic once per message
+    void beginMessage(ReassemblySlot& slot);
+    void deliverChunk(const ReassemblySlot& slot, const char* data, size_t len, size_t offset, size_t total);
+    void deliverPayload(const ReassemblySlot& slot, const MqttPayload& payload,
+                        const std::vector<SubscriptionHandle>& skip);
+    void finishMessage(ReassemblySlot& slot, const MqttPayload* payload);  // nullptr: nothing to deliver
+
+    // A complete message waiting for the subscribers of one delivery class
+    struct DeliveryJob {
+        std::string topic;
+        MqttPayload payload;
+        std::vector<SubscriberListPtr> dispatch_lists;
+        int64_t complete_us;
+        std::vector<SubscriptionHandle> skip;  // Already have this (retained) value
     };
+
+    // Queue and task of one delivery class
+    struct DeliveryWorker {
+        MQTTManager* manager = nullptr;
+        DeliveryClass delivery = DeliveryClass::Telemetry;
+        QueueHandle_t queue = nullptr;           // nullptr: delivered on the MQTT task
+        SubscriptionHandle in_flight = 0;        // Callback running now (guarded by m_mutex)
+        TaskHandle_t in_flight_task = nullptr;   // Task running it
+    };
+
+    static void delivery_task(void* arg);
+    void queueDelivery(DeliveryClass delivery, const ReassemblySlot& slot, const MqttPayload& payload,
+                       int64_t complete_us, const std::vector<SubscriptionHandle>& skip);
+    void deliverJob(DeliveryWorker& worker, const DeliveryJob& job);
+    // A callback of handle is running on a task other than self (caller holds m_mutex)
+    bool isInFlight(SubscriptionHandle handle, TaskHandle_t self) const;
+    // Wait until the callbacks of handle have returned (caller does not hold m_mutex)
+    void waitForDelivery(SubscriptionHandle handle);
+    void recordDispatch(DeliveryClass delivery, uint32_t delivered, int64_t latency_us);
+    ReassemblySlot* startSlot(esp_mqtt_event_handle_t event, TickType_t now);
+    ReassemblySlot* findSlot(int msg_id, size_t offset);
+    bool reserveBuffer(ReassemblySlot& slot);
+    void releaseSlot(ReassemblySlot& slot);
+    void abortSlot(ReassemblySlot& slot, uint32_t& counter, const char* reason);
+    void expireSlots(TickType_t now);
+
+    // Remember a delivered payload. A retained copy of the cached value is only delivered to the
+    // subscribers that were not given it yet; skip receives the others. Returns false if none is left.
+    bool storeLastValue(const ReassemblySlot& slot, const MqttPayload& payload, std::vector<SubscriptionHandle>& skip);
+    void trimLastValues();  // Caller holds m_mutex
+    // Drop cached values of topics that no longer match any subscription once a filter is gone
+    void pruneLastValues(const std::string& filter);  // Caller holds m_mutex
+    std::unordered_map<std::string, LastValue>::iterator eraseLastValue(
+        std::unordered_map<std::string, LastValue>::iterator cached);
     
     esp_mqtt_client_handle_t m_client;
-    bool m_connected;
-    std::map<std::string, std::vector<Subscription>> m_subscribers;  // Multiple callbacks per topic
+    std::atomic<bool> m_connected;
+    TopicTrie<TopicEntry> m_subscribers;  // Filter -> callbacks, matched with MQTT wildcard semantics
     std::map<SubscriptionHandle, std::string> m_handle_to_topic;  // Reverse lookup
-    std::map<std::string, int> m_qos_map; // Store QoS for each topic
-    std::string m_chunk_buffer; // Buffer for accumulating chunked messages
-    std::string m_chunk_topic;  // Topic for the current chunked message
+
+    // Message reassembly (MQTT event task only)
+    ReassemblySlot m_slots[REASSEMBLY_SLOTS];
+    ReassemblySlot m_direct;  // Single-chunk messages, never buffered
+    // Claims of one filter: limit -> number of setMaxMessageSize() calls not cleared yet
+    struct SizeLimit {
+        std::map<size_t, uint32_t> claims;
+        size_t limit() const { return claims.empty() ? 0 : claims.rbegin()->first; }
+    };
+    TopicTrie<SizeLimit> m_size_limits;  // Filter -> max assembled size (guarded by m_mutex)
+    size_t m_receive_buffer_size = 16 * 1024;
+    size_t m_default_max_size = 1024 * 1024;
+    size_t m_reassembly_budget = 4 * 1024 * 1024;  // All slots together; large buffers land in PSRAM
+    size_t m_buffered_bytes = 0;
+    TickType_t m_reassembly_timeout = pdMS_TO_TICKS(10000);
+    ReassemblyStats m_reassembly_stats;
+
+    // Last-value cache (guarded by m_mutex); payloads are shared with subscribers, not copied
+    std::unordered_map<std::string, LastValue> m_last_values;
+    std::list<std::string> m_last_value_lru;  // Most recently updated first
+    size_t m_last_value_bytes = 0;
+    size_t m_last_value_budget = 1024 * 1024;
+    size_t m_last_value_max_entry = 64 * 1024;
+    size_t m_last_value_max_entries = 512;
+    LastValueStats m_last_value_stats;
     SubscriptionHandle m_next_handle = 1;  // Auto-increment handle
     SemaphoreHandle_t m_mutex = nullptr;
+
+    // Delivery tasks, one per class, and per-class metrics (guarded by m_dispatch_mutex)
+    DeliveryWorker m_workers[DELIVERY_CLASSES];
+    SemaphoreHandle_t m_dispatch_mutex = nullptr;
+    DispatchStats m_dispatch_stats[DELIVERY_CLASSES];
+
+    // Publisher task; m_client_mutex keeps deinit() from destroying the client mid-publish
+    QueueHandle_t m_publish_queue = nullptr;
+    SemaphoreHandle_t m_client_mutex = nullptr;
+    PublishStats m_publish_stats;  // Guarded by m_publish_mutex
+
+    // MQTT 5 outbound topic aliases (publisher task only)
+    struct OutboundAlias {
+        uint16_t alias;
+        bool established;  // The broker has seen topic and alias together on this connection
+    };
+    bool m_mqtt5 = false;  // Opt-in via setMqtt5()
+    uint16_t m_topic_alias_max = 16;
+    std::unordered_map<std::string, OutboundAlias> m_outbound_aliases;
+    bool m_outbound_aliases_enabled = true;
+    std::atomic<bool> m_aliases_reset{false};  // Set by the MQTT task on connect and disconnect
+    std::atomic<uint64_t> m_topic_alias_bytes_saved{0};
+
+    // Messages published while disconnected, oldest first (guarded by m_publish_mutex)
+    std::deque<PublishRequest> m_offline;
+    size_t m_offline_bytes = 0;
+    size_t m_offline_max_messages = 256;
+    size_t m_offline_max_bytes = 64 * 1024;
+    volatile bool m_replay_pending = false;
+
+    // Outbound coalescing (guarded by m_publish_mutex)
+    std::map<std::string, ThrottledTopic> m_throttled;
+    SemaphoreHandle_t m_publish_mutex = nullptr;
+    esp_timer_handle_t m_publish_timer = nullptr;
+    int64_t m_publish_timer_due_us = 0;  // 0 when the timer is not armed
+    uint32_t m_publishes_coalesced = 0;
+
+    // Subscription batching (guarded by m_mutex)
+    int m_batch_depth = 0;
+    std::map<std::string, bool> m_batch_changes;  // Filter -> subscribe (true) or unsubscribe (false)
+    std::vector<std::string> m_batch_released;    // Filters left without subscribers, cache pruned at the end
+
+    // SUBACK tracking for time-to-subscribed (guarded by m_mutex)
+    int m_suback_outstanding = 0;
+    int64_t m_subscribe_start_us = 0;  // 0 when no measurement is running
+    size_t m_subscribe_topics = 0;
+    size_t m_subscribe_packets = 0;
+    uint32_t m_last_subscribe_ms = 0;
     
-    // Statistics
-    uint32_t m_messages_received;
-    uint32_t m_messages_sent;
+    // Statistics; counters are atomics so the message path never locks or calls out for them
+    std::atomic<uint32_t> m_messages_received{0};
+    std::atomic<uint32_t> m_messages_sent{0};
+    uint32_t m_messages_unmatched = 0;
     StatusCallback m_status_callback;
+    esp_timer_handle_t m_status_timer = nullptr;
+    std::atomic<uint32_t> m_status_received{0};  // Counters in the last status snapshot
+    std::atomic<uint32_t> m_status_sent{0};
 };
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// Immutable, reference-counted MQTT message payload.
+// One buffer is shared by every subscriber and any deferred (LVGL thread) consumer,
+// so large messages such as base64 images or configs are never copied after receipt.
+class MqttPayload {
+public:
+    MqttPayload() = default;
+
+    // Copy raw bytes into a new shared buffer
+    MqttPayload(const char* data, size_t len)
+        : m_buffer(std::make_shared<const std::string>(data, len)) {}
+
+    // Take ownership of an already assembled buffer without copying
+    static MqttPayload adopt(std::string&& buffer) {
+        MqttPayload payload;
+        payload.m_buffer = std::make_shared<const std::string>(std::move(buffer));
+        return payload;
+    }
+
+    const char* data() const { return m_buffer ? m_buffer->data() : ""; }
+    size_t size() const { return m_buffer ? m_buffer->size() : 0; }
+    bool empty() const { return size() == 0; }
+    std::string_view view() const { return std::string_view(data(), size()); }
+
+    // Shared backing string (NUL-terminated); valid as long as any MqttPayload references it
+    const std::string& str() const { return m_buffer ? *m_buffer : emptyString(); }
+
+    // Drop this reference to the buffer
+    void reset() { m_buffer.reset(); }
+
+private:
+    static const std::string& emptyString() {
+        static const std::string empty;
+        return empty;
+    }
+
+    std::shared_ptr<const std::string> m_buffer;
+};
@@ -0,0 +1,446 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Topic-level trie implementing MQTT filter semantics ('+' single level, '#' multi level).
+// Each distinct level string is interned once, nodes reference children by segment id,
+// so matching a topic never compares full topic strings. Filters without wildcards are
+// also indexed by their full name: a topic is matched with one hash lookup, and the trie
+// is only walked where wildcard filters can still match. Header-only and free of
+// ESP-IDF dependencies so it can also be built on the host (see tools/).
+template <typename T>
+class TopicTrie {
+public:
+    TopicTrie() {
+        m_nodes.emplace_back();  // Root
+        m_plus_id = intern("+");
+        m_hash_id = intern("#");
+    }
+
+    // Return the value stored for an exact filter, or nullptr
+    T* find(std::string_view filter) {
+        uint32_t node = findNode(filter);
+        if (node == kInvalid || !m_nodes[node].has_value) {
+            return nullptr;
+        }
+        return &m_nodes[node].value;
+    }
+
+    // Return the value stored for an exact filter, creating an empty one if needed
+    T& at(std::string_view filter) {
+        uint32_t node = 0;
+        forEachLevel(filter, [&](std::string_view level) {
+            uint32_t segment = intern(level);
+            uint32_t child = findChild(node, segment);
+            if (child == kInvalid) {
+                child = allocNode();
+                m_nodes[child].parent = node;
+                m_nodes[child].segment = segment;
+                insertChild(node, segment, child);
+                if (segment == m_plus_id) {
+                    m_nodes[node].plus_child = child;
+                } else if (segment == m_hash_id) {
+                    m_nodes[node].hash_child = child;
+                }
+            }
+            node = child;
+            return true;
+        });
+        Node& n = m_nodes[node];
+        if (!n.has_value) {
+            n.has_value = true;
+            m_filter_count++;
+            if (hasWildcard(filter)) {
+                countWildcard(node, 1);
+            } else {
+                m_exact.emplace(std::string(filter), node);
+            }
+        }
+        return m_nodes[node].value;
+    }
+
+    // Remove the value stored for an exact filter. Returns false if absent.
+    bool erase(std::string_view filter) {
+        uint32_t node = findNode(filter);
+        if (node == kInvalid || !m_nodes[node].has_value) {
+            return false;
+        }
+        m_nodes[node].value = T();
+        m_nodes[node].has_value = false;
+        m_filter_count--;
+        if (hasWildcard(filter)) {
+            countWildcard(node, -1);
+        } else if (auto exact = m_exact.find(filter); exact != m_exact.end()) {
+            m_exact.erase(exact);
+        }
+        prune(node);
+        return true;
+    }
+
+    void clear() {
+        m_nodes.clear();
+        m_free_nodes.clear();
+        m_nodes.emplace_back();
+        m_exact.clear();
+        m_filter_count = 0;
+    }
+
+    // Number of filters currently holding a value
+    size_t size() const { return m_filter_count; }
+    bool empty() const { return m_filter_count == 0; }
+
+    // Visit the value of every filter matching a concrete topic name.
+    // visit(const T&) is called once per matching filter; nothing is copied.
+    template <typename Visitor>
+    void match(std::string_view topic, Visitor&& visit) const {
+        if (m_filter_count == 0) {
+            return;
+        }
+        auto exact = m_exact.find(topic);
+        if (exact != m_exact.end()) {
+            visit(m_nodes[exact->second].value);
+        }
+        if (m_nodes[0].wildcards == 0) {
+            return;
+        }
+
+        // Resolve topic levels to interned ids up front; unknown levels can only
+        // be matched by wildcards. Topics deeper than kMaxLevels resolve on the heap.
+        uint32_t levels[kMaxLevels];
+        size_t level_count = 0;
+        bool overflow = false;
+        forEachLevel(topic, [&](std::string_view level) {
+            if (level_count == kMaxLevels) {
+                overflow = true;
+                return false;
+            }
+            levels[level_count++] = lookup(level);
+            return true;
+        });
+        // Per MQTT spec, wildcards at the first level never match '$' topics
+        bool system_topic = !topic.empty() && topic[0] == '$';
+        if (overflow) {
+            std::vector<uint32_t> deep_levels;
+            forEachLevel(topic, [&](std::string_view level) {
+                deep_levels.push_back(lookup(level));
+                return true;
+            });
+            matchNode(0, deep_levels.data(), deep_levels.size(), 0, system_topic, false, visit);
+            return;
+        }
+        matchNode(0, levels, level_count, 0, system_topic, false, visit);
+    }
+
+    // Visit every stored filter with its value
+    template <typename Visitor>
+    void forEach(Visitor&& visit) const {
+        std::string path;
+        forEachNode(0, path, visit);
+    }
+
+    // Validate a subscription filter per MQTT 3.1.1 section 4.7
+    static bool isValidFilter(std::string_view filter) {
+        if (filter.empty()) {
+            return false;
+        }
+        size_t start = 0;
+        while (true) {
+            size_t end = filter.find('/', start);
+            std::string_view level = filter.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+            if (level.find_first_of("+#") != std::string_view::npos && level.size() != 1) {
+                return false;
+            }
+            if (level == "#" && end != std::string_view::npos) {
+                return false;
+            }
+            if (end == std::string_view::npos) {
+                return true;
+            }
+            start = end + 1;
+        }
+    }
+
+    static bool hasWildcard(std::string_view filter) {
+        return filter.find_first_of("+#") != std::string_view::npos;
+    }
+
+    // Match a single filter against a concrete topic without building a trie
+    static bool filterMatches(std::string_view filter, std::string_view topic) {
+        constexpr size_t npos = std::string_view::npos;
+        if (!topic.empty() && topic[0] == '$' && !filter.empty() && (filter[0] == '+' || filter[0] == '#')) {
+            return false;
+        }
+        size_t f = 0;
+        size_t t = 0;
+        while (true) {
+            size_t f_end = filter.find('/', f);
+            std::string_view level = filter.substr(f, f_end == npos ? npos : f_end - f);
+            if (level == "#") {
+                return true;  // Also matches the parent level ("a/#" matches "a")
+            }
+            if (t == npos) {
+                return false;
+            }
+            size_t t_end = topic.find('/', t);
+            if (level != "+" && level != topic.substr(t, t_end == npos ? npos : t_end - t)) {
+                return false;
+            }
+            if (f_end == npos) {
+                return t_end == npos;
+            }
+            f = f_end + 1;
+            t = t_end == npos ? npos : t_end + 1;
+        }
+    }
+
+private:
+    static constexpr uint32_t kInvalid = UINT32_MAX;
+    static constexpr size_t kMaxLevels = 32;
+
+    struct Node {
+        uint32_t parent = kInvalid;
+        uint32_t segment = kInvalid;
+        std::vector<std::pair<uint32_t, uint32_t>> children;  // (segment id, node index), sorted by segment id
+        uint32_t plus_child = kInvalid;  // Cached '+' and '#' children, checked at every level
+        uint32_t hash_child = kInvalid;
+        uint32_t wildcards = 0;          // Wildcard filters at or below this node
+        T value{};
+        bool has_value = false;
+    };
+
+    // Heterogeneous lookup, so matching a topic does not build a std::string
+    struct ViewHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view text) const { return std::hash<std::string_view>()(text); }
+    };
+
+    struct Segment {
+        std::string name;
+        uint32_t hash;
+    };
+
+    static uint32_t hashSegment(std::string_view segment) {
+        uint32_t h = 2166136261u;  // FNV-1a
+        for (char c : segment) {
+            h = (h ^ static_cast<uint8_t>(c)) * 16777619u;
+        }
+        return h;
+    }
+
+    template <typename Fn>
+    static void forEachLevel(std::string_view topic, Fn&& fn) {
+        size_t start = 0;
+        while (true) {
+            size_t end = topic.find('/', start);
+            if (end == std::string_view::npos) {
+                fn(topic.substr(start));
+                return;
+            }
+            if (!fn(topic.substr(start, end - start))) {
+                return;
+            }
+            start = end + 1;
+        }
+    }
+
+    // Interned segments live in an open-addressed table (power-of-two size, linear probing)
+    uint32_t intern(std::string_view segment) {
+        uint32_t id = lookup(segment);
+        if (id != kInvalid) {
+            return id;
+        }
+        if ((m_segments.size() + 1) * 2 > m_segment_slots.size()) {
+            rehash(m_segment_slots.empty() ? 64 : m_segment_slots.size() * 2);
+        }
+        id = static_cast<uint32_t>(m_segments.size());
+        m_segments.push_back(Segment{std::string(segment), hashSegment(segment)});
+        placeSlot(id);
+        return id;
+    }
+
+    uint32_t lookup(std::string_view segment) const {
+        if (m_segment_slots.empty()) {
+            return kInvalid;
+        }
+        uint32_t hash = hashSegment(segment);
+        size_t mask = m_segment_slots.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            uint32_t id = m_segment_slots[i];
+            if (id == kInvalid) {
+                return kInvalid;
+            }
+            const Segment& candidate = m_segments[id];
+            if (candidate.hash == hash && candidate.name == segment) {
+                return id;
+            }
+        }
+    }
+
+    void placeSlot(uint32_t id) {
+        size_t mask = m_segment_slots.size() - 1;
+        size_t i = m_segments[id].hash & mask;
+        while (m_segment_slots[i] != kInvalid) {
+            i = (i + 1) & mask;
+        }
+        m_segment_slots[i] = id;
+    }
+
+    void rehash(size_t slot_count) {
+        m_segment_slots.assign(slot_count, kInvalid);
+        for (uint32_t id = 0; id < m_segments.size(); id++) {
+            placeSlot(id);
+        }
+    }
+
+    uint32_t findChild(uint32_t node, uint32_t segment) const {
+        if (segment == kInvalid) {
+            return kInvalid;
+        }
+        const auto& children = m_nodes[node].children;
+        size_t lo = 0;
+        size_t hi = children.size();
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (children[mid].first < segment) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        if (lo < children.size() && children[lo].first == segment) {
+            return children[lo].second;
+        }
+        return kInvalid;
+    }
+
+    void insertChild(uint32_t node, uint32_t segment, uint32_t child) {
+        auto& children = m_nodes[node].children;
+        auto it = children.begin();
+        while (it != children.end() && it->first < segment) {
+            ++it;
+        }
+        children.insert(it, {segment, child});
+    }
+
+    uint32_t findNode(std::string_view filter) const {
+        uint32_t node = 0;
+        forEachLevel(filter, [&](std::string_view level) {
+            node = findChild(node, lookup(level));
+            return node != kInvalid;
+        });
+        return node;
+    }
+
+    uint32_t allocNode() {
+        if (!m_free_nodes.empty()) {
+            uint32_t index = m_free_nodes.back();
+            m_free_nodes.pop_back();
+            return index;
+        }
+        m_nodes.emplace_back();
+        return static_cast<uint32_t>(m_nodes.size() - 1);
+    }
+
+    void countWildcard(uint32_t node, int delta) {
+        while (true) {
+            m_nodes[node].wildcards += delta;
+            if (node == 0) {
+                return;
+            }
+            node = m_nodes[node].parent;
+        }
+    }
+
+    // Drop empty leaf nodes from the bottom up
+    void prune(uint32_t node) {
+        while (node != 0 && !m_nodes[node].has_value && m_nodes[node].children.empty()) {
+            uint32_t parent = m_nodes[node].parent;
+            auto& siblings = m_nodes[parent].children;
+            if (m_nodes[parent].plus_child == node) {
+                m_nodes[parent].plus_child = kInvalid;
+            } else if (m_nodes[parent].hash_child == node) {
+                m_nodes[parent].hash_child = kInvalid;
+            }
+            for (auto it = siblings.begin(); it != siblings.end(); ++it) {
+                if (it->second == node) {
+                    siblings.erase(it);
+                    break;
+                }
+            }
+            m_nodes[node] = Node();
+            m_free_nodes.push_back(node);
+            node = parent;
+        }
+    }
+
+    template <typename Visitor>
+    void matchNode(uint32_t node, const uint32_t* levels, size_t level_count, size_t depth,
+                   bool system_topic, bool via_plus, Visitor& visit) const {
+        // Exact filters were matched by the hash lookup; only wildcard filters are left
+        if (m_nodes[node].wildcards == 0) {
+            return;
+        }
+        bool wildcards_allowed = !(system_topic && depth == 0);
+
+        // '#' matches the parent level and everything below it
+        if (wildcards_allowed) {
+            uint32_t hash = m_nodes[node].hash_child;
+            if (hash != kInvalid && m_nodes[hash].has_value) {
+                visit(m_nodes[hash].value);
+            }
+        }
+
+        if (depth == level_count) {
+            if (via_plus && m_nodes[node].has_value) {
+                visit(m_nodes[node].value);
+            }
+            return;
+        }
+
+        uint32_t exact = findChild(node, levels[depth]);
+        if (exact != kInvalid) {
+            matchNode(exact, levels, level_count, depth + 1, system_topic, via_plus, visit);
+        }
+        if (wildcards_allowed) {
+            uint32_t plus = m_nodes[node].plus_child;
+            if (plus != kInvalid) {
+                matchNode(plus, levels, level_count, depth + 1, system_topic, true, visit);
+            }
+        }
+    }
+
+    template <typename Visitor>
+    void forEachNode(uint32_t node, std::string& path, Visitor& visit) const {
+        for (const auto& child : m_nodes[node].children) {
+            size_t saved = path.size();
+            if (node != 0) {
+                path.push_back('/');
+            }
+            path.append(segmentName(child.first));
+            if (m_nodes[child.second].has_value) {
+                visit(path, m_nodes[child.second].value);
+            }
+            forEachNode(child.second, path, visit);
+            path.resize(saved);
+        }
+    }
+
+    std::string_view segmentName(uint32_t segment) const {
+        return segment < m_segments.size() ? std::string_view(m_segments[segment].name) : std::string_view();
+    }
+
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_free_nodes;
+    std::vector<Segment> m_segments;         // Interned level strings indexed by segment id
+    std::vector<uint32_t> m_segment_slots;   // Hash slots holding segment ids
+    std::unordered_map<std::string, uint32_t, ViewHash, std::equal_to<>> m_exact;  // Filter without wildcards -> node
+    uint32_t m_plus_id = kInvalid;
+    uint32_t m_hash_id = kInvalid;
+    size_t m_filter_count = 0;
+};
@@ -1,9 +1,34 @@
 #include "mqtt_manager.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include <algorithm>
 #include <cstring>
 
 static const char* TAG = "MQTTManager";
 
+static constexpr UBaseType_t PUBLISH_QUEUE_DEPTH = 64;
+static constexpr uint32_t PUBLISH_STACK_SIZE = 4096;
+static constexpr UBaseType_t PUBLISH_TASK_PRIORITY = 4;
+static constexpr uint32_t PUBLISH_STATS_PERIOD_MS = 30000;
+
+// One delivery task per class, in DeliveryClass order. Alarm runs above the MQTT task (priority 5)
+// and pre-empts every other handler; Bulk runs lowest so large media never holds up small messages.
+struct DeliveryTaskConfig {
+    const char* name;
+    UBaseType_t depth;
+    uint32_t stack;
+    UBaseType_t priority;
+};
+static constexpr DeliveryTaskConfig DELIVERY_TASKS[] = {
+    {"mqtt_alarm", 16, 6144, 6},
+    {"mqtt_config", 16, 6144, 4},
+    {"mqtt_telemetry", 32, 6144, 3},
+    {"mqtt_bulk", 8, 6144, 2},
+};
+static_assert(sizeof(DELIVERY_TASKS) / sizeof(DELIVERY_TASKS[0]) == MQTTManager::DELIVERY_CLASSES,
+              "one delivery task per class");
+
 MQTTManager& MQTTManager::getInstance() {
     static MQTTManager instance;
     return instance;
@@ -11,10 +36,51 @@ MQTTManager& MQTTManager::getInstance() {
 
 MQTTManager::MQTTManager() : m_client(nullptr), m_connected(false) {
     m_mutex = xSemaphoreCreateMutex();
+    m_publish_mutex = xSemaphoreCreateMutex();
+    m_client_mutex = xSemaphoreCreateMutex();
+    m_dispatch_mutex = xSemaphoreCreateMutex();
+
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = publish_timer_cb;
+    timer_args.arg = this;
+    timer_args.name = "mqtt_publish";
+    if (esp_timer_create(&timer_args, &m_publish_timer) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create publish timer, throttled publishes are sent immediately");
+        m_publish_timer = nullptr;
+    }
+
+    timer_args.callback = status_timer_cb;
+    timer_args.name = "mqtt_status";
+    if (esp_timer_create(&timer_args, &m_status_timer) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create status timer, only connection changes are reported");
+        m_status_timer = nullptr;
+    }
 }
 
 MQTTManager::~MQTTManager() {
     deinit();
+    if (m_status_timer) {
+        esp_timer_stop(m_status_timer);
+        esp_timer_delete(m_status_timer);
+        m_status_timer = nullptr;
+    }
+    if (m_publish_timer) {
+        esp_timer_stop(m_publish_timer);
+        esp_timer_delete(m_publish_timer);
+        m_publish_timer = nullptr;
+    }
+    if (m_publish_mutex) {
+        vSemaphoreDelete(m_publish_mutex);
+        m_publish_mutex = nullptr;
+    }
+    if (m_client_mutex) {
+        vSemaphoreDelete(m_client_mutex);
+        m_client_mutex = nullptr;
+    }
+    if (m_dispatch_mutex) {
+        vSemaphoreDelete(m_dispatch_mutex);
+        m_dispatch_mutex = nullptr;
+    }
     if (m_mutex) {
         vSemaphoreDelete(m_mutex);
         m_mutex = nullptr;
@@ -29,8 +95,7 @@ bool MQTTManager::init(const std::string& broker_uri, const std::string& client_
     
     esp_mqtt_client_config_t mqtt_cfg = {};
     mqtt_cfg.broker.address.uri = broker_uri.c_str();
-    mqtt_cfg.buffer.size = 512*1024;  // 512KB buffer for large JSON configs with chunking support
-    mqtt_cfg.buffer.out_size = 8192;
+    applyCommonConfig(mqtt_cfg);
     
     if (!client_id.empty()) {
         mqtt_cfg.credentials.client_id = client_id.c_str();
@@ -43,6 +108,7 @@ bool MQTTManager::init(const std::string& broker_uri, const std::string& client_
     }
     
     esp_mqtt_client_register_event(m_client, MQTT_EVENT_ANY, mqtt_event_handler, this);
+    configureMqtt5();
     
     esp_err_t err = esp_mqtt_client_start(m_client);
     if (err != ESP_OK) {
@@ -52,6 +118,8 @@ bool MQTTManager::init(const std::string& broker_uri, const std::string& client_
         return false;
     }
     
+    startPublisher();
+    startDispatcher();
     ESP_LOGI(TAG, "MQTT client started, connecting to %s", broker_uri.c_str());
     return true;
 }
@@ -67,8 +135,7 @@ bool MQTTManager::init(const std::string& broker_uri, const std::string& usernam
     mqtt_cfg.broker.address.uri = broker_uri.c_str();
     mqtt_cfg.credentials.username = username.c_str();
     mqtt_cfg.credentials.authentication.password = password.c_str();
-    mqtt_cfg.buffer.size = 1024*1024;  // 1MB buffer for large JSON configs with chunking support
-    mqtt_cfg.buffer.out_size = 8192;
+    applyCommonConfig(mqtt_cfg);
     
     if (!client_id.empty()) {
         mqtt_cfg.credentials.client_id = client_id.c_str();
@@ -81,6 +148,7 @@ bool MQTTManager::init(const std::string& broker_uri, const std::string& usernam
     }
     
     esp_mqtt_client_register_event(m_client, MQTT_EVENT_ANY, mqtt_event_handler, this);
+    configureMqtt5();
     
     esp_err_t err = esp_mqtt_client_start(m_client);
     if (err != ESP_OK) {
@@ -90,35 +158,110 @@ bool MQTTManager::init(const std::string& broker_uri, const std::string& usernam
         return false;
     }
     
+    startPublisher();
+    startDispatcher();
     ESP_LOGI(TAG, "MQTT client started with auth, connecting to %s", broker_uri.c_str());
     return true;
 }
 
+void MQTTManager::applyCommonConfig(esp_mqtt_client_config_t& mqtt_cfg) const {
+    // Larger messages arrive in chunks and are assembled into their own buffer, sized from
+    // the total message length, or streamed to chunk subscribers by handleData
+    mqtt_cfg.buffer.size = m_receive_buffer_size;
+    mqtt_cfg.buffer.out_size = 8192;
+#if CONFIG_MQTT_PROTOCOL_5
+    if (m_mqtt5) {
+        mqtt_cfg.session.protocol_ver = MQTT_PROTOCOL_V_5;
+    }
+#endif
+}
+
+void MQTTManager::setReceiveBufferSize(size_t bytes) {
+    if (m_client) {
+        ESP_LOGW(TAG, "Receive buffer size applies from the next init()");
+    }
+    m_receive_buffer_size = std::max<size_t>(bytes, 1024);
+}
+
 void MQTTManager::deinit() {
     if (m_client) {
+        // Wait for a publish in progress; the publisher task checks m_client under this lock
+        xSemaphoreTake(m_client_mutex, portMAX_DELAY);
         esp_mqtt_client_stop(m_client);
         esp_mqtt_client_destroy(m_client);
         m_client = nullptr;
         m_connected = false;
+        xSemaphoreGive(m_client_mutex);
+
+        PublishRequest* request = nullptr;
+        while (m_publish_queue && xQueueReceive(m_publish_queue, &request, 0) == pdTRUE) {
+            delete request;
+        }
+        for (DeliveryWorker& worker : m_workers) {
+            DeliveryJob* job = nullptr;
+            while (worker.queue && xQueueReceive(worker.queue, &job, 0) == pdTRUE) {
+                delete job;
+            }
+        }
+        for (auto& slot : m_slots) {
+            releaseSlot(slot);
+        }
         if (m_mutex) {
             xSemaphoreTake(m_mutex, portMAX_DELAY);
         }
         m_subscribers.clear();
         m_handle_to_topic.clear();
-        m_qos_map.clear();
+        m_last_values.clear();
+        m_last_value_lru.clear();
+        m_last_value_bytes = 0;
         if (m_mutex) {
             xSemaphoreGive(m_mutex);
         }
+        if (m_publish_mutex) {
+            xSemaphoreTake(m_publish_mutex, portMAX_DELAY);
+            if (m_publish_timer) {
+                esp_timer_stop(m_publish_timer);
+            }
+            m_publish_timer_due_us = 0;
+            m_throttled.clear();
+            m_offline.clear();
+            m_offline_bytes = 0;
+            m_publish_stats.offline_depth = 0;
+            m_replay_pending = false;
+            xSemaphoreGive(m_publish_mutex);
+        }
         ESP_LOGI(TAG, "MQTT client deinitialized");
     }
 }
 
-MQTTManager::SubscriptionHandle MQTTManager::subscribe(const std::string& topic, int qos, MessageCallback callback) {
+MQTTManager::SubscriptionHandle MQTTManager::subscribe(const std::string& topic, int qos, MessageCallback callback,
+                                                       DeliveryClass delivery) {
+    return subscribe(topic, qos, PayloadCallback([callback = std::move(callback)](const std::string& t,
+                                                                                  const MqttPayload& payload) {
+        callback(t, payload.str());
+    }), delivery);
+}
+
+MQTTManager::SubscriptionHandle MQTTManager::subscribe(const std::string& topic, int qos, PayloadCallback callback,
+                                                       DeliveryClass delivery) {
+    return addSubscription(topic, qos, Subscription{0, std::move(callback), nullptr, delivery});
+}
+
+MQTTManager::SubscriptionHandle MQTTManager::subscribeChunks(const std::string& topic, int qos, ChunkCallback callback) {
+    return addSubscription(topic, qos, Subscription{0, nullptr, std::move(callback)});
+}
+
+MQTTManager::SubscriptionHandle MQTTManager::addSubscription(const std::string& topic, int qos, Subscription subscription) {
     if (!m_client) {
         ESP_LOGE(TAG, "MQTT client not initialized");
         return 0;  // Invalid handle
     }
 
+    if (!TopicTrie<TopicEntry>::isValidFilter(topic)) {
+        ESP_LOGE(TAG, "Invalid topic filter: %s", topic.c_str());
+        return 0;
+    }
+
     bool first_subscriber = false;
     SubscriptionHandle handle = 0;
     if (m_mutex) {
@@ -126,12 +269,48 @@ MQTTManager::SubscriptionHandle MQTTManager::subscribe(const std::string& topic,
     }
 
     handle = m_next_handle++;
-    Subscription sub{handle, callback};
-    m_subscribers[topic].push_back(sub);
+
+    // Snapshot cached values for the new subscriber (shared buffers, no payload copies)
+    std::vector<std::pair<std::string, MqttPayload>> replay;
+    PayloadCallback replay_callback;
+    if (subscription.callback && !m_last_values.empty()) {
+        bool wildcard = TopicTrie<TopicEntry>::hasWildcard(topic);
+        // Replayed values count as given, so the broker's retained copy is not delivered again
+        if (!wildcard) {
+            auto cached = m_last_values.find(topic);
+            if (cached != m_last_values.end()) {
+                replay.emplace_back(topic, cached->second.payload);
+                cached->second.seen.push_back(handle);
+            }
+        } else {
+            for (auto& cached : m_last_values) {
+                if (TopicTrie<TopicEntry>::filterMatches(topic, cached.first)) {
+                    replay.emplace_back(cached.first, cached.second.payload);
+                    cached.second.seen.push_back(handle);
+                }
+            }
+        }
+        if (!replay.empty()) {
+            replay_callback = subscription.callback;
+            m_last_value_stats.replayed += replay.size();
+        }
+    }
+
+    TopicEntry& entry = m_subscribers.at(topic);
+    first_subscriber = !entry.subscribers;
+    auto subs = entry.subscribers ? std::make_shared<SubscriberList>(*entry.subscribers)
+                                  : std::make_shared<SubscriberList>();
+    subscription.handle = handle;
+    subs->push_back(std::move(subscription));
+    entry.subscribers = std::move(subs);
     m_handle_to_topic[handle] = topic;
-    first_subscriber = (m_subscribers[topic].size() == 1);
+    bool deferred = false;
     if (first_subscriber) {
-        m_qos_map[topic] = qos;
+        entry.qos = qos;
+        deferred = m_batch_depth > 0;
+        if (deferred) {
+            recordBatchChange(topic, true);
+        }
     }
 
     size_t topic_count = m_subscribers.size();
@@ -140,13 +319,16 @@ MQTTManager::SubscriptionHandle MQTTManager::subscribe(const std::string& topic,
         xSemaphoreGive(m_mutex);
     }
 
-    if (first_subscriber && m_connected) {
-        int msg_id = esp_mqtt_client_subscribe(m_client, topic.c_str(), qos);
-        if (msg_id == -1) {
-            ESP_LOGE(TAG, "Failed to subscribe to %s", topic.c_str());
+    // Hydrate the subscriber now instead of waiting for the next publish or a retained resend
+    for (const auto& cached : replay) {
+        ESP_LOGD(TAG, "Replaying cached value of %s (%u bytes)", cached.first.c_str(), (unsigned)cached.second.size());
+        replay_callback(cached.first, cached.second);
+    }
+
+    if (first_subscriber && !deferred && m_connected) {
+        if (sendSubscribe({{topic, qos}}) == 0) {
             return 0;
         }
-        ESP_LOGD(TAG, "Subscribed to %s (QoS %d), msg_id=%d", topic.c_str(), qos, msg_id);
     } else if (!first_subscriber) {
         ESP_LOGD(TAG, "Added subscriber to existing topic %s", topic.c_str());
     }
@@ -181,20 +363,30 @@ bool MQTTManager::unsubscribe(SubscriptionHandle handle) {
     topic = topic_it->second;
     m_handle_to_topic.erase(topic_it);
 
-    auto sub_it = m_subscribers.find(topic);
-    if (sub_it != m_subscribers.end()) {
-        auto& subs = sub_it->second;
-        subs.erase(std::remove_if(subs.begin(), subs.end(),
-            [handle](const Subscription& s) { return s.handle == handle; }),
-            subs.end());
+    TopicEntry* entry = m_subscribers.find(topic);
+    if (entry && entry->subscribers) {
+        auto subs = std::make_shared<SubscriberList>();
+        subs->reserve(entry->subscribers->size());
+        for (const auto& s : *entry->subscribers) {
+            if (s.handle != handle) {
+                subs->push_back(s);
+            }
+        }
 
         ESP_LOGD(TAG, "Unsubscribed handle %u from %s (%d remaining)", 
-                 handle, topic.c_str(), subs.size());
+                 handle, topic.c_str(), subs->size());
 
-        if (subs.empty()) {
-            m_subscribers.erase(sub_it);
-            m_qos_map.erase(topic);
-            unsubscribe_broker = true;
+        if (subs->empty()) {
+            m_subscribers.erase(topic);
+            unsubscribe_broker = m_batch_depth == 0;
+            if (!unsubscribe_broker) {
+                recordBatchChange(topic, false);
+                m_batch_released.push_back(topic);
+            } else {
+                pruneLastValues(topic);
+            }
+        } else {
+            entry->subscribers = std::move(subs);
         }
     }
 
@@ -205,74 +397,528 @@ bool MQTTManager::unsubscribe(SubscriptionHandle handle) {
     }
 
     if (unsubscribe_broker && m_connected && m_client) {
-        int msg_id = esp_mqtt_client_unsubscribe(m_client, topic.c_str());
-        if (msg_id != -1) {
-            ESP_LOGD(TAG, "Unsubscribed from broker topic %s, msg_id=%d", topic.c_str(), msg_id);
-        }
+        sendUnsubscribe(topic);
     }
 
+    // No new delivery starts for the handle now; let one already running finish
+    waitForDelivery(handle);
+
     ESP_LOGD(TAG, "MQTT subs: topics=%u handles=%u", (unsigned)topic_count, (unsigned)handle_count);
     return true;
 }
 
 bool MQTTManager::unsubscribeTopic(const std::string& topic) {
-    auto sub_it = m_subscribers.find(topic);
-    if (sub_it == m_subscribers.end()) {
+    if (!m_client) {
+        ESP_LOGE(TAG, "MQTT client not initialized");
         return false;
     }
-    
-    // Remove all handle mappings for this topic
-    for (const auto& sub : sub_it->second) {
-        m_handle_to_topic.erase(sub.handle);
+
+    if (m_mutex) {
+        xSemaphoreTake(m_mutex, portMAX_DELAY);
     }
-    
-    m_subscribers.erase(sub_it);
-    m_qos_map.erase(topic);
-    if (!m_client) {
-        ESP_LOGE(TAG, "MQTT client not initialized");
+    TopicEntry* entry = m_subscribers.find(topic);
+    bool found = entry != nullptr;
+    bool deferred = m_batch_depth > 0;
+    std::vector<SubscriptionHandle> in_flight;
+    if (found) {
+        // Remove all handle mappings for this topic
+        if (entry->subscribers) {
+            for (const auto& sub : *entry->subscribers) {
+                m_handle_to_topic.erase(sub.handle);
+                if (isInFlight(sub.handle, nullptr)) {
+                    in_flight.push_back(sub.handle);
+                }
+            }
+        }
+        m_subscribers.erase(topic);
+        if (deferred) {
+            recordBatchChange(topic, false);
+            m_batch_released.push_back(topic);
+        } else {
+            pruneLastValues(topic);
+        }
+    }
+    if (m_mutex) {
+        xSemaphoreGive(m_mutex);
+    }
+
+    if (!found) {
         return false;
     }
     
-    m_subscribers.erase(topic);
-    m_qos_map.erase(topic);
+    bool sent = true;
+    if (m_connected && !deferred) {
+        sent = sendUnsubscribe(topic);
+    }
+    for (SubscriptionHandle handle : in_flight) {
+        waitForDelivery(handle);
+    }
     
-    if (m_connected) {
-        int msg_id = esp_mqtt_client_unsubscribe(m_client, topic.c_str());
+    return sent;
+}
+
+void MQTTManager::beginBatch() {
+    if (m_mutex) {
+        xSemaphoreTake(m_mutex, portMAX_DELAY);
+    }
+    m_batch_depth++;
+    if (m_mutex) {
+        xSemaphoreGive(m_mutex);
+    }
+}
+
+void MQTTManager::endBatch() {
+    std::map<std::string, bool> changes;
+    std::vector<std::pair<std::string, int>> subscribe;
+    if (m_mutex) {
+        xSemaphoreTake(m_mutex, portMAX_DELAY);
+    }
+    if (m_batch_depth > 0 && --m_batch_depth == 0) {
+        changes.swap(m_batch_changes);
+        // A widget that was rebuilt resubscribed its topic within the batch and keeps the cached value
+        for (const auto& filter : m_batch_released) {
+            if (!m_subscribers.find(filter)) {
+                pruneLastValues(filter);
+            }
+        }
+        m_batch_released.clear();
+        for (const auto& change : changes) {
+            const TopicEntry* entry = change.second ? m_subscribers.find(change.first) : nullptr;
+            if (entry) {
+                subscribe.emplace_back(change.first, entry->qos);
+            }
+        }
+    }
+    if (m_mutex) {
+        xSemaphoreGive(m_mutex);
+    }
+
+    // While disconnected the next connect subscribes everything anyway
+    if (changes.empty() || !m_connected || !m_client) {
+        return;
+    }
+
+    size_t packets = subscribe.empty() ? 0 : sendSubscribe(subscribe);
+    size_t unsubscribed = 0;
+    for (const auto& change : changes) {
+        if (!change.second) {
+            sendUnsubscribe(change.first);
+            unsubscribed++;
+        }
+    }
+    ESP_LOGI(TAG, "Subscription batch: +%u topics in %u packets, -%u topics",
+             (unsigned)subscribe.size(), (unsigned)packets, (unsigned)unsubscribed);
+}
+
+void MQTTManager::recordBatchChange(const std::string& topic, bool subscribe) {
+    auto it = m_batch_changes.find(topic);
+    if (it != m_batch_changes.end() && it->second != subscribe) {
+        // Added and removed (or removed and re-added) within the batch: the broker keeps its state
+        m_batch_changes.erase(it);
+    } else {
+        m_batch_changes[topic] = subscribe;
+    }
+}
+
+size_t MQTTManager::sendSubscribe(const std::vector<std::pair<std::string, int>>& topics) {
+    // Stay well below the 8 KB output buffer: each filter costs its length plus 3 bytes
+    static constexpr size_t MAX_TOPICS_PER_PACKET = 64;
+    static constexpr size_t MAX_PACKET_BYTES = 4096;
+
+    if (m_mutex) {
+        xSemaphoreTake(m_mutex, portMAX_DELAY);
+    }
+    if (m_subscribe_start_us == 0) {
+        m_subscribe_start_us = esp_timer_get_time();
+        m_subscribe_topics = 0;
+        m_subscribe_packets = 0;
+    }
+    if (m_mutex) {
+        xSemaphoreGive(m_mutex);
+    }
+
+    std::vector<esp_mqtt_topic_t> packet;
+    packet.reserve(std::min(topics.size(), MAX_TOPICS_PER_PACKET));
+    size_t packets = 0;
+    size_t i = 0;
+    while (i < topics.size()) {
+        packet.clear();
+        size_t bytes = 0;
+        while (i < topics.size() && packet.size() < MAX_TOPICS_PER_PACKET &&
+               (packet.empty() || bytes + topics[i].first.size() + 3 <= MAX_PACKET_BYTES)) {
+            packet.push_back(esp_mqtt_topic_t{topics[i].first.c_str(), topics[i].second});
+            bytes += topics[i].first.size() + 3;
+            i++;
+        }
+
+        // Count before sending: the SUBACK can arrive before the call returns
+        if (m_mutex) {
+            xSemaphoreTake(m_mutex, portMAX_DELAY);
+        }
+        m_suback_outstanding++;
+        m_subscribe_topics += packet.size();
+        m_subscribe_packets++;
+        if (m_mutex) {
+            xSemaphoreGive(m_mutex);
+        }
+
+        int msg_id = esp_mqtt_client_subscribe_multiple(m_client, packet.data(), (int)packet.size());
         if (msg_id == -1) {
-            ESP_LOGE(TAG, "Failed to unsubscribe from %s", topic.c_str());
-            return false;
+            ESP_LOGE(TAG, "Failed to subscribe to %u topics starting with %s", (unsigned)packet.size(), packet[0].filter);
+            handleSubscribed();  // Nothing will be acknowledged for this packet
+            continue;
         }
-        ESP_LOGD(TAG, "Unsubscribed from %s, msg_id=%d", topic.c_str(), msg_id);
+        packets++;
+        ESP_LOGD(TAG, "Subscribed to %u topics starting with %s, msg_id=%d", (unsigned)packet.size(), packet[0].filter, msg_id);
     }
-    
+    return packets;
+}
+
+bool MQTTManager::sendUnsubscribe(const std::string& topic) {
+    // esp-mqtt has no multi-topic UNSUBSCRIBE; these are sent back to back
+    int msg_id = esp_mqtt_client_unsubscribe(m_client, topic.c_str());
+    if (msg_id == -1) {
+        ESP_LOGE(TAG, "Failed to unsubscribe from %s", topic.c_str());
+        return false;
+    }
+    ESP_LOGD(TAG, "Unsubscribed from broker topic %s, msg_id=%d", topic.c_str(), msg_id);
     return true;
 }
 
+void MQTTManager::handleSubscribed() {
+    if (m_mutex) {
+        xSemaphoreTake(m_mutex, portMAX_DELAY);
+    }
+    bool done = m_suback_outstanding > 0 && --m_suback_outstanding == 0 && m_subscribe_start_us != 0;
+    size_t topics = m_subscribe_topics;
+    size_t packets = m_subscribe_packets;
+    if (done) {
+        m_last_subscribe_ms = (esp_timer_get_time() - m_subscribe_start_us) / 1000;
+        m_subscribe_start_us = 0;
+    }
+    if (m_mutex) {
+        xSemaphoreGive(m_mutex);
+    }
+
+    if (done && topics > 1) {
+        ESP_LOGI(TAG, "Fully subscribed: %u topics in %u packets, %lu ms",
+                 (unsigned)topics, (unsigned)packets, (unsigned long)m_last_subscribe_ms);
+    } else if (done) {
+        ESP_LOGD(TAG, "Subscription acknowledged in %lu ms", (unsigned long)m_last_subscribe_ms);
+    }
+}
+
 bool MQTTManager::publish(const std::string& topic, const std::string& payload, int qos, bool retain) {
-    if (!m_client) {
+    if (!m_client || !m_publish_queue) {
         ESP_LOGE(TAG, "MQTT client not initialized");
         return false;
     }
-    
-    if (!m_connected) {
-        ESP_LOGW(TAG, "MQTT client not connected, cannot publish");
+
+    // While disconnected (or until older offline messages are replayed) keep the message for later
+    xSemaphoreTake(m_publish_mutex, portMAX_DELAY);
+    if (!m_connected || !m_offline.empty()) {
+        bool stored = storeOffline(PublishRequest{topic, payload, qos, retain, esp_timer_get_time()});
+        xSemaphoreGive(m_publish_mutex);
+        return stored;
+    }
+    xSemaphoreGive(m_publish_mutex);
+
+    // Hand the message to the publisher task; the caller (often an LVGL event) never waits on the socket
+    PublishRequest* request = new PublishRequest{topic, payload, qos, retain, esp_timer_get_time()};
+    if (xQueueSend(m_publish_queue, &request, 0) != pdTRUE) {
+        delete request;
+        xSemaphoreTake(m_publish_mutex, portMAX_DELAY);
+        m_publish_stats.dropped++;
+        xSemaphoreGive(m_publish_mutex);
+        ESP_LOGW(TAG, "Publish queue full, dropped message to %s", topic.c_str());
         return false;
     }
-    
-    int msg_id = esp_mqtt_client_publish(m_client, topic.c_str(), payload.c_str(), 
-                                         payload.length(), qos, retain ? 1 : 0);
+
+    uint32_t depth = uxQueueMessagesWaiting(m_publish_queue);
+    xSemaphoreTake(m_publish_mutex, portMAX_DELAY);
+    m_publish_stats.queued++;
+    m_publish_stats.peak_depth = std::max(m_publish_stats.peak_depth, depth);
+    xSemaphoreGive(m_publish_mutex);
+    return true;
+}
+
+MQTTManager::PublishStats MQTTManager::getPublishStats() const {
+    xSemaphoreTake(m_publish_mutex, portMAX_DELAY);
+    PublishStats stats = m_publish_stats;
+    xSemaphoreGive(m_publish_mutex);
+    stats.depth = m_publish_queue ? uxQueueMessagesWaiting(m_publish_queue) : 0;
+    return stats;
+}
+
+void MQTTManager::setOfflineQueueLimits(size_t max_messages, size_t max_bytes) {
+    xSemaphoreTake(m_publish_mutex, portMAX_DELAY);
+    m_offline_max_messages = max_messages;
+    m_offline_max_bytes = max_bytes;
+    while (!m_offline.empty() &&
+           (m_offline.size() > m_offline_max_messages || m_offline_bytes > m_offline_max_bytes)) {
+        m_offline_bytes -= m_offline.front().topic.size() + m_offline.front().payload.size();
+        m_offline.pop_front();
+        m_publish_stats.offline_dropped++;
+    }
+    m_publish_stats.offline_depth = m_offline.size();
+    xSemaphoreGive(m_publish_mutex);
+}
+
+bool MQTTManager::storeOffline(PublishRequest request) {
+    size_t bytes = request.topic.size() + request.payload.size();
+    if (m_offline_max_messages == 0 || bytes > m_offline_max_bytes) {
+        m_publish_stats.offline_dropped++;
+        ESP_LOGW(TAG, "MQTT client not connected, dropped message to %s", request.topic.c_str());
+        return false;
+    }
+
+    // A retained topic holds state: only its latest value matters, sent after everything published before it
+    if (request.retain) {
+        for (auto it = m_offline.begin(); it != m_offline.end(); ++it) {
+            if (!it->retain || it->topic != request.topic) {
+                continue;
+            }
+            m_publish_stats.offline_coalesced++;
+            if (it->enqueued_us > request.enqueued_us) {
+                return true;  // A failed send of an older value; the newer one is already waiting
+            }
+            m_offline_bytes -= it->topic.size() + it->payload.size();
+            m_offline.erase(it);
+            break;
+        }
+    }
+
+    // Oldest messages go first when the queue is full
+    while (!m_offline.empty() &&
+           (m_offline.size() >= m_offline_max_messages || m_offline_bytes + bytes > m_offline_max_bytes)) {
+        ESP_LOGW(TAG, "Offline queue full, dropped message to %s", m_offline.front().topic.c_str());
+        m_offline_bytes -= m_offline.front().topic.size() + m_offline.front().payload.size();
+        m_offline.pop_front();
+        m_publish_stats.offline_dropped++;
+    }
+
+    // Kept in publish order: messages that failed in the publisher task when the connection
+    // dropped (or during replay) are older than the ones queued since
+    auto pos = m_offline.end();
+    while (pos != m_offline.begin() && std::prev(pos)->enqueued_us > request.enqueued_us) {
+        --pos;
+    }
+    ESP_LOGD(TAG, "Not connected, queued message to %s for replay (%u waiting)", request.topic.c_str(),
+             (unsigned)m_offline.size() + 1);
+    m_offline_bytes += bytes;
+    m_offline.insert(pos, std::move(request));
+    m_publish_stats.offline_queued++;
+    m_publish_stats.offline_depth = m_offline.size();
+    return true;
+}
+
+void MQTTManager::replayOffline() {
+    size_t replayed = 0;
+    while (true) {
+        xSemaphoreTake(m_publish_mutex, portMAX_DELAY);
+        if (!m_connected || m_offline.empty()) {
+            m_replay_pending = false;
+            m_publish_stats.offline_depth = m_offline.size();
+            xSemaphoreGive(m_publish_mutex);
+            break;
+        }
+        PublishRequest request = std::move(m_offline.front());
+        m_offline.pop_front();
+        m_offline_bytes -= request.topic.size() + request.payload.size();
+        xSemaphoreGive(m_publish_mutex);
+
+        // A failure while disconnected puts the message back into the offline queue
+        if (sendPublish(request)) {
+            replayed++;
+        }
+    }
+
+    if (replayed > 0) {
+        xSemaphoreTake(m_publish_mutex, portMAX_DELAY);
+        m_publish_stats.offline_replayed += replayed;
+        xSemaphoreGive(m_publish_mutex);
+        ESP_LOGI(TAG, "Replayed %u messages published while disconnected", (unsigned)replayed);
+    }
+}
+
+void MQTTManager::startPublisher() {
+    if (m_publish_queue) {
+        return;
+    }
+    m_publish_queue = xQueueCreate(PUBLISH_QUEUE_DEPTH, sizeof(PublishRequest*));
+    if (!m_publish_queue) {
+        ESP_LOGE(TAG, "Failed to create publish queue");
+        return;
+    }
+    if (xTaskCreate(publisher_task, "mqtt_publish", PUBLISH_STACK_SIZE, this, PUBLISH_TASK_PRIORITY, nullptr) !=
+        pdPASS) {
+        ESP_LOGE(TAG, "Failed to start publisher task");
+        vQueueDelete(m_publish_queue);
+        m_publish_queue = nullptr;
+    }
+}
+
+void MQTTManager::publisher_task(void* arg) {
+    MQTTManager* manager = static_cast<MQTTManager*>(arg);
+    uint32_t logged_sent = 0;
+    TickType_t last_log = xTaskGetTickCount();
+
+    while (true) {
+        PublishRequest* request = nullptr;
+        if (xQueueReceive(manager->m_publish_queue, &request, pdMS_TO_TICKS(PUBLISH_STATS_PERIOD_MS)) == pdTRUE &&
+            request) {
+            manager->sendPublish(*request);
+            delete request;
+        }
+        if (manager->m_replay_pending) {
+            manager->replayOffline();
+        }
+
+        if (xTaskGetTickCount() - last_log >= pdMS_TO_TICKS(PUBLISH_STATS_PERIOD_MS)) {
+            last_log = xTaskGetTickCount();
+            PublishStats stats = manager->getPublishStats();
+            if (stats.sent != logged_sent) {
+                logged_sent = stats.sent;
+                ESP_LOGI(TAG, "Publishes: sent=%lu failed=%lu dropped=%lu peak_depth=%lu latency avg=%lu max=%lu us",
+                         (unsigned long)stats.sent, (unsigned long)stats.failed, (unsigned long)stats.dropped,
+                         (unsigned long)stats.peak_depth,
+                         (unsigned long)(stats.sent ? stats.total_latency_us / stats.sent : 0),
+                         (unsigned long)stats.max_latency_us);
+            }
+        }
+    }
+}
+
+bool MQTTManager::sendPublish(const PublishRequest& request) {
+    xSemaphoreTake(m_client_mutex, portMAX_DELAY);
+    int msg_id = -1;
+    if (m_client) {
+        msg_id = publishWithAlias(request);
+    }
+    xSemaphoreGive(m_client_mutex);
+
+    int64_t latency_us = esp_timer_get_time() - request.enqueued_us;
+    xSemaphoreTake(m_publish_mutex, portMAX_DELAY);
+    if (msg_id == -1 && !m_connected) {
+        // Connection dropped after the message was queued
+        storeOffline(request);
+        xSemaphoreGive(m_publish_mutex);
+        return false;
+    }
+    if (msg_id == -1) {
+        m_publish_stats.failed++;
+    } else {
+        m_publish_stats.sent++;
+        m_publish_stats.last_latency_us = static_cast<uint32_t>(latency_us);
+        m_publish_stats.max_latency_us = std::max(m_publish_stats.max_latency_us, m_publish_stats.last_latency_us);
+        m_publish_stats.total_latency_us += static_cast<uint64_t>(latency_us);
+    }
+    xSemaphoreGive(m_publish_mutex);
+
     if (msg_id == -1) {
-        ESP_LOGE(TAG, "Failed to publish to %s", topic.c_str());
+        ESP_LOGE(TAG, "Failed to publish to %s", request.topic.c_str());
         return false;
     }
-        m_messages_sent++;
-    if (m_status_callback) {
-        m_status_callback(m_connected, m_messages_received, m_messages_sent);
+    m_messages_sent.fetch_add(1, std::memory_order_relaxed);
+    ESP_LOGD(TAG, "Published to %s: %s (msg_id=%d, %lld us after enqueue)", request.topic.c_str(),
+             request.payload.c_str(), msg_id, latency_us);
+    return true;
+}
+
+bool MQTTManager::publishThrottled(const std::string& topic, const std::string& payload, int qos, bool retain,
+                                   float rate_hz) {
+    if (rate_hz <= 0 || !m_publish_timer) {
+        return publish(topic, payload, qos, retain);
+    }
+
+    int64_t now = esp_timer_get_time();
+    xSemaphoreTake(m_publish_mutex, portMAX_DELAY);
+    ThrottledTopic& entry = m_throttled[topic];
+    entry.interval_us = static_cast<int64_t>(1000000.0f / rate_hz);
+    if (!entry.pending && now - entry.last_sent_us >= entry.interval_us) {
+        entry.last_sent_us = now;
+        xSemaphoreGive(m_publish_mutex);
+        return publish(topic, payload, qos, retain);
     }
-        ESP_LOGD(TAG, "Published to %s: %s (msg_id=%d)", topic.c_str(), payload.c_str(), msg_id);
+
+    // Too soon: keep only the latest value until the interval ends
+    if (entry.pending) {
+        m_publishes_coalesced++;
+    }
+    entry.payload = payload;
+    entry.qos = qos;
+    entry.retain = retain;
+    entry.pending = true;
+    armPublishTimer(entry.last_sent_us + entry.interval_us);
+    xSemaphoreGive(m_publish_mutex);
     return true;
 }
 
+void MQTTManager::flushPublish(const std::string& topic) {
+    ThrottledTopic due;
+    xSemaphoreTake(m_publish_mutex, portMAX_DELAY);
+    auto it = m_throttled.find(topic);
+    if (it != m_throttled.end() && it->second.pending) {
+        due = it->second;
+        it->second.pending = false;
+        it->second.last_sent_us = esp_timer_get_time();
+        std::string().swap(it->second.payload);
+    }
+    xSemaphoreGive(m_publish_mutex);
+
+    if (due.pending) {
+        publish(topic, due.payload, due.qos, due.retain);
+    }
+}
+
+void MQTTManager::armPublishTimer(int64_t due_us) {
+    if (m_publish_timer_due_us != 0 && m_publish_timer_due_us <= due_us) {
+        return;  // Already fires in time
+    }
+    if (m_publish_timer_due_us != 0) {
+        esp_timer_stop(m_publish_timer);
+    }
+    int64_t delay_us = std::max<int64_t>(due_us - esp_timer_get_time(), 1000);
+    m_publish_timer_due_us = due_us;
+    esp_timer_start_once(m_publish_timer, delay_us);
+}
+
+void MQTTManager::publish_timer_cb(void* arg) {
+    static_cast<MQTTManager*>(arg)->publishDue();
+}
+
+void MQTTManager::publishDue() {
+    std::vector<std::pair<std::string, ThrottledTopic>> due;
+    int64_t now = esp_timer_get_time();
+    int64_t next_due = 0;
+
+    xSemaphoreTake(m_publish_mutex, portMAX_DELAY);
+    m_publish_timer_due_us = 0;
+    for (auto& entry : m_throttled) {
+        ThrottledTopic& topic = entry.second;
+        if (!topic.pending) {
+            continue;
+        }
+        int64_t topic_due = topic.last_sent_us + topic.interval_us;
+        if (topic_due <= now) {
+            due.emplace_back(entry.first, topic);
+            topic.pending = false;
+            topic.last_sent_us = now;
+            std::string().swap(topic.payload);
+        } else if (next_due == 0 || topic_due < next_due) {
+            next_due = topic_due;
+        }
+    }
+    if (next_due != 0) {
+        armPublishTimer(next_due);
+    }
+    xSemaphoreGive(m_publish_mutex);
+
+    for (const auto& entry : due) {
+        publish(entry.first, entry.second.payload, entry.second.qos, entry.second.retain);
+    }
+}
+
 void MQTTManager::mqtt_event_handler(void* handler_args, esp_event_base_t base,
                                      int32_t event_id, void* event_data) {
     MQTTManager* manager = static_cast<MQTTManager*>(handler_args);
@@ -285,6 +931,9 @@ void MQTTManager::mqtt_event_handler(void* handler_args, esp_event_base_t base,
         case MQTT_EVENT_DISCONNECTED:
             manager->handleDisconnected();
             break;
+        case MQTT_EVENT_SUBSCRIBED:
+            manager->handleSubscribed();
+            break;
         case MQTT_EVENT_DATA:
             manager->handleData(event);
             break;
@@ -299,118 +948,746 @@ void MQTTManager::mqtt_event_handler(void* handler_args, esp_event_base_t base,
 void MQTTManager::handleConnected() {
     ESP_LOGI(TAG, "MQTT connected");
     m_connected = true;
+    m_aliases_reset = true;
+    notifyStatus(true);
     
-    // Notify status callback
-    if (m_status_callback) {
-        m_status_callback(m_connected, m_messages_received, m_messages_sent);
+    // Send what was published while disconnected
+    xSemaphoreTake(m_publish_mutex, portMAX_DELAY);
+    bool replay = !m_offline.empty();
+    m_replay_pending = replay;
+    xSemaphoreGive(m_publish_mutex);
+    if (replay && m_publish_queue) {
+        PublishRequest* wakeup = nullptr;
+        xQueueSend(m_publish_queue, &wakeup, 0);  // Never block the MQTT task; a busy publisher sees the flag anyway
     }
-    
-    // Resubscribe to all topics
-    for (const auto& sub : m_subscribers) {
-        const std::string& topic = sub.first;
-        int qos = m_qos_map[topic];
-        int msg_id = esp_mqtt_client_subscribe(m_client, topic.c_str(), qos);
-        ESP_LOGD(TAG, "Resubscribed to %s (QoS %d), msg_id=%d", topic.c_str(), qos, msg_id);
+
+    // Resubscribe to all topics, many per packet; pending batch changes are covered by this
+    std::vector<std::pair<std::string, int>> topics;
+    if (m_mutex) {
+        xSemaphoreTake(m_mutex, portMAX_DELAY);
+    }
+    topics.reserve(m_subscribers.size());
+    m_subscribers.forEach([&topics](const std::string& topic, const TopicEntry& entry) {
+        topics.emplace_back(topic, entry.qos);
+    });
+    m_batch_changes.clear();
+    m_subscribe_start_us = 0;
+    if (m_mutex) {
+        xSemaphoreGive(m_mutex);
+    }
+
+    if (!topics.empty()) {
+        size_t packets = sendSubscribe(topics);
+        ESP_LOGI(TAG, "Resubscribing %u topics in %u packets", (unsigned)topics.size(), (unsigned)packets);
     }
 }
 
 void MQTTManager::handleDisconnected() {
     ESP_LOGW(TAG, "MQTT disconnected");
     m_connected = false;
-    
-    // Notify status callback
+    m_aliases_reset = true;
+
+    // Unacknowledged SUBSCRIBEs are resent on reconnect
+    if (m_mutex) {
+        xSemaphoreTake(m_mutex, portMAX_DELAY);
+    }
+    m_suback_outstanding = 0;
+    m_subscribe_start_us = 0;
+    if (m_mutex) {
+        xSemaphoreGive(m_mutex);
+    }
+
+    // The rest of any partially received message is gone with the connection
+    for (auto& slot : m_slots) {
+        if (slot.active) {
+            abortSlot(slot, m_reassembly_stats.aborted, "disconnected");
+        }
+    }
+
+    notifyStatus(true);
+}
+
+void MQTTManager::setStatusCallback(StatusCallback callback, uint32_t interval_ms) {
+    if (m_status_timer) {
+        esp_timer_stop(m_status_timer);
+    }
+    m_status_callback = std::move(callback);
+    if (m_status_callback && m_status_timer && interval_ms > 0) {
+        esp_timer_start_periodic(m_status_timer, static_cast<uint64_t>(interval_ms) * 1000);
+    }
+}
+
+void MQTTManager::status_timer_cb(void* arg) {
+    static_cast<MQTTManager*>(arg)->notifyStatus(false);
+}
+
+void MQTTManager::notifyStatus(bool force) {
+    bool connected = m_connected;
+    uint32_t received = m_messages_received.load(std::memory_order_relaxed);
+    uint32_t sent = m_messages_sent.load(std::memory_order_relaxed);
+
+    // Periodic snapshots only when a counter moved; connection changes always go out
+    if (!force && received == m_status_received && sent == m_status_sent) {
+        return;
+    }
+    m_status_received = received;
+    m_status_sent = sent;
     if (m_status_callback) {
-        m_status_callback(m_connected, m_messages_received, m_messages_sent);
+        m_status_callback(connected, received, sent);
     }
 }
 
-void MQTTManager::handleData(esp_mqtt_event_handle_t event) {
-    std::string topic(event->topic, event->topic_len);
-    
-    // Handle chunked messages
-    if (event->total_data_len > event->data_len) {
-        // Multi-chunk message
-        ESP_LOGI(TAG, "Chunked message on %s: offset=%d, chunk_len=%d, total=%d",
-                 topic.c_str(), event->current_data_offset, event->data_len, event->total_data_len);
-        
-        // Initialize buffer on first chunk
-        if (event->current_data_offset == 0) {
-            m_chunk_buffer.clear();
-            m_chunk_buffer.reserve(event->total_data_len);
-            m_chunk_topic = topic;
-        }
-
-        if (!topic.empty()) {
-            m_chunk_topic = topic;
-        }
-        
-        std::string payload;
-        std::vector<Subscription> subs_copy;
+void MQTTManager::setMqtt5(bool enable, uint16_t topic_alias_max) {
+#if CONFIG_MQTT_PROTOCOL_5
+    m_mqtt5 = enable;
+    m_topic_alias_max = topic_alias_max;
+#else
+    if (enable) {
+        ESP_LOGW(TAG, "MQTT 5 requested but CONFIG_MQTT_PROTOCOL_5 is disabled, using MQTT 3.1.1");
+    }
+#endif
+}
 
-        if (m_mutex) {
-            xSemaphoreTake(m_mutex, portMAX_DELAY);
-        }
+void MQTTManager::configureMqtt5() {
+#if CONFIG_MQTT_PROTOCOL_5
+    if (!m_mqtt5) {
+        return;
+    }
+    // Let the broker replace topics of messages sent to us with aliases; esp-mqtt maps them
+    // back, so handleData and the subscriber trie always see the full topic
+    esp_mqtt5_connection_property_config_t connect_property = {};
+    connect_property.topic_alias_maximum = m_topic_alias_max;
+    if (esp_mqtt5_client_set_connect_property(m_client, &connect_property) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to set MQTT 5 connect properties, inbound topic aliases disabled");
+    }
+    ESP_LOGI(TAG, "MQTT 5 with up to %u topic aliases per direction", (unsigned)m_topic_alias_max);
+#endif
+}
+
+int MQTTManager::publishWithAlias(const PublishRequest& request) {
+#if CONFIG_MQTT_PROTOCOL_5
+    // Aliases belong to a connection; forget them after every connect or disconnect
+    if (m_aliases_reset.exchange(false)) {
+        m_outbound_aliases.clear();
+        m_outbound_aliases_enabled = true;
+    }
 
-        // Accumulate chunk
-        m_chunk_buffer.append(event->data, event->data_len);
+    auto it = m_outbound_aliases.find(request.topic);
+    if (m_mqtt5 && m_outbound_aliases_enabled && it == m_outbound_aliases.end() &&
+        m_outbound_aliases.size() < m_topic_alias_max) {
+        // First come, first served: the topics published first (usually the busy ones) get aliases
+        it = m_outbound_aliases.emplace(request.topic, OutboundAlias{
+                                            static_cast<uint16_t>(m_outbound_aliases.size() + 1), false}).first;
+    }
 
-        std::string full_topic;
-        if (m_chunk_buffer.size() >= static_cast<size_t>(event->total_data_len)) {
-            full_topic = m_chunk_topic.empty() ? topic : m_chunk_topic;
-            ESP_LOGI(TAG, "Complete message received on %s: %d bytes", full_topic.c_str(), m_chunk_buffer.size());
-            payload = m_chunk_buffer;
-            m_chunk_buffer.clear();
-            m_chunk_topic.clear();
+    if (m_mqtt5 && m_outbound_aliases_enabled && it != m_outbound_aliases.end()) {
+        OutboundAlias& alias = it->second;
+        esp_mqtt5_publish_property_config_t property = {};
+        property.topic_alias = alias.alias;
+        esp_mqtt5_client_set_publish_property(m_client, &property);
 
-            auto it = m_subscribers.find(full_topic);
-            if (it != m_subscribers.end()) {
-                subs_copy = it->second;
+        // The first message carries topic and alias; later ones only the alias
+        const char* topic = alias.established ? "" : request.topic.c_str();
+        int msg_id = esp_mqtt_client_publish(m_client, topic, request.payload.c_str(), request.payload.length(),
+                                             request.qos, request.retain ? 1 : 0);
+        if (msg_id != -1) {
+            if (alias.established) {
+                // Topic string replaced by a 3 byte Topic Alias property
+                m_topic_alias_bytes_saved.fetch_add(request.topic.size() > 3 ? request.topic.size() - 3 : 0,
+                                                    std::memory_order_relaxed);
             }
+            alias.established = true;
+            return msg_id;
+        }
+        if (!m_connected) {
+            return msg_id;
         }
+        // The broker allows fewer aliases than we asked for (or none): publish plainly for this connection
+        ESP_LOGW(TAG, "Topic alias %u rejected, outbound aliases disabled until reconnect", (unsigned)alias.alias);
+        m_outbound_aliases_enabled = false;
+        esp_mqtt5_publish_property_config_t no_alias = {};
+        esp_mqtt5_client_set_publish_property(m_client, &no_alias);
+    }
+#endif
+    return esp_mqtt_client_publish(m_client, request.topic.c_str(), request.payload.c_str(),
+                                   request.payload.length(), request.qos, request.retain ? 1 : 0);
+}
 
-        if (m_mutex) {
-            xSemaphoreGive(m_mutex);
+bool MQTTManager::setMaxMessageSize(const std::string& filter, size_t max_bytes) {
+    if (!TopicTrie<size_t>::isValidFilter(filter)) {
+        ESP_LOGE(TAG, "Invalid topic filter: %s", filter.c_str());
+        return false;
+    }
+    if (m_mutex) {
+        xSemaphoreTake(m_mutex, portMAX_DELAY);
+    }
+    SizeLimit& limit = m_size_limits.at(filter);
+    limit.claims[max_bytes]++;
+    size_t effective = limit.limit();
+    if (m_mutex) {
+        xSemaphoreGive(m_mutex);
+    }
+    ESP_LOGI(TAG, "Max message size for %s: %u bytes", filter.c_str(), (unsigned)effective);
+    return true;
+}
+
+void MQTTManager::clearMaxMessageSize(const std::string& filter, size_t max_bytes) {
+    if (m_mutex) {
+        xSemaphoreTake(m_mutex, portMAX_DELAY);
+    }
+    SizeLimit* limit = m_size_limits.find(filter);
+    auto claim = limit ? limit->claims.find(max_bytes) : std::map<size_t, uint32_t>::iterator();
+    if (limit && claim != limit->claims.end()) {
+        if (--claim->second == 0) {
+            limit->claims.erase(claim);
+        }
+        if (limit->claims.empty()) {
+            m_size_limits.erase(filter);  // Back to the default limit
         }
+    } else {
+        ESP_LOGW(TAG, "No max message size of %u bytes set for %s", (unsigned)max_bytes, filter.c_str());
+    }
+    if (m_mutex) {
+        xSemaphoreGive(m_mutex);
+    }
+}
+
+void MQTTManager::setDefaultMaxMessageSize(size_t max_bytes) {
+    if (m_mutex) {
+        xSemaphoreTake(m_mutex, portMAX_DELAY);
+    }
+    m_default_max_size = max_bytes;
+    if (m_mutex) {
+        xSemaphoreGive(m_mutex);
+    }
+}
 
-        if (!payload.empty()) {
-            m_messages_received++;
-            if (m_status_callback) {
-                m_status_callback(m_connected, m_messages_received, m_messages_sent);
+MQTTManager::LastValueStats MQTTManager::getLastValueStats() const {
+    if (m_mutex) {
+        xSemaphoreTake(m_mutex, portMAX_DELAY);
+    }
+    LastValueStats stats = m_last_value_stats;
+    stats.entries = m_last_values.size();
+    stats.bytes = m_last_value_bytes;
+    if (m_mutex) {
+        xSemaphoreGive(m_mutex);
+    }
+    return stats;
+}
+
+void MQTTManager::setLastValueCacheLimits(size_t max_bytes, size_t max_entry_bytes) {
+    if (m_mutex) {
+        xSemaphoreTake(m_mutex, portMAX_DELAY);
+    }
+    m_last_value_budget = max_bytes;
+    m_last_value_max_entry = max_entry_bytes;
+    trimLastValues();
+    if (m_mutex) {
+        xSemaphoreGive(m_mutex);
+    }
+}
+
+bool MQTTManager::storeLastValue(const ReassemblySlot& slot, const MqttPayload& payload,
+                                 std::vector<SubscriptionHandle>& skip) {
+    // Payload subscribers this message goes to
+    std::vector<SubscriptionHandle> receivers;
+    for (const auto& list : slot.dispatch_lists) {
+        for (const auto& sub : *list) {
+            if (sub.callback) {
+                receivers.push_back(sub.handle);
             }
+        }
+    }
+
+    size_t receiver_count = receivers.size();
 
-            for (auto& sub : subs_copy) {
-                sub.callback(full_topic, payload);
+    if (m_mutex) {
+        xSemaphoreTake(m_mutex, portMAX_DELAY);
+    }
+    auto cached = m_last_values.find(slot.topic);
+    if (cached != m_last_values.end()) {
+        LastValue& value = cached->second;
+        if (slot.retain && value.payload.view() == payload.view()) {
+            // Broker resending a retained value after (re)subscribe; only new subscribers need it
+            for (SubscriptionHandle handle : receivers) {
+                if (std::find(value.seen.begin(), value.seen.end(), handle) != value.seen.end()) {
+                    skip.push_back(handle);
+                } else {
+                    value.seen.push_back(handle);
+                }
             }
+            m_last_value_stats.duplicates_skipped += skip.size();
+            m_last_value_lru.splice(m_last_value_lru.begin(), m_last_value_lru, value.lru);
+        } else if (payload.size() > m_last_value_max_entry) {
+            eraseLastValue(cached);
+        } else {
+            m_last_value_bytes -= value.payload.size();
+            m_last_value_bytes += payload.size();
+            value.payload = payload;
+            value.seen = std::move(receivers);
+            m_last_value_lru.splice(m_last_value_lru.begin(), m_last_value_lru, value.lru);
+        }
+    } else if (payload.size() <= m_last_value_max_entry) {
+        m_last_value_lru.push_front(slot.topic);
+        m_last_values.emplace(slot.topic, LastValue{payload, m_last_value_lru.begin(), std::move(receivers)});
+        m_last_value_bytes += payload.size();
+    }
+    trimLastValues();
+
+    if (m_mutex) {
+        xSemaphoreGive(m_mutex);
+    }
+    return skip.size() < receiver_count;
+}
+
+std::unordered_map<std::string, MQTTManager::LastValue>::iterator MQTTManager::eraseLastValue(
+    std::unordered_map<std::string, LastValue>::iterator cached) {
+    m_last_value_bytes -= cached->second.payload.size();
+    m_last_value_lru.erase(cached->second.lru);
+    return m_last_values.erase(cached);
+}
+
+void MQTTManager::pruneLastValues(const std::string& filter) {
+    auto unused = [this](const std::string& topic) {
+        bool used = false;
+        m_subscribers.match(topic, [&used](const TopicEntry& entry) { used = used || entry.subscribers; });
+        return !used;
+    };
+    size_t pruned = 0;
+    if (!TopicTrie<TopicEntry>::hasWildcard(filter)) {
+        auto cached = m_last_values.find(filter);
+        if (cached != m_last_values.end() && unused(filter)) {
+            eraseLastValue(cached);
+            pruned++;
         }
     } else {
-        // Single chunk message
-        std::string payload(event->data, event->data_len);
-        ESP_LOGD(TAG, "Received on %s: %d bytes", topic.c_str(), payload.size());
-        
-        m_messages_received++;
-        if (m_status_callback) {
-            m_status_callback(m_connected, m_messages_received, m_messages_sent);
-        }
-        
-        std::vector<Subscription> subs_copy;
-        if (m_mutex) {
-            xSemaphoreTake(m_mutex, portMAX_DELAY);
+        for (auto cached = m_last_values.begin(); cached != m_last_values.end();) {
+            if (TopicTrie<TopicEntry>::filterMatches(filter, cached->first) && unused(cached->first)) {
+                cached = eraseLastValue(cached);
+                pruned++;
+            } else {
+                ++cached;
+            }
         }
-        auto it = m_subscribers.find(topic);
-        if (it != m_subscribers.end()) {
-            subs_copy = it->second;
+    }
+    if (pruned > 0) {
+        ESP_LOGD(TAG, "Dropped %u cached values with no subscriber left (%s)", (unsigned)pruned, filter.c_str());
+    }
+}
+
+void MQTTManager::trimLastValues() {
+    while (!m_last_value_lru.empty() &&
+           (m_last_value_bytes > m_last_value_budget || m_last_values.size() > m_last_value_max_entries)) {
+        eraseLastValue(m_last_values.find(m_last_value_lru.back()));
+        m_last_value_stats.evicted++;
+    }
+}
+
+void MQTTManager::beginMessage(ReassemblySlot& slot) {
+    slot.dispatch_lists.clear();
+    slot.max_size = 0;
+    if (m_mutex) {
+        xSemaphoreTake(m_mutex, portMAX_DELAY);
+    }
+    m_subscribers.match(slot.topic, [&slot](const TopicEntry& entry) {
+        if (entry.subscribers) {
+            slot.dispatch_lists.push_back(entry.subscribers);
         }
-        if (m_mutex) {
-            xSemaphoreGive(m_mutex);
+    });
+    m_size_limits.match(slot.topic, [&slot](const SizeLimit& claims) {
+        size_t limit = claims.limit();
+        slot.max_size = slot.max_size ? std::min(slot.max_size, limit) : limit;
+    });
+    if (m_mutex) {
+        xSemaphoreGive(m_mutex);
+    }
+    if (slot.max_size == 0) {
+        slot.max_size = m_default_max_size;
+    }
+
+    // Lists are immutable snapshots, so they stay valid for every chunk of this message
+    // even if callbacks (un)subscribe meanwhile
+    slot.has_payload_subscribers = false;
+    slot.has_chunk_subscribers = false;
+    for (const auto& list : slot.dispatch_lists) {
+        for (const auto& sub : *list) {
+            if (sub.callback) {
+                slot.has_payload_subscribers = true;
+            }
+            if (sub.chunk_callback) {
+                slot.has_chunk_subscribers = true;
+            }
         }
+    }
 
-        if (!subs_copy.empty()) {
-            ESP_LOGD(TAG, "Delivering to %d subscriber(s)", subs_copy.size());
-            for (auto& sub : subs_copy) {
-                sub.callback(topic, payload);
+    if (slot.dispatch_lists.empty()) {
+        m_messages_unmatched++;
+        ESP_LOGW(TAG, "No subscriber for topic: %s", slot.topic.c_str());
+    }
+}
+
+void MQTTManager::deliverChunk(const ReassemblySlot& slot, const char* data, size_t len, size_t offset, size_t total) {
+    for (const auto& list : slot.dispatch_lists) {
+        for (const auto& sub : *list) {
+            if (sub.chunk_callback) {
+                sub.chunk_callback(slot.topic, data, len, offset, total);
             }
-        } else {
-            ESP_LOGW(TAG, "No subscriber for topic: %s", topic.c_str());
         }
     }
 }
+
+void MQTTManager::deliverPayload(const ReassemblySlot& slot, const MqttPayload& payload,
+                                 const std::vector<SubscriptionHandle>& skip) {
+    int64_t complete_us = esp_timer_get_time();
+    bool has_class[DELIVERY_CLASSES] = {};
+    for (const auto& list : slot.dispatch_lists) {
+        for (const auto& sub : *list) {
+            if (sub.callback && (skip.empty() || std::find(skip.begin(), skip.end(), sub.handle) == skip.end())) {
+                has_class[static_cast<size_t>(sub.delivery)] = true;
+            }
+        }
+    }
+
+    // Alarm first, so its task can pre-empt this one as soon as the job is queued
+    for (size_t cls = 0; cls < DELIVERY_CLASSES; cls++) {
+        if (has_class[cls]) {
+            queueDelivery(static_cast<DeliveryClass>(cls), slot, payload, complete_us, skip);
+        }
+    }
+}
+
+void MQTTManager::startDispatcher() {
+    for (size_t cls = 0; cls < DELIVERY_CLASSES; cls++) {
+        DeliveryWorker& worker = m_workers[cls];
+        if (worker.queue) {
+            continue;
+        }
+        const DeliveryTaskConfig& config = DELIVERY_TASKS[cls];
+        worker.manager = this;
+        worker.delivery = static_cast<DeliveryClass>(cls);
+        worker.queue = xQueueCreate(config.depth, sizeof(DeliveryJob*));
+        if (!worker.queue) {
+            ESP_LOGE(TAG, "Failed to create %s queue, its subscribers run on the MQTT task", config.name);
+            continue;
+        }
+        if (xTaskCreate(delivery_task, config.name, config.stack, &worker, config.priority, nullptr) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to start %s task, its subscribers run on the MQTT task", config.name);
+            vQueueDelete(worker.queue);
+            worker.queue = nullptr;
+        }
+    }
+}
+
+void MQTTManager::queueDelivery(DeliveryClass delivery, const ReassemblySlot& slot, const MqttPayload& payload,
+                                int64_t complete_us, const std::vector<SubscriptionHandle>& skip) {
+    // The job shares the payload buffer and the subscriber snapshots; nothing is copied
+    DeliveryWorker& worker = m_workers[static_cast<size_t>(delivery)];
+    DeliveryJob* job = new DeliveryJob{slot.topic, payload, slot.dispatch_lists, complete_us, skip};
+    if (!worker.queue) {
+        deliverJob(worker, *job);
+        delete job;
+        return;
+    }
+    if (xQueueSend(worker.queue, &job, 0) != pdTRUE) {
+        delete job;
+        xSemaphoreTake(m_dispatch_mutex, portMAX_DELAY);
+        m_dispatch_stats[static_cast<size_t>(delivery)].dropped++;
+        xSemaphoreGive(m_dispatch_mutex);
+        ESP_LOGW(TAG, "%s queue full, dropped message on %s", DELIVERY_TASKS[static_cast<size_t>(delivery)].name,
+                 slot.topic.c_str());
+        return;
+    }
+
+    uint32_t depth = uxQueueMessagesWaiting(worker.queue);
+    xSemaphoreTake(m_dispatch_mutex, portMAX_DELAY);
+    DispatchStats& stats = m_dispatch_stats[static_cast<size_t>(delivery)];
+    stats.peak_depth = std::max(stats.peak_depth, depth);
+    xSemaphoreGive(m_dispatch_mutex);
+}
+
+void MQTTManager::delivery_task(void* arg) {
+    DeliveryWorker* worker = static_cast<DeliveryWorker*>(arg);
+    while (true) {
+        DeliveryJob* job = nullptr;
+        if (xQueueReceive(worker->queue, &job, portMAX_DELAY) == pdTRUE) {
+            worker->manager->deliverJob(*worker, *job);
+            delete job;
+        }
+    }
+}
+
+void MQTTManager::deliverJob(DeliveryWorker& worker, const DeliveryJob& job) {
+    uint32_t delivered = 0;
+    for (const auto& list : job.dispatch_lists) {
+        for (const auto& sub : *list) {
+            if (!sub.callback || sub.delivery != worker.delivery ||
+                std::find(job.skip.begin(), job.skip.end(), sub.handle) != job.skip.end()) {
+                continue;
+            }
+            // The snapshot may be older than an unsubscribe made while the job was queued. Once
+            // marked in flight, unsubscribe() waits for the callback before its owner can go away.
+            if (m_mutex) {
+                xSemaphoreTake(m_mutex, portMAX_DELAY);
+            }
+            bool subscribed = m_handle_to_topic.count(sub.handle) > 0;
+            if (subscribed) {
+                worker.in_flight = sub.handle;
+                worker.in_flight_task = xTaskGetCurrentTaskHandle();
+            }
+            if (m_mutex) {
+                xSemaphoreGive(m_mutex);
+            }
+            if (!subscribed) {
+                continue;
+            }
+            sub.callback(job.topic, job.payload);
+            delivered++;
+            if (m_mutex) {
+                xSemaphoreTake(m_mutex, portMAX_DELAY);
+            }
+            worker.in_flight = 0;
+            worker.in_flight_task = nullptr;
+            if (m_mutex) {
+                xSemaphoreGive(m_mutex);
+            }
+        }
+    }
+    if (delivered > 0) {
+        recordDispatch(worker.delivery, delivered, esp_timer_get_time() - job.complete_us);
+    }
+}
+
+bool MQTTManager::isInFlight(SubscriptionHandle handle, TaskHandle_t self) const {
+    for (const DeliveryWorker& worker : m_workers) {
+        // A callback that unsubscribes itself must not wait for itself
+        if (worker.in_flight == handle && worker.in_flight_task != self) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void MQTTManager::waitForDelivery(SubscriptionHandle handle) {
+    if (!m_mutex) {
+        return;
+    }
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    while (true) {
+        xSemaphoreTake(m_mutex, portMAX_DELAY);
+        bool busy = isInFlight(handle, self);
+        xSemaphoreGive(m_mutex);
+        if (!busy) {
+            return;
+        }
+        vTaskDelay(1);
+    }
+}
+
+void MQTTManager::recordDispatch(DeliveryClass delivery, uint32_t delivered, int64_t latency_us) {
+    xSemaphoreTake(m_dispatch_mutex, portMAX_DELAY);
+    DispatchStats& stats = m_dispatch_stats[static_cast<size_t>(delivery)];
+    stats.delivered += delivered;
+    stats.max_latency_us = std::max(stats.max_latency_us, static_cast<uint32_t>(latency_us));
+    stats.total_latency_us += static_cast<uint64_t>(latency_us) * delivered;
+    xSemaphoreGive(m_dispatch_mutex);
+}
+
+MQTTManager::DispatchStats MQTTManager::getDispatchStats(DeliveryClass delivery) const {
+    xSemaphoreTake(m_dispatch_mutex, portMAX_DELAY);
+    DispatchStats stats = m_dispatch_stats[static_cast<size_t>(delivery)];
+    xSemaphoreGive(m_dispatch_mutex);
+    QueueHandle_t queue = m_workers[static_cast<size_t>(delivery)].queue;
+    if (queue) {
+        stats.depth = uxQueueMessagesWaiting(queue);
+    }
+    return stats;
+}
+
+void MQTTManager::finishMessage(ReassemblySlot& slot, const MqttPayload* payload) {
+    m_messages_received.fetch_add(1, std::memory_order_relaxed);
+
+    std::vector<SubscriptionHandle> skip;
+    if (payload && slot.has_payload_subscribers && storeLastValue(slot, *payload, skip)) {
+        deliverPayload(slot, *payload, skip);
+    }
+    releaseSlot(slot);
+}
+
+MQTTManager::ReassemblySlot* MQTTManager::startSlot(esp_mqtt_event_handle_t event, TickType_t now) {
+    ReassemblySlot* slot = nullptr;
+    for (auto& candidate : m_slots) {
+        if (!candidate.active) {
+            slot = &candidate;
+            break;
+        }
+        // Least recently fed message makes room if every slot is taken
+        if (!slot || now - candidate.last_chunk > now - slot->last_chunk) {
+            slot = &candidate;
+        }
+    }
+    if (slot->active) {
+        abortSlot(*slot, m_reassembly_stats.evicted, "all reassembly slots busy");
+    }
+
+    slot->active = true;
+    slot->topic.assign(event->topic, event->topic_len);
+    slot->msg_id = event->msg_id;
+    slot->retain = event->retain;
+    slot->total = event->total_data_len;
+    slot->received = 0;
+    slot->last_chunk = now;
+    beginMessage(*slot);
+
+    if (slot->has_payload_subscribers && !reserveBuffer(*slot) && !slot->has_chunk_subscribers) {
+        ESP_LOGW(TAG, "Dropping %u byte message on %s", (unsigned)slot->total, slot->topic.c_str());
+    }
+    return slot;
+}
+
+bool MQTTManager::reserveBuffer(ReassemblySlot& slot) {
+    if (slot.total > slot.max_size || slot.total > m_reassembly_budget) {
+        m_reassembly_stats.oversize++;
+        ESP_LOGW(TAG, "Message on %s too large to assemble: %u bytes (limit %u)", slot.topic.c_str(),
+                 (unsigned)slot.total, (unsigned)std::min(slot.max_size, m_reassembly_budget));
+        return false;
+    }
+
+    // Stay within the pool budget by dropping the least recently fed messages
+    while (m_buffered_bytes + slot.total > m_reassembly_budget) {
+        ReassemblySlot* oldest = nullptr;
+        for (auto& candidate : m_slots) {
+            if (&candidate != &slot && candidate.active && candidate.assemble &&
+                (!oldest || slot.last_chunk - candidate.last_chunk > slot.last_chunk - oldest->last_chunk)) {
+                oldest = &candidate;
+            }
+        }
+        if (!oldest) {
+            break;
+        }
+        abortSlot(*oldest, m_reassembly_stats.evicted, "reassembly memory budget exhausted");
+    }
+
+    slot.buffer.reserve(slot.total);
+    slot.assemble = true;
+    m_buffered_bytes += slot.total;
+    m_reassembly_stats.peak_bytes = std::max(m_reassembly_stats.peak_bytes, m_buffered_bytes);
+    return true;
+}
+
+MQTTManager::ReassemblySlot* MQTTManager::findSlot(int msg_id, size_t offset) {
+    ReassemblySlot* same_id = nullptr;
+    int same_id_count = 0;
+    for (auto& slot : m_slots) {
+        if (!slot.active || slot.msg_id != msg_id) {
+            continue;
+        }
+        if (slot.received == offset) {
+            return &slot;
+        }
+        same_id = &slot;
+        same_id_count++;
+    }
+
+    // QoS 0 messages all have msg id 0, so a gap can only be pinned on a message when one is open
+    if (same_id_count == 1) {
+        ESP_LOGW(TAG, "Chunk at offset %u on %s, expected %u", (unsigned)offset, same_id->topic.c_str(),
+                 (unsigned)same_id->received);
+        abortSlot(*same_id, m_reassembly_stats.gaps, "missing chunk");
+    } else {
+        m_reassembly_stats.orphan_chunks++;
+        ESP_LOGD(TAG, "Dropping chunk at offset %u (msg_id=%d): message start missed", (unsigned)offset, msg_id);
+    }
+    return nullptr;
+}
+
+void MQTTManager::releaseSlot(ReassemblySlot& slot) {
+    if (slot.assemble) {
+        m_buffered_bytes -= slot.total;
+    }
+    slot.assemble = false;
+    std::string().swap(slot.buffer);  // Return the memory instead of keeping the capacity
+    slot.dispatch_lists.clear();
+    slot.topic.clear();
+    slot.active = false;
+}
+
+void MQTTManager::abortSlot(ReassemblySlot& slot, uint32_t& counter, const char* reason) {
+    counter++;
+    const ReassemblyStats& stats = m_reassembly_stats;
+    ESP_LOGW(TAG, "Dropped message on %s at %u/%u bytes: %s (timeouts=%lu gaps=%lu evicted=%lu aborted=%lu)",
+             slot.topic.c_str(), (unsigned)slot.received, (unsigned)slot.total, reason,
+             (unsigned long)stats.timeouts, (unsigned long)stats.gaps, (unsigned long)stats.evicted,
+             (unsigned long)stats.aborted);
+    if (slot.has_chunk_subscribers) {
+        deliverChunk(slot, nullptr, 0, slot.received, slot.total);
+    }
+    releaseSlot(slot);
+}
+
+void MQTTManager::expireSlots(TickType_t now) {
+    for (auto& slot : m_slots) {
+        if (slot.active && now - slot.last_chunk > m_reassembly_timeout) {
+            abortSlot(slot, m_reassembly_stats.timeouts, "timed out");
+        }
+    }
+}
+
+void MQTTManager::handleData(esp_mqtt_event_handle_t event) {
+    size_t offset = event->current_data_offset;
+    size_t total = event->total_data_len;
+    size_t len = event->data_len;
+    TickType_t now = xTaskGetTickCount();
+
+    expireSlots(now);
+
+    if (offset == 0 && len >= total) {
+        // Whole message in one event: delivered straight from the client buffer
+        m_direct.topic.assign(event->topic, event->topic_len);
+        m_direct.total = total;
+        m_direct.retain = event->retain;
+        beginMessage(m_direct);
+        if (m_direct.has_chunk_subscribers) {
+            deliverChunk(m_direct, event->data, len, 0, total);
+        }
+        MqttPayload payload;
+        if (m_direct.has_payload_subscribers) {
+            payload = MqttPayload(event->data, len);
+            ESP_LOGD(TAG, "Received on %s: %d bytes", m_direct.topic.c_str(), payload.size());
+        }
+        finishMessage(m_direct, &payload);
+        return;
+    }
+
+    // The topic is only present on the first chunk; continuations are matched by msg id and offset
+    ReassemblySlot* slot = offset == 0 ? startSlot(event, now) : findSlot(event->msg_id, offset);
+    if (!slot) {
+        return;
+    }
+
+    ESP_LOGD(TAG, "Chunked message on %s: offset=%u, chunk_len=%u, total=%u",
+             slot->topic.c_str(), (unsigned)offset, (unsigned)len, (unsigned)total);
+
+    slot->last_chunk = now;
+    slot->received = offset + len;
+    if (slot->has_chunk_subscribers) {
+        deliverChunk(*slot, event->data, len, offset, total);
+    }
+    if (slot->assemble) {
+        slot->buffer.append(event->data, len);
+    }
+
+    if (slot->received < slot->total) {
+        return;
+    }
+
+    m_reassembly_stats.completed++;
+    if (!slot->assemble) {
+        finishMessage(*slot, nullptr);  // Streamed to chunk subscribers only, or too large to assemble
+        return;
+    }
+    ESP_LOGI(TAG, "Complete message received on %s: %u bytes",
+             slot->topic.c_str(), (unsigned)slot->buffer.size());
+    // Hand the assembled buffer over to the payload instead of copying it
+    MqttPayload payload = MqttPayload::adopt(std::move(slot->buffer));
+    finishMessage(*slot, &payload);
+}
@@ -54,6 +54,7 @@ public:
     const std::string& getPassword() const { return m_password; }
     const std::string& getClientId() const { return m_client_id; }
     const std::string& getConfigTopic() const { return m_config_topic; }
+    bool getMqtt5() const { return m_mqtt5; }
     
 private:
     SettingsUI();
@@ -113,6 +114,7 @@ private:
     lv_obj_t* m_password_input;
     lv_obj_t* m_client_id_input;
     lv_obj_t* m_config_topic_input;
+    lv_obj_t* m_mqtt5_switch;
     lv_obj_t* m_mqtt_status_label;
     lv_obj_t* m_mqtt_broker_label;
     lv_obj_t* m_mqtt_messages_received_label;
@@ -158,6 +160,7 @@ private:
     std::string m_password;
     std::string m_client_id;
     std::string m_config_topic;
+    bool m_mqtt5;  // Opt-in: MQTT 3.1.1 unless enabled
     
     // Network configuration
     struct NetworkConfig {
@@ -22,6 +22,7 @@ static const char* NVS_KEY_USERNAME = "username";
 static const char* NVS_KEY_PASSWORD = "password";
 static const char* NVS_KEY_CLIENT_ID = "client_id";
 static const char* NVS_KEY_CONFIG_TOPIC = "config_topic";
+static const char* NVS_KEY_MQTT5 = "mqtt5";
 
 SettingsUI& SettingsUI::getInstance() {
     static SettingsUI instance;
@@ -39,6 +40,7 @@ SettingsUI::SettingsUI()
     , m_password_input(nullptr)
     , m_client_id_input(nullptr)
     , m_config_topic_input(nullptr)
+    , m_mqtt5_switch(nullptr)
     , m_lan_dhcp_switch(nullptr)
     , m_lan_ip_input(nullptr)
     , m_lan_netmask_input(nullptr)
@@ -65,7 +67,8 @@ SettingsUI::SettingsUI()
     , m_wifi_radio_channel_label(nullptr)
     , m_visible(false)
     , m_broker_uri("mqtt://")
-    , m_config_topic("hmi/config") {
+    , m_config_topic("hmi/config")
+    , m_mqtt5(false) {
     // Initialize network config with defaults
     m_network_config.lan_dhcp = true;
     m_network_config.lan_netmask = "255.255.255.0";
@@ -296,6 +299,7 @@ void SettingsUI::destroySettingsScreen() {
         m_password_input = nullptr;
         m_client_id_input = nullptr;
         m_config_topic_input = nullptr;
+        m_mqtt5_switch = nullptr;
         m_mqtt_status_label = nullptr;
         m_mqtt_broker_label = nullptr;
         m_mqtt_messages_received_label = nullptr;
@@ -424,7 +428,20 @@ void SettingsUI::createMqttTab(lv_obj_t* tab) {
     lv_obj_add_event_cb(m_config_topic_input, textarea_focused_cb, LV_EVENT_FOCUSED, this);
     lv_obj_add_event_cb(m_config_topic_input, textarea_defocused_cb, LV_EVENT_DEFOCUSED, this);
     
-    y_pos += field_height + 25;
+    y_pos += field_height + 15;
+    
+    // MQTT 5 (topic aliases); off for brokers that only speak 3.1.1
+    lv_obj_t* mqtt5_label = lv_label_create(left_container);
+    lv_label_set_text(mqtt5_label, "MQTT 5:");
+    lv_obj_set_pos(mqtt5_label, 0, y_pos + 5);
+    
+    m_mqtt5_switch = lv_switch_create(left_container);
+    lv_obj_set_pos(m_mqtt5_switch, 100, y_pos);
+    if (m_mqtt5) {
+        lv_obj_add_state(m_mqtt5_switch, LV_STATE_CHECKED);
+    }
+    
+    y_pos += 50;
     
     // Save & Apply button
     lv_obj_t* save_btn = lv_button_create(left_container);
@@ -1186,6 +1203,7 @@ void SettingsUI::mqtt_save_clicked_cb(lv_event_t* e) {
     ui->m_password = lv_textarea_get_text(ui->m_password_input);
     ui->m_client_id = lv_textarea_get_text(ui->m_client_id_input);
     ui->m_config_topic = lv_textarea_get_text(ui->m_config_topic_input);
+    ui->m_mqtt5 = lv_obj_has_state(ui->m_mqtt5_switch, LV_STATE_CHECKED);
     
     // Save to NVS
     if (ui->saveSettings()) {
@@ -1193,6 +1211,7 @@ void SettingsUI::mqtt_save_clicked_cb(lv_event_t* e) {
         
         // Reconnect MQTT with new settings
         MQTTManager::getInstance().deinit();
+        MQTTManager::getInstance().setMqtt5(ui->m_mqtt5);
         
         if (!ui->m_username.empty()) {
             MQTTManager::getInstance().init(ui->m_broker_uri, ui->m_username, 
@@ -1462,8 +1481,8 @@ void SettingsUI::textarea_defocused_cb(lv_event_t* e) {
 
 void SettingsUI::createKeyboard() {
     if (!m_keyboard) {
-        // Create keyboard on root screen, not settings layer
-        m_keyboard = lv_keyboard_create(lv_screen_active());
+        // Create keyboard on the top layer, not settings layer; the widget screen can be replaced
+        m_keyboard = lv_keyboard_create(lv_layer_top());
         lv_obj_set_size(m_keyboard, LV_PCT(100), LV_PCT(40));
         lv_obj_align(m_keyboard, LV_ALIGN_BOTTOM_MID, 0, 0);
         lv_obj_add_flag(m_keyboard, LV_OBJ_FLAG_HIDDEN);  // Start hidden
@@ -1472,7 +1491,7 @@ void SettingsUI::createKeyboard() {
         // Add callback for when Enter is pressed on keyboard
         lv_obj_add_event_cb(m_keyboard, keyboard_ready_cb, LV_EVENT_READY, this);
         
-        ESP_LOGI(TAG, "Keyboard created on root screen (floating)");
+        ESP_LOGI(TAG, "Keyboard created on top layer (floating)");
     }
 }
 
@@ -1526,6 +1545,11 @@ bool SettingsUI::loadSettings() {
     read_str(NVS_KEY_CLIENT_ID, m_client_id);
     read_str(NVS_KEY_CONFIG_TOPIC, m_config_topic);
     
+    uint8_t mqtt5 = 0;
+    if (nvs_get_u8(nvs_handle, NVS_KEY_MQTT5, &mqtt5) == ESP_OK) {
+        m_mqtt5 = mqtt5 != 0;
+    }
+    
     nvs_close(nvs_handle);
     
     ESP_LOGI(TAG, "Settings loaded from NVS");
@@ -1533,6 +1557,7 @@ bool SettingsUI::loadSettings() {
     ESP_LOGI(TAG, "  Username: %s", m_username.empty() ? "(none)" : m_username.c_str());
     ESP_LOGI(TAG, "  Client ID: %s", m_client_id.empty() ? "(auto)" : m_client_id.c_str());
     ESP_LOGI(TAG, "  Config Topic: %s", m_config_topic.c_str());
+    ESP_LOGI(TAG, "  MQTT 5: %s", m_mqtt5 ? "on" : "off");
     
     return true;
 }
@@ -1556,6 +1581,7 @@ bool SettingsUI::saveSettings() {
     success &= (write_str(NVS_KEY_PASSWORD, m_password) == ESP_OK);
     success &= (write_str(NVS_KEY_CLIENT_ID, m_client_id) == ESP_OK);
     success &= (write_str(NVS_KEY_CONFIG_TOPIC, m_config_topic) == ESP_OK);
+    success &= (nvs_set_u8(nvs_handle, NVS_KEY_MQTT5, m_mqtt5 ? 1 : 0) == ESP_OK);
     
     err = nvs_commit(nvs_handle);
     nvs_close(nvs_handle);
@@ -64,8 +64,8 @@ void StatusInfoUI::createInfoIcon(lv_obj_t* parent) {
 }
 
 void StatusInfoUI::createStatusScreen() {
-    // Create modal overlay
-    m_status_screen = lv_obj_create(lv_screen_active());
+    // Create modal overlay on the top layer so a config reload does not take it down
+    m_status_screen = lv_obj_create(lv_layer_top());
     lv_obj_set_size(m_status_screen, LV_PCT(60), LV_PCT(70));
     lv_obj_center(m_status_screen);
     lv_obj_set_style_bg_color(m_status_screen, lv_color_hex(0x34495E), 0);
@@ -20,6 +20,9 @@ def build_parser() -> argparse.ArgumentParser:
     parser.add_argument("--amplitude", type=float, default=45.0, help="Sine amplitude")
     parser.add_argument("--qos", type=int, choices=[0, 1, 2], default=0, help="MQTT QoS")
     parser.add_argument("--retain", action="store_true", help="Publish retained messages")
+    parser.add_argument(
+        "--batch", type=int, default=1, help="Samples per message, sent as a JSON array when > 1"
+    )
     return parser
 
 
@@ -39,6 +42,9 @@ def main() -> int:
     if args.samples_period <= 0:
         print("samples-period must be > 0", file=sys.stderr)
         return 2
+    if args.batch <= 0:
+        print("batch must be > 0", file=sys.stderr)
+        return 2
 
     stop = False
 
@@ -49,7 +55,7 @@ def main() -> int:
     signal.signal(signal.SIGINT, handle_stop)
     signal.signal(signal.SIGTERM, handle_stop)
 
-    interval = 1.0 / args.samples_per_sec
+    interval = args.batch / args.samples_per_sec
     omega = (2.0 * math.pi) / float(args.samples_period)
 
     print(
@@ -61,17 +67,20 @@ def main() -> int:
     next_tick = time.monotonic()
 
     while not stop:
-        value = args.center + args.amplitude * math.sin(omega * sample_index)
-        payload = str(int(round(value)))
+        samples = []
+        for _ in range(args.batch):
+            value = args.center + args.amplitude * math.sin(omega * sample_index)
+            samples.append(str(int(round(value))))
+            sample_index += 1
+        payload = samples[0] if args.batch == 1 else "[" + ",".join(samples) + "]"
 
         try:
             publish_sample(args.broker, args.topic, payload, args.qos, args.retain)
-            print(f"n={sample_index:6d} -> {payload}")
+            print(f"n={sample_index - args.batch:6d} -> {payload}")
         except subprocess.CalledProcessError:
             print("Failed to publish. Is mosquitto_pub installed and broker reachable?", file=sys.stderr)
             return 1
 
-        sample_index += 1
         next_tick += interval
         sleep_for = next_tick - time.monotonic()
         if sleep_for > 0:
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <dirent.h>
+#include <atomic>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
@@ -11,6 +12,7 @@
 #include "bsp/esp-bsp.h"
 #include "mqtt_manager.h"
 #include "config_manager.h"
+#include "widget_update_bus.h"
 #include "settings_ui.h"
 #include "wireless_manager.h"
 #include "lan_manager.h"
@@ -20,6 +22,9 @@
 
 static const char *TAG = "app_main_cpp";
 
+// Set by the MQTT status callback (esp_timer task), applied to the settings UI by the HMI task
+static std::atomic<bool> s_mqtt_status_pending{false};
+
 extern "C" lv_indev_t *app_get_touch_indev(void);
 
 // Global touch event filter for backlight activity reset
@@ -43,17 +48,14 @@ static void mqtt_task(void *pvParameters)
     // Initialize MQTT with loaded settings
     MQTTManager &mqtt = MQTTManager::getInstance();
 
-    // Register status callback to update SettingsUI
-    mqtt.setStatusCallback([](bool connected, uint32_t messages_received, uint32_t messages_sent)
-                           {
-                               auto *data = new std::tuple<bool, uint32_t, uint32_t>(connected, messages_received, messages_sent);
-                               lv_async_call([](void *user_data) {
-                                   auto *payload = static_cast<std::tuple<bool, uint32_t, uint32_t> *>(user_data);
-                                   auto &[is_connected, received, sent] = *payload;
-                                   SettingsUI::getInstance().onMqttStatusChanged(is_connected, received, sent);
-                                   delete payload;
-                               }, data);
-                           });
+    // Register status callback to update SettingsUI. MQTTManager reports at most once a second
+    // (plus connection changes) from the esp_timer task, which must not touch LVGL; it only flags
+    // the update, and the HMI task applies it under the LVGL lock with the latest counters.
+    mqtt.setStatusCallback([](bool, uint32_t, uint32_t)
+                           { s_mqtt_status_pending.store(true, std::memory_order_release); });
+
+    // MQTT 5 is opt-in per device (settings); the default stays MQTT 3.1.1
+    mqtt.setMqtt5(settings.getMqtt5());
 
     if (!settings.getUsername().empty())
     {
@@ -80,11 +82,23 @@ static void mqtt_task(void *pvParameters)
         std::string config_topic = settings.getConfigTopic();
         ESP_LOGI(TAG, "MQTT connected, subscribing to config topic: %s", config_topic.c_str());
 
-        // Subscribe to configuration topic
-        mqtt.subscribe(config_topic, 0, [](const std::string &topic, const std::string &payload)
+        // Subscribe to configuration topic; the config is parsed while it arrives instead of
+        // being assembled in RAM first
+        mqtt.subscribeChunks(config_topic, 0, [](const std::string &topic, const char *data, size_t len,
+                                                 size_t offset, size_t total)
+                             {
+            if (offset == 0) {
+                ESP_LOGD(TAG, "Receiving config on %s, size: %u bytes", topic.c_str(), (unsigned)total);
+            }
+            ConfigManager::getInstance().streamConfigChunk(data, len, offset, total); });
+
+        // Subscribe to partial config patches addressed by widget id
+        std::string patch_topic = config_topic + "/patch";
+        ESP_LOGI(TAG, "Subscribing to config patch topic: %s", patch_topic.c_str());
+        mqtt.subscribe(patch_topic, 0, [](const std::string &topic, const MqttPayload &payload)
                        {
-            ESP_LOGD(TAG, "Received config on %s, size: %d bytes", topic.c_str(), payload.size());
-            ConfigManager::getInstance().queueConfig(payload); });
+            ESP_LOGD(TAG, "Received config patch on %s, size: %d bytes", topic.c_str(), payload.size());
+            ConfigManager::getInstance().queuePatch(payload); }, MQTTManager::DeliveryClass::Config);
     }
     else
     {
@@ -105,21 +119,33 @@ static void hmi_task(void *pvParameters)
 
     while (1)
     {
+        // Configs are parsed by the task that queued them; take the LVGL lock only to apply them
+        if (!ConfigManager::getInstance().hasPendingWork() && !s_mqtt_status_pending.load(std::memory_order_acquire)) {
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+
         // Lock LVGL and perform UI operations
         if (esp_lv_adapter_lock(-1) != ESP_OK) {
             vTaskDelay(pdMS_TO_TICKS(10));
             continue;
         }
 
+        if (s_mqtt_status_pending.exchange(false, std::memory_order_acq_rel)) {
+            MQTTManager &mqtt = MQTTManager::getInstance();
+            SettingsUI::getInstance().onMqttStatusChanged(mqtt.isConnected(), mqtt.getMessagesReceived(),
+                                                          mqtt.getMessagesSent());
+        }
+
         // Process any pending configuration from MQTT
-        ConfigManager::getInstance().processPendingConfig();
+        bool streaming = ConfigManager::getInstance().processPendingConfig();
 
         // lv_timer_handler is called automatically by the LVGL port
 
         esp_lv_adapter_unlock();
 
-        // Sleep for a bit
-        vTaskDelay(pdMS_TO_TICKS(100));
+        // Sleep for a bit (short while a streamed config is arriving, the config task waits on us)
+        vTaskDelay(pdMS_TO_TICKS(streaming ? 5 : 100));
     }
 }
 
@@ -154,8 +180,12 @@ static void init_base_ui(void)
         lv_indev_add_event_cb(indev_touch, touch_event_cb, LV_EVENT_ALL, NULL);
     }
 
-    // Initialize settings UI (creates gear icon in bottom-right)
-    SettingsUI::getInstance().init(scr);
+    // Initialize settings UI (creates gear icon in bottom-right). It lives on the top layer,
+    // so it stays above the widget screen when a config reload swaps it for a new one.
+    SettingsUI::getInstance().init(lv_layer_top());
+
+    // Apply MQTT-driven widget updates once per frame
+    WidgetUpdateBus::getInstance().init();
 
     esp_lv_adapter_unlock();
 
@@ -229,6 +259,18 @@ extern "C" void app_main_cpp(void)
     // Initialize base UI first (gear icon + placeholder) - shows immediately
     init_base_ui();
 
+    // Rebuild the last applied layout from flash while the network comes up;
+    // the live config is reconciled against it once MQTT delivers it
+    if (esp_lv_adapter_lock(-1) == ESP_OK)
+    {
+        bool cached = ConfigManager::getInstance().loadCachedLayout();
+        esp_lv_adapter_unlock();
+        if (cached)
+        {
+            ESP_LOGI(TAG, "Startup: cached UI ready %lld ms after boot", esp_timer_get_time() / 1000);
+        }
+    }
+
 #if BSP_CAPS_SDCARD
     // Initialize SD card for image storage
     ESP_LOGI(TAG, "Mounting SD card...");
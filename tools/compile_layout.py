@@ -0,0 +1,323 @@
+#!/usr/bin/env python3
+"""Compile a FlexiHMI JSON configuration into the binary layout cache format.
+
+The output is the same image ConfigManager stores in the "layout" partition after
+applying a config (see components/config_manager/include/layout_cache.h), so a
+panel can be pre-provisioned to boot straight into a UI:
+
+    python3 tools/compile_layout.py examples/json/tabview_demo.json -o layout.bin
+    parttool.py write_partition --partition-name layout --input layout.bin
+"""
+
+import argparse
+import copy
+import json
+import math
+import re
+import struct
+import sys
+import zlib
+from pathlib import Path
+
+LAYOUT_MAGIC = 0x434C4846  # "FHLC"
+LAYOUT_FORMAT_VERSION = 2
+
+TAG_NULL, TAG_FALSE, TAG_TRUE, TAG_INT, TAG_DOUBLE = 0, 1, 2, 3, 4
+TAG_STRING, TAG_COLOR, TAG_ARRAY, TAG_OBJECT = 5, 6, 7, 8
+
+# Must match LAYOUT_WIDGET_TYPES in layout_cache.h
+WIDGET_TYPES = [
+    "label", "button", "container", "switch", "slider", "bar", "arc", "checkbox",
+    "dropdown", "led", "spinner", "tabview", "gauge", "image", "line_chart",
+]
+
+TABLE_FIELDS = {"type", "id", "x", "y", "w", "h", "children"}
+# Root fields ConfigManager keeps in the cache after the widget table
+PAGE_FIELDS = ("pages", "start_page", "page_cache", "page_topic")
+HEX_UPPER = set("0123456789ABCDEF")
+
+# Must match ConfigTemplates (config_templates.h)
+PARAM_REF = re.compile(r"\$\{([^}]*)\}")
+MAX_TEMPLATE_NESTING = 8
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(
+        description="Compile a JSON UI configuration into a binary layout cache image."
+    )
+    parser.add_argument("config", help="Input JSON configuration")
+    parser.add_argument(
+        "-o",
+        "--output",
+        default=None,
+        help="Output .bin path (default: <config>.layout.bin)",
+    )
+    return parser.parse_args()
+
+
+def c_int(value) -> int:
+    """Mirror cJSON valueint: truncate toward zero and saturate to int32."""
+    if value >= 2147483647:
+        return 2147483647
+    if value <= -2147483648:
+        return -2147483648
+    return int(value)
+
+
+def param_text(value) -> str:
+    if isinstance(value, str):
+        return value
+    return json.dumps(value, separators=(",", ":"))
+
+
+class TemplateExpander:
+    """Replace template instances the way ConfigManager does before applying a config."""
+
+    def __init__(self, templates) -> None:
+        if not isinstance(templates, dict):
+            raise ValueError("'templates' must be an object keyed by template name")
+        for name, definition in templates.items():
+            if not isinstance(definition, dict):
+                raise ValueError(f"template '{name}' is not a widget object")
+        self.templates = templates
+
+    def substitute(self, value, scope: dict):
+        if isinstance(value, list):
+            return [self.substitute(item, scope) for item in value]
+        if isinstance(value, dict):
+            return {key: self.substitute(item, scope) for key, item in value.items()}
+        if not isinstance(value, str) or "${" not in value:
+            return value
+
+        def param(name: str):
+            if name == "id":
+                return scope["id"]
+            for source in (scope["params"], scope["defaults"]):
+                if name in source:
+                    return source[name]
+            raise ValueError(
+                f"template '{scope['name']}' needs parameter '{name}' (instance '{scope['id']}')"
+            )
+
+        whole = PARAM_REF.fullmatch(value)
+        if whole:
+            return copy.deepcopy(param(whole.group(1)))
+        return PARAM_REF.sub(lambda match: param_text(param(match.group(1))), value)
+
+    def instantiate(self, instance: dict, depth: int) -> dict:
+        if depth >= MAX_TEMPLATE_NESTING:
+            raise ValueError(f"templates nested more than {MAX_TEMPLATE_NESTING} deep")
+        name = instance["template"]
+        if not isinstance(name, str):
+            raise ValueError("'template' must be a template name")
+        if name not in self.templates:
+            raise ValueError(f"unknown template '{name}'")
+        widget_id = instance.get("id")
+        if not isinstance(widget_id, str) or not widget_id:
+            raise ValueError(f"instance of template '{name}' needs an 'id'")
+
+        definition = self.templates[name]
+        params = instance.get("params")
+        defaults = definition.get("params")
+        scope = {
+            "name": name,
+            "id": widget_id,
+            "params": params if isinstance(params, dict) else {},
+            "defaults": defaults if isinstance(defaults, dict) else {},
+        }
+        widget = self.substitute({k: v for k, v in definition.items() if k != "params"}, scope)
+        for key, value in instance.items():
+            if key in ("template", "params"):
+                continue
+            if key == "properties" and isinstance(value, dict) and isinstance(widget.get(key), dict):
+                widget[key].update(copy.deepcopy(value))
+            else:
+                widget[key] = copy.deepcopy(value)
+        return self.expand_widget(widget, depth + 1)
+
+    def expand_widget(self, widget, depth: int = 0):
+        if not isinstance(widget, dict):
+            return widget
+        if "template" in widget:
+            return self.instantiate(widget, depth)
+        children = widget.get("children")
+        if isinstance(children, list):
+            widget["children"] = self.expand_list(children, depth)
+        elif isinstance(children, dict):
+            for tab, tab_children in children.items():
+                if isinstance(tab_children, list):
+                    children[tab] = self.expand_list(tab_children, depth)
+        return widget
+
+    def expand_list(self, widgets: list, depth: int = 0) -> list:
+        return [self.expand_widget(widget, depth) for widget in widgets]
+
+
+class Encoder:
+    def __init__(self) -> None:
+        self.body = bytearray()
+        self.strings: list[str] = []
+        self.string_index: dict[str, int] = {}
+        self.widget_count = 0
+
+    def put_varint(self, value: int, out: bytearray | None = None) -> None:
+        out = self.body if out is None else out
+        while value >= 0x80:
+            out.append((value & 0x7F) | 0x80)
+            value >>= 7
+        out.append(value)
+
+    def put_zigzag(self, value: int, out: bytearray | None = None) -> None:
+        self.put_varint(((value << 1) ^ (value >> 63)) & 0xFFFFFFFFFFFFFFFF, out)
+
+    def intern(self, text: str) -> int:
+        index = self.string_index.get(text)
+        if index is None:
+            index = len(self.strings)
+            self.strings.append(text)
+            self.string_index[text] = index
+        return index
+
+    def put_value(self, value, depth: int = 0) -> None:
+        if value is None or depth > 32:
+            self.body.append(TAG_NULL)
+        elif value is False:
+            self.body.append(TAG_FALSE)
+        elif value is True:
+            self.body.append(TAG_TRUE)
+        elif isinstance(value, (int, float)):
+            number = float(value)
+            if math.isfinite(number) and math.floor(number) == number and abs(number) < 2147483648.0:
+                self.body.append(TAG_INT)
+                self.put_zigzag(int(number))
+            else:
+                self.body.append(TAG_DOUBLE)
+                self.body += struct.pack("<d", number)
+        elif isinstance(value, str):
+            if len(value) == 7 and value[0] == "#" and set(value[1:]) <= HEX_UPPER:
+                self.body.append(TAG_COLOR)
+                self.body += bytes.fromhex(value[1:])
+            else:
+                self.body.append(TAG_STRING)
+                self.put_varint(self.intern(value))
+        elif isinstance(value, list):
+            self.body.append(TAG_ARRAY)
+            self.put_varint(len(value))
+            for element in value:
+                self.put_value(element, depth + 1)
+        elif isinstance(value, dict):
+            self.body.append(TAG_OBJECT)
+            self.put_varint(len(value))
+            for key, element in value.items():
+                self.put_varint(self.intern(key))
+                self.put_value(element, depth + 1)
+        else:
+            self.body.append(TAG_NULL)
+
+    def put_widget(self, widget, parent: int, tab: int) -> None:
+        if not isinstance(widget, dict):
+            print("warning: skipping non-object widget", file=sys.stderr)
+            return
+        wtype, wid = widget.get("type"), widget.get("id")
+        coords = [widget.get(k) for k in ("x", "y", "w", "h")]
+        if (
+            not isinstance(wtype, str)
+            or not isinstance(wid, str)
+            or any(isinstance(c, bool) or not isinstance(c, (int, float)) for c in coords)
+        ):
+            print(f"warning: skipping incomplete widget {wid!r}", file=sys.stderr)
+            return
+        if wtype not in WIDGET_TYPES:
+            print(f"warning: skipping widget {wid!r} of unknown type {wtype!r}", file=sys.stderr)
+            return
+
+        index = self.widget_count
+        self.widget_count += 1
+        self.body.append(WIDGET_TYPES.index(wtype))
+        self.put_varint(self.intern(wid))
+        self.put_varint(parent)
+        self.put_varint(tab)
+        for coord in coords:
+            self.put_zigzag(c_int(coord))
+
+        extras = [(k, v) for k, v in widget.items() if k not in TABLE_FIELDS]
+        self.put_varint(len(extras))
+        for key, value in extras:
+            self.put_varint(self.intern(key))
+            self.put_value(value)
+
+        children = widget.get("children")
+        if isinstance(children, list):
+            for child in children:
+                self.put_widget(child, index + 1, 0)
+        elif isinstance(children, dict):
+            for tab_name, tab_children in children.items():
+                if not isinstance(tab_children, list):
+                    continue
+                tab_index = self.intern(tab_name) + 1
+                for child in tab_children:
+                    self.put_widget(child, index + 1, tab_index)
+
+
+def compile_layout(config: dict) -> tuple[bytes, int]:
+    widgets = config.get("widgets")
+    if not isinstance(widgets, list):
+        raise ValueError("'widgets' must be an array")
+    expander = TemplateExpander(config.get("templates", {}))
+    widgets = expander.expand_list(widgets)
+
+    fields = {key: copy.deepcopy(config[key]) for key in PAGE_FIELDS if key in config}
+    for page in fields.get("pages", []) if isinstance(fields.get("pages"), list) else []:
+        if isinstance(page, dict) and isinstance(page.get("widgets"), list):
+            page["widgets"] = expander.expand_list(page["widgets"])
+
+    encoder = Encoder()
+    for widget in widgets:
+        encoder.put_widget(widget, 0, 0)
+    encoder.put_varint(len(fields))
+    for key, value in fields.items():
+        encoder.put_varint(encoder.intern(key))
+        encoder.put_value(value)
+
+    version = config.get("version")
+    if isinstance(version, bool) or not isinstance(version, (int, float)):
+        version = 0
+    head = bytearray()
+    encoder.put_zigzag(c_int(version), head)
+    encoder.put_varint(len(encoder.strings), head)
+    for text in encoder.strings:
+        raw = text.encode("utf-8")
+        encoder.put_varint(len(raw), head)
+        head += raw
+    encoder.put_varint(encoder.widget_count, head)
+
+    payload = bytes(head + encoder.body)
+    header = struct.pack(
+        "<IHHII", LAYOUT_MAGIC, LAYOUT_FORMAT_VERSION, 0, len(payload), zlib.crc32(payload)
+    )
+    return header + payload, encoder.widget_count
+
+
+def main() -> int:
+    args = parse_args()
+    config_path = Path(args.config)
+    output_path = Path(args.output) if args.output else config_path.with_suffix(".layout.bin")
+
+    try:
+        config = json.loads(config_path.read_text(encoding="utf-8"))
+        image, widget_count = compile_layout(config)
+    except (OSError, ValueError) as exc:
+        print(f"error: {exc}", file=sys.stderr)
+        return 1
+
+    output_path.write_bytes(image)
+    json_size = config_path.stat().st_size
+    print(
+        f"{config_path.name}: {widget_count} widgets, {json_size} bytes JSON -> "
+        f"{len(image)} bytes layout ({len(image) * 100 // max(json_size, 1)}%) -> {output_path}"
+    )
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,226 @@
+// Host-side benchmark for streamed config parsing.
+//
+// Scales every examples/json config to at least 1 MB (widgets are replicated with
+// unique ids) and feeds it in 4 KB chunks, the way MQTT delivers large messages.
+// Compares the previous path (assemble the whole message, then cJSON_Parse it)
+// with ConfigStreamParser, which parses one top-level widget at a time.
+// Reports peak heap (cJSON + std::string allocations) and parse time.
+//
+// Build and run from the repository root (cJSON from ESP-IDF's json component; the g++ command
+// is one line, split here only for reading):
+//   g++ -O2 -std=c++20 -I$IDF_PATH/components/json/cJSON -Icomponents/config_manager/include
+//       tools/config_stream_bench.cpp components/config_manager/config_stream_parser.cpp
+//       $IDF_PATH/components/json/cJSON/cJSON.c -o /tmp/config_stream_bench
+//   /tmp/config_stream_bench examples/json/*.json
+
+#include "config_stream_parser.h"
+
+#include <malloc.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+
+namespace {
+
+constexpr size_t kTargetSize = 1024 * 1024;
+constexpr size_t kChunkSize = 4096;
+
+size_t g_live = 0;
+size_t g_peak = 0;
+
+void* countedMalloc(size_t size) {
+    void* ptr = malloc(size);
+    if (ptr) {
+        g_live += malloc_usable_size(ptr);
+        g_peak = std::max(g_peak, g_live);
+    }
+    return ptr;
+}
+
+void countedFree(void* ptr) {
+    if (ptr) {
+        g_live -= malloc_usable_size(ptr);
+        free(ptr);
+    }
+}
+
+void resetPeak() {
+    g_peak = g_live;
+}
+
+// Append a suffix to every "id" in a widget tree so replicas stay unique
+void renameIds(cJSON* widget, const std::string& suffix) {
+    cJSON* id = cJSON_GetObjectItemCaseSensitive(widget, "id");
+    if (cJSON_IsString(id)) {
+        cJSON_SetValuestring(id, (std::string(id->valuestring) + suffix).c_str());
+    }
+    cJSON* children = cJSON_GetObjectItemCaseSensitive(widget, "children");
+    if (cJSON_IsArray(children)) {
+        cJSON* child = nullptr;
+        cJSON_ArrayForEach(child, children) {
+            renameIds(child, suffix);
+        }
+    } else if (cJSON_IsObject(children)) {
+        cJSON* tab = nullptr;
+        cJSON_ArrayForEach(tab, children) {
+            cJSON* child = nullptr;
+            cJSON_ArrayForEach(child, tab) {
+                renameIds(child, suffix);
+            }
+        }
+    }
+}
+
+bool scaleConfig(const std::string& source, std::string& scaled) {
+    cJSON* root = cJSON_Parse(source.c_str());
+    cJSON* widgets = cJSON_GetObjectItemCaseSensitive(root, "widgets");
+    if (!cJSON_IsArray(widgets) || cJSON_GetArraySize(widgets) == 0) {
+        cJSON_Delete(root);
+        return false;
+    }
+
+    cJSON* original = cJSON_Duplicate(widgets, true);
+    char* printed = cJSON_Print(root);
+    size_t size = strlen(printed);
+    cJSON_free(printed);
+    for (int copy = 1; size < kTargetSize; copy++) {
+        std::string suffix = "_r" + std::to_string(copy);
+        cJSON* widget = nullptr;
+        cJSON_ArrayForEach(widget, original) {
+            cJSON* replica = cJSON_Duplicate(widget, true);
+            renameIds(replica, suffix);
+            cJSON_AddItemToArray(widgets, replica);
+        }
+        printed = cJSON_Print(original);
+        size += strlen(printed);
+        cJSON_free(printed);
+    }
+    cJSON_Delete(original);
+
+    printed = cJSON_Print(root);
+    scaled = printed;
+    cJSON_free(printed);
+    cJSON_Delete(root);
+    return true;
+}
+
+struct Result {
+    bool ok = false;
+    int widgets = 0;
+    size_t peak = 0;
+    double ms = 0;
+};
+
+// Previous path: MQTTManager assembled the chunks, ConfigManager parsed the whole document
+Result runBuffered(const std::string& doc) {
+    Result result;
+    resetPeak();
+    size_t base = g_live;
+    auto start = std::chrono::steady_clock::now();
+
+    std::string buffer;
+    buffer.reserve(doc.size());
+    for (size_t offset = 0; offset < doc.size(); offset += kChunkSize) {
+        buffer.append(doc, offset, kChunkSize);
+    }
+    cJSON* root = cJSON_Parse(buffer.c_str());
+    cJSON* widgets = cJSON_GetObjectItemCaseSensitive(root, "widgets");
+    result.ok = cJSON_IsArray(widgets);
+    result.widgets = cJSON_GetArraySize(widgets);
+    cJSON_Delete(root);
+
+    result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    result.peak = g_peak - base;
+    return result;
+}
+
+Result runStreamed(const std::string& doc) {
+    Result result;
+    ConfigStreamParser parser(
+        [&result](cJSON* widget) {
+            result.widgets++;
+            cJSON_Delete(widget);
+            return true;
+        },
+        [](const std::string&, cJSON* value) {
+            cJSON_Delete(value);
+            return true;
+        });
+    parser.reset();
+
+    resetPeak();
+    size_t base = g_live;
+    auto start = std::chrono::steady_clock::now();
+
+    bool ok = true;
+    for (size_t offset = 0; ok && offset < doc.size(); offset += kChunkSize) {
+        ok = parser.feed(doc.data() + offset, std::min(kChunkSize, doc.size() - offset));
+    }
+    result.ok = ok && parser.finish() && parser.hasWidgets();
+
+    result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    result.peak = g_peak - base;
+    if (!result.ok) {
+        fprintf(stderr, "stream parse failed: %s\n", parser.error() ? parser.error() : "?");
+    }
+    return result;
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+    if (void* ptr = countedMalloc(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    countedFree(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    countedFree(ptr);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s config.json...\n", argv[0]);
+        return 1;
+    }
+
+    cJSON_Hooks hooks = {countedMalloc, countedFree};
+    cJSON_InitHooks(&hooks);
+
+    printf("%-28s %9s %7s | %12s %9s | %12s %9s\n", "config (scaled)", "bytes", "widgets",
+           "buffered KB", "ms", "streamed KB", "ms");
+    int failures = 0;
+    for (int i = 1; i < argc; i++) {
+        std::ifstream file(argv[i], std::ios::binary);
+        std::stringstream source;
+        source << file.rdbuf();
+        std::string doc;
+        if (!scaleConfig(source.str(), doc)) {
+            continue;  // No widgets to scale (e.g. empty.json)
+        }
+
+        Result buffered = runBuffered(doc);
+        Result streamed = runStreamed(doc);
+        if (!buffered.ok || !streamed.ok || buffered.widgets != streamed.widgets) {
+            failures++;
+        }
+
+        std::string name = argv[i];
+        name = name.substr(name.find_last_of('/') + 1);
+        printf("%-28s %9zu %7d | %12.1f %9.2f | %12.1f %9.2f\n", name.c_str(), doc.size(), streamed.widgets,
+               buffered.peak / 1024.0, buffered.ms, streamed.peak / 1024.0, streamed.ms);
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+// Host-side benchmark for MQTT subscriber dispatch.
+//
+// Replays 100k messages across 1k topics and compares the previous dispatch path
+// (std::map<std::string, std::vector<Subscription>> exact lookup + vector copy) with
+// the TopicTrie used by MQTTManager (exact + wildcard filters, no list copy): exact
+// subscriptions only, wildcards only, and both at once.
+//
+// Build and run from the repository root:
+//   g++ -O2 -std=c++20 -Icomponents/mqtt_manager/include tools/topic_dispatch_bench.cpp -o /tmp/topic_dispatch_bench
+//   /tmp/topic_dispatch_bench
+
+#include "topic_trie.h"
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int kTopicCount = 1000;
+constexpr int kMessageCount = 100000;
+
+using MessageCallback = std::function<void(const std::string&, const std::string&)>;
+
+struct Subscription {
+    uint32_t handle;
+    MessageCallback callback;
+};
+
+using SubscriberList = std::vector<Subscription>;
+using SubscriberListPtr = std::shared_ptr<const SubscriberList>;
+
+struct TopicEntry {
+    SubscriberListPtr subscribers;
+    int qos = 0;
+};
+
+std::string makeTopic(int index) {
+    // site/area/line/cell/device/signal, 10 lines x 10 cells x 10 signals
+    char buf[96];
+    snprintf(buf, sizeof(buf), "site/plant1/line%d/cell%d/device/signal%d",
+             index / 100, (index / 10) % 10, index % 10);
+    return buf;
+}
+
+double nsPerMessage(std::chrono::steady_clock::duration elapsed) {
+    return std::chrono::duration<double, std::nano>(elapsed).count() / kMessageCount;
+}
+
+bool runBench(int subscribers_per_topic) {
+    std::vector<std::string> topics;
+    topics.reserve(kTopicCount);
+    for (int i = 0; i < kTopicCount; i++) {
+        topics.push_back(makeTopic(i));
+    }
+
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> pick(0, kTopicCount - 1);
+    std::vector<int> sequence(kMessageCount);
+    for (auto& index : sequence) {
+        index = pick(rng);
+    }
+
+    const std::string payload = "42.5";
+    uint64_t delivered = 0;
+    MessageCallback callback = [&delivered](const std::string&, const std::string& p) {
+        delivered += p.size();
+    };
+
+    // Baseline: exact-match std::map with per-message subscriber vector copy
+    std::map<std::string, std::vector<Subscription>> map_subscribers;
+    uint32_t handle = 1;
+    for (const auto& topic : topics) {
+        for (int s = 0; s < subscribers_per_topic; s++) {
+            map_subscribers[topic].push_back(Subscription{handle++, callback});
+        }
+    }
+
+    delivered = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int index : sequence) {
+        std::string topic = topics[index];
+        std::vector<Subscription> subs_copy;
+        auto it = map_subscribers.find(topic);
+        if (it != map_subscribers.end()) {
+            subs_copy = it->second;
+        }
+        for (auto& sub : subs_copy) {
+            sub.callback(topic, payload);
+        }
+    }
+    auto map_elapsed = std::chrono::steady_clock::now() - start;
+    uint64_t map_delivered = delivered;
+
+    // Trie with the same exact subscriptions
+    TopicTrie<TopicEntry> trie;
+    handle = 1;
+    for (const auto& topic : topics) {
+        auto subs = std::make_shared<SubscriberList>();
+        for (int s = 0; s < subscribers_per_topic; s++) {
+            subs->push_back(Subscription{handle++, callback});
+        }
+        trie.at(topic).subscribers = std::move(subs);
+    }
+
+    std::vector<SubscriberListPtr> lists;
+    auto run_trie = [&](TopicTrie<TopicEntry>& t) {
+        delivered = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int index : sequence) {
+            std::string topic = topics[index];
+            lists.clear();
+            t.match(topic, [&lists](const TopicEntry& entry) {
+                if (entry.subscribers) {
+                    lists.push_back(entry.subscribers);
+                }
+            });
+            for (const auto& list : lists) {
+                for (const auto& sub : *list) {
+                    sub.callback(topic, payload);
+                }
+            }
+        }
+        lists.clear();
+        return std::chrono::steady_clock::now() - t0;
+    };
+
+    auto trie_elapsed = run_trie(trie);
+    uint64_t trie_delivered = delivered;
+
+    // Trie where the 1k exact subscriptions are replaced by 10 per-line wildcards
+    TopicTrie<TopicEntry> wildcard_trie;
+    for (int line = 0; line < 10; line++) {
+        char filter[64];
+        snprintf(filter, sizeof(filter), "site/plant1/line%d/+/device/#", line);
+        auto subs = std::make_shared<SubscriberList>();
+        for (int s = 0; s < subscribers_per_topic; s++) {
+            subs->push_back(Subscription{handle++, callback});
+        }
+        wildcard_trie.at(filter).subscribers = std::move(subs);
+    }
+    auto wildcard_elapsed = run_trie(wildcard_trie);
+    uint64_t wildcard_delivered = delivered;
+
+    // Both: exact topics resolve by hash, the walk only visits the wildcard branches
+    for (int line = 0; line < 10; line++) {
+        char filter[64];
+        snprintf(filter, sizeof(filter), "site/plant1/line%d/+/device/#", line);
+        trie.at(filter).subscribers = wildcard_trie.find(filter)->subscribers;
+    }
+    auto mixed_elapsed = run_trie(trie);
+    uint64_t mixed_delivered = delivered;
+
+    printf("Dispatch of %d messages across %d topics (%d subscriber(s) per topic)\n",
+           kMessageCount, kTopicCount, subscribers_per_topic);
+    printf("  before  std::map exact + copy : %8.1f ns/msg\n", nsPerMessage(map_elapsed));
+    printf("  after   TopicTrie exact        : %8.1f ns/msg\n", nsPerMessage(trie_elapsed));
+    printf("  after   TopicTrie 10 wildcards : %8.1f ns/msg\n", nsPerMessage(wildcard_elapsed));
+    printf("  after   TopicTrie exact + 10 wc: %8.1f ns/msg\n", nsPerMessage(mixed_elapsed));
+
+    if (map_delivered != trie_delivered || map_delivered != wildcard_delivered ||
+        mixed_delivered != 2 * map_delivered) {
+        fprintf(stderr, "Delivery mismatch: map=%llu trie=%llu wildcard=%llu\n",
+                (unsigned long long)map_delivered, (unsigned long long)trie_delivered,
+                (unsigned long long)wildcard_delivered);
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+int main() {
+    bool ok = runBench(1);
+    ok = runBench(4) && ok;
+    return ok ? 0 : 1;
+}